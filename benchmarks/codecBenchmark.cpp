@@ -0,0 +1,560 @@
+/*
+ * Author:  Jordan Leiker
+ * Class: ECE6122
+ * Last Date Modified: 10/16/2026
+ *
+ * Description:
+ * Benchmark for the codecs the --codec option can pick (none, mpeg2video, mpeg4, libx264), without a camera or a
+ * network. Every frame goes through Encoder::encode() and straight into Decoder::decodeFramed(), the same two calls
+ * the server and the client make, at each of several frame sizes. Frames come from a deterministic synthetic scene
+ * (colored blobs moving over a noisy background, identical on every run and every machine) or from a video file
+ * (--video, resized to each size and looped if it is too short).
+ *
+ * For every codec and size it reports:
+ *   encode / decode fps            frames per second of time spent in encode() / decodeFramed() (incl. color conversion)
+ *   encode / decode p50 and p99    per call latency (ms)
+ *   encode / decode delay          frames the codec holds back (measured from pts, see VideoCodec::getThreadStats())
+ *   bytes per frame and kbps       encoded size, kbps at --fps
+ *   PSNR                           decoded frame vs. the frame that went in (dB, averaged over frames, capped at 100)
+ *
+ * The results go to stdout as CSV (one header line, then one line per codec and size) so runs can be kept and
+ * diffed to catch regressions. Progress and warnings go to stderr. The benchmark fails (returns 1) if a codec
+ * gives no frames back or its PSNR is under MIN_PSNR_DB.
+ *
+ * Build:
+ * g++ -O2 -std=c++14 codecBenchmark.cpp ../source_pc/VideoCodec.cpp ../source_pc/ColorConvert.cpp `pkg-config --cflags --libs opencv4 libavcodec libavutil libswscale` -o codecBenchmark
+ *
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <opencv2/opencv.hpp>
+#include "../source_pc/VideoCodec.h"
+
+#define SOURCE_HISTORY 64       // source frames kept to compare against (more than any codec delay)
+#define MAX_PSNR_DB 100.0       // PSNR of identical frames is infinite, count it as this
+#define MIN_PSNR_DB 20.0        // below this the codec is broken, not just lossy
+#define NUM_BLOBS 6
+
+
+/*
+ * class SyntheticScene
+ *
+ * Description:
+ * Frame i of a made up camera scene: a blurred noise background (texture, so the encoder has something to do),
+ * NUM_BLOBS filled circles bouncing around it at different speeds, and a little fresh noise every frame like a
+ * real sensor. Every frame depends only on the size and the index, so each run sees exactly the same video.
+ *
+ */
+class SyntheticScene
+{
+    cv::Mat background;
+    cv::Mat noise;
+    cv::Point2d blobStart[NUM_BLOBS];
+    cv::Point2d blobSpeed[NUM_BLOBS]; // pixels/frame
+    cv::Scalar blobColor[NUM_BLOBS];
+    int blobRadius;
+
+
+    /*
+     * double bounce(double x, double size)
+     *
+     * Description:
+     * Position after travelling x pixels along an axis of the given size, bouncing off both ends.
+     *
+     * Inputs:
+     *		double x                     distance travelled
+     *		double size                  length of the axis
+     *
+     * Outputs:
+     *		double (return val)          position in [0, size]
+     */
+    static double bounce(double x, double size)
+    {
+        double pos = std::fmod(std::fabs(x), 2.0 * size);
+        return (pos > size) ? 2.0 * size - pos : pos;
+    }
+
+public:
+    SyntheticScene(int rows, int cols) : noise(rows, cols, CV_8UC3)
+    {
+        cv::RNG rng(6122);
+
+        background.create(rows, cols, CV_8UC3);
+        rng.fill(background, cv::RNG::NORMAL, cv::Scalar::all(128), cv::Scalar::all(40));
+        cv::GaussianBlur(background, background, cv::Size(5, 5), 0);
+
+        blobRadius = std::max(4, rows / 12);
+        for (int b = 0; b < NUM_BLOBS; b++)
+        {
+            blobStart[b] = cv::Point2d(rng.uniform(0.0, double(cols)), rng.uniform(0.0, double(rows)));
+            blobSpeed[b] = cv::Point2d(rng.uniform(-0.01, 0.01) * cols, rng.uniform(-0.01, 0.01) * rows);
+            blobColor[b] = cv::Scalar(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256));
+        }
+    }
+
+
+    /*
+     * void render(int index, cv::Mat& frame)
+     *
+     * Description:
+     * Draw frame number index.
+     *
+     * Inputs:
+     *		int index                    frame number
+     *
+     * Outputs:
+     *		cv::Mat& frame               BGR24 frame
+     */
+    void render(int index, cv::Mat& frame)
+    {
+        background.copyTo(frame);
+        for (int b = 0; b < NUM_BLOBS; b++)
+        {
+            cv::Point center(int(bounce(blobStart[b].x + blobSpeed[b].x * index, frame.cols - 1)),
+                             int(bounce(blobStart[b].y + blobSpeed[b].y * index, frame.rows - 1)));
+            cv::circle(frame, center, blobRadius, blobColor[b], cv::FILLED);
+        }
+
+        cv::RNG rng(index);
+        rng.fill(noise, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(5));
+        cv::add(frame, noise, frame);
+    }
+};
+
+
+/*
+ * class FrameSource
+ *
+ * Description:
+ * Hands out the frames to encode: the synthetic scene, or a video file resized to the benchmark size (started over
+ * from the beginning when it runs out).
+ *
+ */
+class FrameSource
+{
+    SyntheticScene scene;
+    cv::VideoCapture video;
+    std::string videoPath;
+    cv::Mat videoFrame;
+    int index;
+
+public:
+    FrameSource(int rows, int cols, const std::string& path) : scene(rows, cols), videoPath(path), index(0)
+    {
+        if (!videoPath.empty() && !video.open(videoPath))
+        {
+            std::cerr << "ERR - cannot open video file " << videoPath << std::endl;
+            exit(1);
+        }
+    }
+
+
+    /*
+     * void next(cv::Mat& frame)
+     *
+     * Description:
+     * Get the next frame, at the size the source was made for.
+     *
+     * Inputs:
+     *		N/A
+     *
+     * Outputs:
+     *		cv::Mat& frame               BGR24 frame
+     */
+    void next(cv::Mat& frame)
+    {
+        if (videoPath.empty())
+        {
+            scene.render(index++, frame);
+            return;
+        }
+
+        if (!video.read(videoFrame))
+        {
+            video.set(cv::CAP_PROP_POS_FRAMES, 0);
+            if (!video.read(videoFrame))
+            {
+                std::cerr << "ERR - no frames in video file " << videoPath << std::endl;
+                exit(1);
+            }
+        }
+        cv::resize(videoFrame, frame, frame.size(), 0, 0, cv::INTER_AREA);
+    }
+};
+
+
+/*
+ * struct codecResult
+ *
+ * Description:
+ * What one codec did at one size (one CSV line).
+ *
+ */
+struct codecResult
+{
+    std::string codec;
+    int rows, cols;
+    int framesIn, framesOut;
+    std::vector<double> encodeMs, decodeMs; // per call
+    unsigned long long bytes;
+    double psnrSum;
+    CodecThreadStats encStats, decStats;
+
+    codecResult() : rows(0), cols(0), framesIn(0), framesOut(0), bytes(0), psnrSum(0.0), encStats(), decStats() {}
+};
+
+
+/*
+ * double percentile(std::vector<double> values, double p)
+ *
+ * Description:
+ * The p-th percentile (nearest rank) of some values.
+ *
+ * Inputs:
+ *		std::vector<double> values   samples (copied, since they get sorted)
+ *		double p                     percentile, 0-100
+ *
+ * Outputs:
+ *		double (return val)          percentile, 0 if there are no samples
+ */
+double percentile(std::vector<double> values, double p)
+{
+    if (values.empty())
+        return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t rank = size_t(std::ceil(p / 100.0 * values.size()));
+    return values[std::min(values.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+
+/*
+ * double framePsnr(const cv::Mat& a, const cv::Mat& b)
+ *
+ * Description:
+ * PSNR between two frames, capped at MAX_PSNR_DB.
+ *
+ * Inputs:
+ *		const cv::Mat& a             first frame
+ *		const cv::Mat& b             second frame (same size/type)
+ *
+ * Outputs:
+ *		double (return val)          PSNR (dB)
+ */
+double framePsnr(const cv::Mat& a, const cv::Mat& b)
+{
+    return std::min(cv::PSNR(a, b), MAX_PSNR_DB);
+}
+
+
+/*
+ * bool decoderNameFor(const std::string& encoderName, std::string& decoderName)
+ *
+ * Description:
+ * Find the decoder for an encoder's bitstream (e.g. libx264 -> h264).
+ *
+ * Inputs:
+ *		const std::string& encoderName  encoder name
+ *
+ * Outputs:
+ *		std::string& decoderName     decoder name
+ *		bool (return val)            false if there is no such encoder or no decoder for it
+ */
+bool decoderNameFor(const std::string& encoderName, std::string& decoderName)
+{
+    const AVCodec* encoder = avcodec_find_encoder_by_name(encoderName.c_str());
+    if (!encoder)
+        return false;
+    const AVCodec* decoder = avcodec_find_decoder(encoder->id);
+    if (!decoder)
+        return false;
+    decoderName = decoder->name;
+    return true;
+}
+
+
+/*
+ * codecResult benchmarkCodec(const std::string& codec, int rows, int cols, int frames, unsigned fps,
+ *                            EncoderProfile profile, const CodecThreading& threading, const std::string& videoPath)
+ *
+ * Description:
+ * Encode and decode frames of one size with one codec, timing every call and comparing every decoded frame with the
+ * one that went in. "none" stands for sending raw frames: no codec time, 3 bytes per pixel, a perfect picture.
+ *
+ * Inputs:
+ *		const std::string& codec     encoder name, or "none"
+ *		int rows, int cols           frame size (even)
+ *		int frames                   frames to send through
+ *		unsigned fps                 frame rate the encoder is set up for
+ *		EncoderProfile profile       encoder profile
+ *		const CodecThreading& threading  encoder and decoder threading
+ *		const std::string& videoPath video file, empty for the synthetic scene
+ *
+ * Outputs:
+ *		codecResult (return val)     measurements
+ */
+codecResult benchmarkCodec(const std::string& codec, int rows, int cols, int frames, unsigned fps, EncoderProfile profile,
+                           const CodecThreading& threading, const std::string& videoPath)
+{
+    codecResult result;
+    result.codec = codec;
+    result.rows = rows;
+    result.cols = cols;
+
+    FrameSource source(rows, cols, videoPath);
+    cv::Mat sources[SOURCE_HISTORY]; // frame i went in with pts i
+    for (int i = 0; i < SOURCE_HISTORY; i++)
+        sources[i].create(rows, cols, CV_8UC3);
+
+    if (codec == "none")
+    {
+        for (int i = 0; i < frames; i++)
+        {
+            source.next(sources[0]);
+            result.encodeMs.push_back(0.0);
+            result.decodeMs.push_back(0.0);
+            result.bytes += sources[0].total() * sources[0].elemSize();
+            result.psnrSum += MAX_PSNR_DB;
+        }
+        result.framesIn = result.framesOut = frames;
+        return result;
+    }
+
+    std::string decoderName;
+    if (!decoderNameFor(codec, decoderName))
+    {
+        std::cerr << "ERR - no encoder/decoder pair for codec " << codec << std::endl;
+        exit(1);
+    }
+
+    Encoder encoder(codec.c_str(), AV_PIX_FMT_BGR24, AV_PIX_FMT_YUV420P, cols, rows, fps, profile, threading);
+    Decoder decoder(decoderName.c_str(), AV_PIX_FMT_BGR24, AV_PIX_FMT_YUV420P, cols, rows, fps, threading);
+    AVPacket* pkt = av_packet_alloc();
+    if (!pkt)
+    {
+        std::cerr << "ERR - fail to allocate packet" << std::endl;
+        exit(1);
+    }
+
+    cv::Mat decoded;
+    for (int i = 0; i < frames; i++)
+    {
+        cv::Mat& frame = sources[i % SOURCE_HISTORY];
+        source.next(frame);
+        result.framesIn++;
+
+        auto start = std::chrono::steady_clock::now();
+        bool gotPacket = encoder.encode(frame, pkt);
+        result.encodeMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        if (!gotPacket)
+            continue;
+
+        result.bytes += pkt->size;
+        start = std::chrono::steady_clock::now();
+        bool gotFrame = decoder.decodeFramed(pkt, decoded);
+        result.decodeMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        av_packet_unref(pkt);
+        if (!gotFrame)
+            continue;
+
+        int64_t pts = decoder.getLastPts();
+        if (pts == AV_NOPTS_VALUE || pts > i || i - pts >= SOURCE_HISTORY)
+        {
+            std::cerr << "WARN - " << codec << " frame came back with pts " << pts << ", not compared" << std::endl;
+            continue;
+        }
+        result.psnrSum += framePsnr(sources[pts % SOURCE_HISTORY], decoded);
+        result.framesOut++;
+    }
+
+    result.encStats = encoder.getThreadStats();
+    result.decStats = decoder.getThreadStats();
+    av_packet_free(&pkt);
+
+    if (decoder.getErrorCount())
+        std::cerr << "WARN - " << codec << " had " << decoder.getErrorCount() << " decode errors" << std::endl;
+
+    return result;
+}
+
+
+/*
+ * void printCsvHeader(void)
+ *
+ * Description:
+ * Print the CSV column names.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		N/A
+ */
+void printCsvHeader(void)
+{
+    std::cout << "source,codec,profile,threads,width,height,frames_in,frames_out,"
+        << "enc_fps,enc_p50_ms,enc_p99_ms,enc_delay_frames,enc_thread_type,enc_thread_count,"
+        << "dec_fps,dec_p50_ms,dec_p99_ms,dec_delay_frames,dec_thread_type,dec_thread_count,"
+        << "bytes_per_frame,kbps,psnr_db" << std::endl;
+}
+
+
+/*
+ * void printCsvLine(const codecResult& result, const std::string& sourceName, const std::string& profile,
+ *                   const std::string& threads, unsigned fps)
+ *
+ * Description:
+ * Print one codecResult as a CSV line (columns as in printCsvHeader()).
+ *
+ * Inputs:
+ *		const codecResult& result    measurements
+ *		const std::string& sourceName  "synthetic" or the video file
+ *		const std::string& profile   encoder profile name
+ *		const std::string& threads   threading policy name
+ *		unsigned fps                 frame rate, for kbps
+ *
+ * Outputs:
+ *		N/A
+ */
+void printCsvLine(const codecResult& result, const std::string& sourceName, const std::string& profile,
+                  const std::string& threads, unsigned fps)
+{
+    double encTotalMs = 0.0, decTotalMs = 0.0;
+    for (double ms : result.encodeMs)
+        encTotalMs += ms;
+    for (double ms : result.decodeMs)
+        decTotalMs += ms;
+
+    double bytesPerFrame = result.framesIn ? double(result.bytes) / result.framesIn : 0.0;
+    double psnr = result.framesOut ? result.psnrSum / result.framesOut : 0.0;
+    bool raw = result.codec == "none";
+
+    std::cout << sourceName << "," << result.codec << "," << (raw ? "" : profile) << "," << (raw ? "" : threads) << ","
+        << result.cols << "," << result.rows << "," << result.framesIn << "," << result.framesOut << ","
+        << (encTotalMs > 0 ? 1000.0 * result.encodeMs.size() / encTotalMs : 0.0) << ","
+        << percentile(result.encodeMs, 50) << "," << percentile(result.encodeMs, 99) << ","
+        << result.encStats.avgDelay << "," << (raw ? "" : result.encStats.threadType) << "," << result.encStats.threadCount << ","
+        << (decTotalMs > 0 ? 1000.0 * result.decodeMs.size() / decTotalMs : 0.0) << ","
+        << percentile(result.decodeMs, 50) << "," << percentile(result.decodeMs, 99) << ","
+        << result.decStats.avgDelay << "," << (raw ? "" : result.decStats.threadType) << "," << result.decStats.threadCount << ","
+        << bytesPerFrame << "," << bytesPerFrame * 8.0 * fps / 1000.0 << "," << psnr << std::endl;
+}
+
+
+/*
+ * std::vector<std::string> splitList(const std::string& list)
+ *
+ * Description:
+ * Split a comma separated option value.
+ *
+ * Inputs:
+ *		const std::string& list      e.g. "mpeg4,libx264"
+ *
+ * Outputs:
+ *		std::vector<std::string> (return val)  the non-empty items
+ */
+std::vector<std::string> splitList(const std::string& list)
+{
+    std::vector<std::string> items;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+
+int main(int argc, char* argv[])
+{
+    const cv::String keys =
+        "{help h usage ? |                              | Help is on the way!                                  }"
+        "{codecs         | none,mpeg2video,mpeg4,libx264 | codecs to compare (comma separated encoder names)    }"
+        "{sizes          | 640x480,1280x720,1920x1080    | frame sizes, WIDTHxHEIGHT (comma separated, even)    }"
+        "{frames         | 300                          | frames per codec and size                            }"
+        "{fps            | 20                           | frame rate the encoders are set up for               }"
+        "{profile        | latency                      | encoder profile ('latency', 'balanced', 'archive')   }"
+        "{threads        | slice                        | encoder and decoder threading ('auto', 'frame[:N]', 'slice[:N]')}"
+        "{video          |                              | video file to use instead of the synthetic scene     }"
+        ;
+
+    cv::CommandLineParser parser(argc, argv, keys);
+    parser.about("Codec Benchmark");
+    if (parser.has("help"))
+    {
+        parser.printMessage();
+        return 0;
+    }
+
+    std::vector<std::string> codecs = splitList(parser.get<std::string>("codecs"));
+    std::vector<std::string> sizes = splitList(parser.get<std::string>("sizes"));
+    int frames = parser.get<int>("frames");
+    unsigned fps = parser.get<unsigned>("fps");
+    std::string profileName = parser.get<std::string>("profile");
+    std::string threadsName = parser.get<std::string>("threads");
+    std::string videoPath = parser.get<std::string>("video");
+
+    if (!parser.check())
+    {
+        parser.printErrors();
+        return 1;
+    }
+
+    EncoderProfile profile;
+    CodecThreading threading;
+    if (!encoderProfileFromName(profileName, profile))
+    {
+        std::cerr << "ERR - unknown encoder profile " << profileName << std::endl;
+        return 1;
+    }
+    if (!codecThreadingFromName(threadsName, threading))
+    {
+        std::cerr << "ERR - unknown threading " << threadsName << std::endl;
+        return 1;
+    }
+    if (frames <= 0 || fps == 0)
+    {
+        std::cerr << "ERR - frames and fps must be positive" << std::endl;
+        return 1;
+    }
+
+    std::string sourceName = videoPath.empty() ? "synthetic" : videoPath;
+    std::cout << std::fixed << std::setprecision(3);
+    printCsvHeader();
+
+    bool ok = true;
+    for (const std::string& size : sizes)
+    {
+        int cols = 0, rows = 0;
+        char x = 0;
+        std::stringstream ss(size);
+        if (!(ss >> cols >> x >> rows) || x != 'x' || cols <= 0 || rows <= 0 || (cols | rows) & 1)
+        {
+            std::cerr << "ERR - bad size " << size << " (WIDTHxHEIGHT, both even)" << std::endl;
+            return 1;
+        }
+
+        for (const std::string& codec : codecs)
+        {
+            std::cerr << codec << " " << cols << "x" << rows << ", " << frames << " frames..." << std::endl;
+            codecResult result = benchmarkCodec(codec, rows, cols, frames, fps, profile, threading, videoPath);
+            printCsvLine(result, sourceName, profileName, codecThreadingName(threading), fps);
+
+            double psnr = result.framesOut ? result.psnrSum / result.framesOut : 0.0;
+            if (result.framesOut == 0 || psnr < MIN_PSNR_DB)
+            {
+                std::cerr << "FAIL - " << codec << " " << cols << "x" << rows << ": " << result.framesOut
+                    << " frames back, PSNR " << psnr << " dB" << std::endl;
+                ok = false;
+            }
+        }
+    }
+
+    return ok ? 0 : 1;
+}
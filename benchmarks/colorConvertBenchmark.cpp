@@ -0,0 +1,238 @@
+/*
+ * Author:  Jordan Leiker
+ * Class: ECE6122
+ * Last Date Modified: 10/16/2026
+ *
+ * Description:
+ * Microbenchmark for the BGR24 <-> YUV420P conversion on either side of the codec (every frame, both ends).
+ * Compares, in each direction:
+ *   (1) sws_scale with the same context VideoCodec used to set up
+ *   (2) the ColorConvert scalar kernel, one thread
+ *   (3) the ColorConvert SIMD kernel, one thread
+ *   (4) the ColorConvert SIMD kernel, striped over OpenCV's thread pool (what VideoCodec runs)
+ * Before timing, the SIMD kernel is checked bit for bit against the scalar kernel (the benchmark fails if they
+ * differ), and the difference to sws_scale is reported (the two round differently, so a small difference is expected).
+ *
+ * Build:
+ * g++ -O2 -std=c++14 colorConvertBenchmark.cpp ../source_pc/ColorConvert.cpp `pkg-config --cflags --libs opencv4 libswscale libavutil` -o colorConvertBenchmark
+ *
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <functional>
+#include <opencv2/opencv.hpp>
+#include "../source_pc/ColorConvert.h"
+
+extern "C"
+{
+	#include <libswscale/swscale.h>
+}
+
+#define NUM_ITERATIONS 200
+
+
+/*
+ * double timeIt(std::function<void(void)> fn)
+ *
+ * Description:
+ * Run fn NUM_ITERATIONS times (after one warm up call).
+ *
+ * Inputs:
+ *		std::function<void(void)> fn   work to time
+ *
+ * Outputs:
+ *		double (return val)            average milliseconds per call
+ */
+double timeIt(std::function<void(void)> fn)
+{
+    fn();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < NUM_ITERATIONS; i++)
+        fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / NUM_ITERATIONS;
+}
+
+
+/*
+ * struct yuvImage
+ *
+ * Description:
+ * Y, U and V planes of one YUV420P frame, laid out the way sws_scale and the ColorConvert functions take them.
+ *
+ */
+struct yuvImage
+{
+    cv::Mat plane[3];
+    uint8_t* data[4]; // sws_scale reads 4 planes
+    int stride[4];
+
+    yuvImage(int rows, int cols)
+    {
+        plane[0].create(rows, cols, CV_8UC1);
+        plane[1].create(rows / 2, cols / 2, CV_8UC1);
+        plane[2].create(rows / 2, cols / 2, CV_8UC1);
+        for (int c = 0; c < 3; c++)
+        {
+            data[c] = plane[c].data;
+            stride[c] = static_cast<int>(plane[c].step[0]);
+        }
+        data[3] = NULL;
+        stride[3] = 0;
+    }
+
+    bool operator==(const yuvImage& other) const
+    {
+        for (int c = 0; c < 3; c++)
+            if (cv::norm(plane[c], other.plane[c], cv::NORM_INF) != 0)
+                return false;
+        return true;
+    }
+};
+
+
+/*
+ * void printDiff(const char* name, const cv::Mat& a, const cv::Mat& b)
+ *
+ * Description:
+ * Print the largest and the mean absolute difference between two images.
+ *
+ * Inputs:
+ *		const char* name               what is being compared
+ *		const cv::Mat& a               first image
+ *		const cv::Mat& b               second image (same size/type)
+ *
+ * Outputs:
+ *		N/A
+ */
+void printDiff(const char* name, const cv::Mat& a, const cv::Mat& b)
+{
+    cv::Mat diff;
+    cv::absdiff(a, b, diff);
+    std::cout << "    " << name << " max " << cv::norm(diff, cv::NORM_INF) << ", mean "
+        << cv::norm(diff, cv::NORM_L1) / diff.total() / diff.channels() << std::endl;
+}
+
+
+/*
+ * void printTimes(const char* direction, double tSws, double tScalar, double tSimd, double tStriped)
+ *
+ * Description:
+ * Print the timings for one direction, with the speedup over sws_scale.
+ *
+ * Inputs:
+ *		const char* direction          e.g. "BGR24 -> YUV420P"
+ *		double tSws ... tStriped       ms per frame of each variant
+ *
+ * Outputs:
+ *		N/A
+ */
+void printTimes(const char* direction, double tSws, double tScalar, double tSimd, double tStriped)
+{
+    std::cout << "  " << direction << std::endl;
+    std::cout << "    sws_scale:              " << tSws << " ms" << std::endl;
+    std::cout << "    scalar (1 thread):      " << tScalar << " ms  " << std::setprecision(1) << (tSws / tScalar) << "x"
+        << std::setprecision(3) << std::endl;
+    std::cout << "    " << std::left << std::setw(24) << (std::string(colorConvertKernel()) + " (1 thread):") << std::right
+        << tSimd << " ms  " << std::setprecision(1) << (tSws / tSimd) << "x" << std::setprecision(3) << std::endl;
+    std::cout << "    " << std::left << std::setw(24) << (std::string(colorConvertKernel()) + " (striped):") << std::right
+        << tStriped << " ms  " << std::setprecision(1) << (tSws / tStriped) << "x" << std::setprecision(3) << std::endl;
+}
+
+
+/*
+ * bool benchmarkSize(int rows, int cols)
+ *
+ * Description:
+ * Check and time every variant for one frame size, both directions.
+ *
+ * Inputs:
+ *		int rows                     frame height (even)
+ *		int cols                     frame width (even)
+ *
+ * Outputs:
+ *		bool (return val)            true if the SIMD kernel matched the scalar kernel
+ */
+bool benchmarkSize(int rows, int cols)
+{
+    const int single = COLOR_CONVERT_SINGLE_THREAD;
+    const int scalar = COLOR_CONVERT_SCALAR | COLOR_CONVERT_SINGLE_THREAD;
+
+    // Same contexts as the Encoder/Decoder constructors in VideoCodec.h
+    SwsContext* toYuv = sws_getContext(cols, rows, AV_PIX_FMT_BGR24, cols, rows, AV_PIX_FMT_YUV420P, 0, NULL, NULL, NULL);
+    SwsContext* toBgr = sws_getContext(cols, rows, AV_PIX_FMT_YUV420P, cols, rows, AV_PIX_FMT_BGR24, 0, NULL, NULL, NULL);
+    if (!toYuv || !toBgr)
+    {
+        std::cerr << "ERR - fail to initialize software rescale context" << std::endl;
+        exit(1);
+    }
+
+    cv::Mat bgr(rows, cols, CV_8UC3);
+    cv::randu(bgr, cv::Scalar::all(0), cv::Scalar::all(256));
+    uint8_t* bgrData[4] = { bgr.data, NULL, NULL, NULL };
+    const int bgrStride[4] = { static_cast<int>(bgr.step[0]), 0, 0, 0 };
+
+    yuvImage yuvSws(rows, cols), yuvScalar(rows, cols), yuvSimd(rows, cols), yuvStriped(rows, cols);
+    cv::Mat bgrSws(rows, cols, CV_8UC3), bgrScalar(rows, cols, CV_8UC3), bgrSimd(rows, cols, CV_8UC3), bgrStriped(rows, cols, CV_8UC3);
+    uint8_t* bgrSwsData[4] = { bgrSws.data, NULL, NULL, NULL };
+    const int bgrSwsStride[4] = { static_cast<int>(bgrSws.step[0]), 0, 0, 0 };
+
+    // BGR24 -> YUV420P
+    auto swsToYuv = [&]() { sws_scale(toYuv, bgrData, bgrStride, 0, rows, yuvSws.data, yuvSws.stride); };
+    auto scalarToYuv = [&]() { bgr24ToYuv420p(bgr.data, bgr.step[0], yuvScalar.data, yuvScalar.stride, rows, cols, scalar); };
+    auto simdToYuv = [&]() { bgr24ToYuv420p(bgr.data, bgr.step[0], yuvSimd.data, yuvSimd.stride, rows, cols, single); };
+    auto stripedToYuv = [&]() { bgr24ToYuv420p(bgr.data, bgr.step[0], yuvStriped.data, yuvStriped.stride, rows, cols); };
+
+    // YUV420P -> BGR24, all from the same (scalar) YUV frame
+    auto swsToBgr = [&]() { sws_scale(toBgr, yuvScalar.data, yuvScalar.stride, 0, rows, bgrSwsData, bgrSwsStride); };
+    auto scalarToBgr = [&]() { yuv420pToBgr24(yuvScalar.data, yuvScalar.stride, bgrScalar.data, bgrScalar.step[0], rows, cols, scalar); };
+    auto simdToBgr = [&]() { yuv420pToBgr24(yuvScalar.data, yuvScalar.stride, bgrSimd.data, bgrSimd.step[0], rows, cols, single); };
+    auto stripedToBgr = [&]() { yuv420pToBgr24(yuvScalar.data, yuvScalar.stride, bgrStriped.data, bgrStriped.step[0], rows, cols); };
+
+    // Accuracy
+    swsToYuv();
+    scalarToYuv();
+    simdToYuv();
+    stripedToYuv();
+    bool okToYuv = yuvSimd == yuvScalar && yuvStriped == yuvScalar;
+
+    swsToBgr();
+    scalarToBgr();
+    simdToBgr();
+    stripedToBgr();
+    bool okToBgr = cv::norm(bgrSimd, bgrScalar, cv::NORM_INF) == 0 && cv::norm(bgrStriped, bgrScalar, cv::NORM_INF) == 0;
+
+    std::cout << cols << "x" << rows << std::endl;
+    std::cout << "  " << colorConvertKernel() << " vs scalar: BGR24 -> YUV420P " << (okToYuv ? "exact" : "MISMATCH")
+        << ", YUV420P -> BGR24 " << (okToBgr ? "exact" : "MISMATCH") << std::endl;
+    std::cout << "  ColorConvert vs sws_scale:" << std::endl;
+    printDiff("Y:  ", yuvScalar.plane[0], yuvSws.plane[0]);
+    printDiff("U:  ", yuvScalar.plane[1], yuvSws.plane[1]);
+    printDiff("V:  ", yuvScalar.plane[2], yuvSws.plane[2]);
+    printDiff("BGR:", bgrScalar, bgrSws);
+
+    // Speed
+    printTimes("BGR24 -> YUV420P", timeIt(swsToYuv), timeIt(scalarToYuv), timeIt(simdToYuv), timeIt(stripedToYuv));
+    printTimes("YUV420P -> BGR24", timeIt(swsToBgr), timeIt(scalarToBgr), timeIt(simdToBgr), timeIt(stripedToBgr));
+
+    sws_freeContext(toYuv);
+    sws_freeContext(toBgr);
+
+    return okToYuv && okToBgr;
+}
+
+
+int main()
+{
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "ColorConvert kernel: " << colorConvertKernel() << ", " << cv::getNumThreads() << " threads, "
+        << NUM_ITERATIONS << " iterations" << std::endl;
+
+    bool ok = benchmarkSize(480, 640);
+    ok = benchmarkSize(720, 1280) && ok;
+    ok = benchmarkSize(1080, 1920) && ok;
+    ok = benchmarkSize(38, 46) && ok; // widths that aren't a multiple of 16 exercise the scalar tails
+
+    return ok ? 0 : 1;
+}
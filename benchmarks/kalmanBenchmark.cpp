@@ -0,0 +1,262 @@
+/*
+ * Author:  Jordan Leiker
+ * Class: ECE6122
+ * Last Date Modified: 10/16/2026
+ *
+ * Description:
+ * Microbenchmark for the per track Kalman filter in MotionTracker (6 state constant acceleration model measuring
+ * x, y, set up exactly as in MotionTracker::createNewTrack()). Compares:
+ *   (1) cv::KalmanFilter (what the tracker used to use)
+ *   (2) FixedKalmanFilter<6, 2>, one filter at a time
+ *   (3) KalmanFilterBatch<6, 2>::predictAll(), every filter at once
+ * Before timing, the same noisy measurement sequence is run through cv::KalmanFilter and FixedKalmanFilter and the
+ * states are compared (the benchmark fails if they drift apart), and the batch is checked against the single filters.
+ *
+ * Build:
+ * g++ -O2 -std=c++14 kalmanBenchmark.cpp `pkg-config --cflags --libs opencv4` -o kalmanBenchmark
+ *
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <functional>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "../source_pc/FixedKalmanFilter.h"
+
+#define NUM_ITERATIONS 200
+#define NUM_STEPS 100           // predict/correct steps in the accuracy check
+#define MAX_RELATIVE_ERROR 1e-3 // float rounding differs a little between the two
+#define MAX_BATCH_ERROR 1e-5    // batch (SIMD) vs single (scalar) filter, relative to max(1, |value|)
+
+
+/*
+ * double timeIt(std::function<void(void)> fn)
+ *
+ * Description:
+ * Run fn NUM_ITERATIONS times (after one warm up call).
+ *
+ * Inputs:
+ *		std::function<void(void)> fn   work to time
+ *
+ * Outputs:
+ *		double (return val)            average milliseconds per call
+ */
+double timeIt(std::function<void(void)> fn)
+{
+    fn();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < NUM_ITERATIONS; i++)
+        fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / NUM_ITERATIONS;
+}
+
+
+/*
+ * cv::KalmanFilter makeCvFilter(float x, float y) / FixedKalmanFilter<6, 2> makeFixedFilter(float x, float y)
+ *
+ * Description:
+ * A filter starting at (x, y), set up like MotionTracker::createNewTrack().
+ *
+ * Inputs:
+ *		float x, float y               starting position
+ *
+ * Outputs:
+ *		(return val)                   filter
+ */
+cv::KalmanFilter makeCvFilter(float x, float y)
+{
+    cv::KalmanFilter kf(6, 2, 0);
+    kf.statePost = (cv::Mat_<float>(6, 1) << x, y, 0, 0, 0, 0);
+    float dt = 2;
+    kf.transitionMatrix = (cv::Mat_<float>(6, 6) << 1, 0, dt, 0, dt*dt, 0, 0, 1, 0, dt, 0, dt*dt, 0, 0, 1, 0, dt, 0, 0, 0, 0, 1, 0, dt, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 1);
+    cv::setIdentity(kf.measurementMatrix);
+    cv::setIdentity(kf.processNoiseCov, cv::Scalar::all(1e-5));
+    cv::setIdentity(kf.measurementNoiseCov, cv::Scalar::all(1e-1));
+    cv::setIdentity(kf.errorCovPost, cv::Scalar::all(1));
+    return kf;
+}
+
+FixedKalmanFilter<6, 2> makeFixedFilter(float x, float y)
+{
+    FixedKalmanFilter<6, 2> kf;
+    const float state[6] = { x, y, 0, 0, 0, 0 };
+    kf.setState(state);
+    float dt = 2;
+    const float transition[6][6] = {
+        { 1, 0, dt, 0, dt*dt, 0 },
+        { 0, 1, 0, dt, 0, dt*dt },
+        { 0, 0, 1, 0, dt, 0 },
+        { 0, 0, 0, 1, 0, dt },
+        { 0, 0, 0, 0, 1, 0 },
+        { 0, 0, 0, 0, 0, 1 } };
+    kf.setTransition(transition);
+    kf.setMeasurementIdentity();
+    kf.setProcessNoiseCov(1e-5f);
+    kf.setMeasurementNoiseCov(1e-1f);
+    kf.setErrorCov(1);
+    return kf;
+}
+
+
+/*
+ * bool checkAccuracy(void)
+ *
+ * Description:
+ * Track an object moving on a curve with noisy measurements through both filters and compare the states after
+ * every step, then check the batch against single filters.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		bool (return val)              true if everything matched
+ */
+bool checkAccuracy(void)
+{
+    cv::RNG rng(6122);
+    cv::KalmanFilter cvKf = makeCvFilter(100, 200);
+    FixedKalmanFilter<6, 2> fixedKf = makeFixedFilter(100, 200);
+    double maxError = 0.0;
+
+    for (int step = 0; step < NUM_STEPS; step++)
+    {
+        float zx = 100 + 3.0f * step + float(rng.gaussian(1.0));
+        float zy = 200 + 0.05f * step * step + float(rng.gaussian(1.0));
+
+        cvKf.predict();
+        fixedKf.predict();
+        cvKf.correct((cv::Mat_<float>(2, 1) << zx, zy));
+        const float z[2] = { zx, zy };
+        const float* state = fixedKf.correct(z);
+
+        for (int i = 0; i < 6; i++)
+        {
+            float expected = cvKf.statePost.at<float>(i);
+            maxError = std::max(maxError, std::fabs(state[i] - expected) / (1.0 + std::fabs(expected)));
+        }
+    }
+
+    // Batch vs. the same filters run one at a time (including a remove in the middle)
+    KalmanFilterBatch<6, 2> batch(makeFixedFilter(0, 0));
+    std::vector<FixedKalmanFilter<6, 2>> singles;
+    for (int i = 0; i < 37; i++)
+    {
+        singles.push_back(makeFixedFilter(float(10 * i), float(5 * i)));
+        batch.add(singles.back());
+    }
+    batch.remove(3);
+    singles[3] = singles.back();
+    singles.pop_back();
+
+    for (int step = 0; step < 10; step++)
+    {
+        batch.predictAll();
+        for (size_t i = 0; i < singles.size(); i++)
+        {
+            singles[i].predict();
+            const float z[2] = { float(10 * i + step), float(5 * i) };
+            singles[i].correct(z);
+            batch.correct(i, z);
+        }
+    }
+
+    // The batch runs through the SIMD kalmanAxpy() and the single filters don't, so the compiler may contract or
+    // order the arithmetic differently: allow a few ulp, relative to the size of each value
+    auto batchError = [](float batchValue, float singleValue)
+    {
+        return std::fabs(double(batchValue) - singleValue) / std::max(1.0, std::fabs(double(singleValue)));
+    };
+    double maxBatchError = 0.0;
+    FixedKalmanFilter<6, 2> fromBatch;
+    for (size_t i = 0; i < singles.size(); i++)
+    {
+        batch.get(i, fromBatch);
+        for (int r = 0; r < 6; r++)
+        {
+            maxBatchError = std::max(maxBatchError, batchError(fromBatch.getState()[r], singles[i].getState()[r]));
+            for (int c = 0; c < 6; c++)
+                maxBatchError = std::max(maxBatchError, batchError(fromBatch.getErrorCov(r, c), singles[i].getErrorCov(r, c)));
+        }
+    }
+
+    bool ok = maxError < MAX_RELATIVE_ERROR && maxBatchError <= MAX_BATCH_ERROR;
+    std::cout << "FixedKalmanFilter vs cv::KalmanFilter: max relative state error " << maxError << " (limit "
+        << MAX_RELATIVE_ERROR << "), batch vs single: max relative error " << maxBatchError << " (limit "
+        << MAX_BATCH_ERROR << ")" << (ok ? "" : "  MISMATCH") << std::endl;
+    return ok;
+}
+
+
+/*
+ * void benchmarkTracks(int numTracks)
+ *
+ * Description:
+ * Time predicting (and predicting + correcting) numTracks filters with each implementation.
+ *
+ * Inputs:
+ *		int numTracks                  number of filters
+ *
+ * Outputs:
+ *		N/A
+ */
+void benchmarkTracks(int numTracks)
+{
+    std::vector<cv::KalmanFilter> cvFilters;
+    std::vector<FixedKalmanFilter<6, 2>> fixedFilters;
+    KalmanFilterBatch<6, 2> batch(makeFixedFilter(0, 0));
+    for (int i = 0; i < numTracks; i++)
+    {
+        cvFilters.push_back(makeCvFilter(float(i), float(i)));
+        fixedFilters.push_back(makeFixedFilter(float(i), float(i)));
+        batch.add(fixedFilters.back());
+    }
+    cv::Mat_<float> measurement(2, 1);
+
+    double tCvPredict = timeIt([&]() { for (auto& kf : cvFilters) kf.predict(); });
+    double tFixedPredict = timeIt([&]() { for (auto& kf : fixedFilters) kf.predict(); });
+    double tBatchPredict = timeIt([&]() { batch.predictAll(); });
+
+    double tCvBoth = timeIt([&]() {
+        for (auto& kf : cvFilters)
+        {
+            kf.predict();
+            measurement(0) = 1.0f;
+            measurement(1) = 2.0f;
+            kf.correct(measurement);
+        }
+    });
+    double tFixedBoth = timeIt([&]() {
+        const float z[2] = { 1.0f, 2.0f };
+        for (auto& kf : fixedFilters)
+        {
+            kf.predict();
+            kf.correct(z);
+        }
+    });
+
+    const double nsPerTrack = 1e6 / numTracks;
+    std::cout << numTracks << " tracks (ns/track)" << std::endl;
+    std::cout << "  predict:            cv::KalmanFilter " << tCvPredict * nsPerTrack << ", FixedKalmanFilter "
+        << tFixedPredict * nsPerTrack << " (" << std::setprecision(1) << tCvPredict / tFixedPredict << "x), batch "
+        << std::setprecision(3) << tBatchPredict * nsPerTrack << " (" << std::setprecision(1) << tCvPredict / tBatchPredict
+        << "x)" << std::setprecision(3) << std::endl;
+    std::cout << "  predict + correct:  cv::KalmanFilter " << tCvBoth * nsPerTrack << ", FixedKalmanFilter "
+        << tFixedBoth * nsPerTrack << " (" << std::setprecision(1) << tCvBoth / tFixedBoth << "x)" << std::setprecision(3)
+        << std::endl;
+}
+
+
+int main()
+{
+    std::cout << std::fixed << std::setprecision(3);
+
+    bool ok = checkAccuracy();
+
+    benchmarkTracks(10);
+    benchmarkTracks(100);
+    benchmarkTracks(1000);
+
+    return ok ? 0 : 1;
+}
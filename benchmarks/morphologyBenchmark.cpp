@@ -0,0 +1,234 @@
+/*
+ * Author:  Jordan Leiker
+ * Class: ECE6122
+ * Last Date Modified: 10/16/2026
+ *
+ * Description:
+ * Microbenchmark for the morphological open/close MotionTracker::detect() runs on the foreground mask every frame
+ * (MORPH_OPEN 10x10 then MORPH_CLOSE 20x20 rectangles, as motionTracker_v010 sets them up). Compares:
+ *   (1) cv::morphologyEx (what the tracker used to use)
+ *   (2) rectMorphology() scalar kernel, one thread
+ *   (3) rectMorphology() SIMD kernel, one thread
+ *   (4) rectMorphology() SIMD kernel, striped over OpenCV's thread pool (what the tracker runs)
+ * on a synthetic background subtractor mask (objects, shadows and speckle noise), then times a single erode at
+ * growing rectangle sizes to show cv::morphologyEx's cost growing with the rectangle and rectMorphology()'s not.
+ * Before timing, rectMorphology() is checked bit for bit against cv::morphologyEx for every op over a spread of
+ * rectangle sizes, anchors and flags (the benchmark fails if they differ).
+ *
+ * Build:
+ * g++ -O2 -std=c++14 morphologyBenchmark.cpp ../source_pc/RectMorphology.cpp `pkg-config --cflags --libs opencv4` -o morphologyBenchmark
+ *
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "../source_pc/RectMorphology.h"
+
+#define NUM_ITERATIONS 200
+
+
+/*
+ * double timeIt(std::function<void(void)> fn)
+ *
+ * Description:
+ * Run fn NUM_ITERATIONS times (after one warm up call).
+ *
+ * Inputs:
+ *		std::function<void(void)> fn   work to time
+ *
+ * Outputs:
+ *		double (return val)            average milliseconds per call
+ */
+double timeIt(std::function<void(void)> fn)
+{
+    fn();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < NUM_ITERATIONS; i++)
+        fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / NUM_ITERATIONS;
+}
+
+
+/*
+ * cv::Mat makeMask(int rows, int cols)
+ *
+ * Description:
+ * A mask like BackgroundSubtractorMOG2 gives: background 0, a few solid objects 255 with shadows 127 next to
+ * them, and speckle noise of both. Same mask every run.
+ *
+ * Inputs:
+ *		int rows                       mask height
+ *		int cols                       mask width
+ *
+ * Outputs:
+ *		cv::Mat (return val)           CV_8UC1 mask
+ */
+cv::Mat makeMask(int rows, int cols)
+{
+    cv::RNG rng(6122);
+    cv::Mat mask(rows, cols, CV_8UC1, cv::Scalar(0));
+    const int scale = std::max(1, std::min(rows, cols) / 10);
+
+    for (int i = 0; i < 8; i++)
+    {
+        cv::Point center(rng.uniform(0, cols), rng.uniform(0, rows));
+        int radius = rng.uniform(scale / 4 + 1, scale + 2);
+        cv::rectangle(mask, cv::Rect(center.x, center.y + radius / 2, 2 * radius, radius), cv::Scalar(127), cv::FILLED);
+        cv::circle(mask, center, radius, cv::Scalar(255), cv::FILLED);
+    }
+
+    for (int i = 0; i < rows * cols / 200; i++)
+        mask.at<uint8_t>(rng.uniform(0, rows), rng.uniform(0, cols)) = (i % 3 == 0) ? 127 : (i % 2 == 0) ? 255 : 0;
+
+    return mask;
+}
+
+
+/*
+ * bool checkAccuracy(void)
+ *
+ * Description:
+ * Compare rectMorphology() with cv::morphologyEx for every op, rectangle sizes from 1x1 to larger than the image,
+ * corner and center anchors, every flag combination, and image widths that aren't a multiple of 16.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		bool (return val)              true if every case matched
+ */
+bool checkAccuracy(void)
+{
+    const cv::Size imageSizes[] = { cv::Size(640, 480), cv::Size(46, 38), cv::Size(17, 5) };
+    const cv::Size kernelSizes[] = { cv::Size(1, 1), cv::Size(3, 3), cv::Size(10, 10), cv::Size(20, 20), cv::Size(7, 1),
+                                     cv::Size(1, 9), cv::Size(31, 17), cv::Size(64, 64) };
+    const int ops[] = { cv::MORPH_ERODE, cv::MORPH_DILATE, cv::MORPH_OPEN, cv::MORPH_CLOSE };
+    const int flagSets[] = { 0, RECT_MORPHOLOGY_SINGLE_THREAD, RECT_MORPHOLOGY_SCALAR | RECT_MORPHOLOGY_SINGLE_THREAD };
+
+    int cases = 0, mismatches = 0;
+    for (const cv::Size& imageSize : imageSizes)
+    {
+        cv::Mat mask = makeMask(imageSize.height, imageSize.width);
+        for (const cv::Size& ksize : kernelSizes)
+        {
+            cv::Mat strel = cv::getStructuringElement(cv::MORPH_RECT, ksize);
+            const cv::Point anchors[] = { cv::Point(-1, -1), cv::Point(0, 0), cv::Point(ksize.width - 1, ksize.height - 1) };
+            for (const cv::Point& anchor : anchors)
+            {
+                for (int op : ops)
+                {
+                    cv::Mat expected;
+                    cv::morphologyEx(mask, expected, op, strel, anchor);
+                    for (int flags : flagSets)
+                    {
+                        cv::Mat result;
+                        rectMorphology(mask, result, op, ksize, anchor, flags);
+                        cases++;
+                        if (cv::norm(result, expected, cv::NORM_INF) != 0)
+                        {
+                            mismatches++;
+                            std::cout << "  MISMATCH " << imageSize.width << "x" << imageSize.height << " op " << op << " "
+                                << ksize.width << "x" << ksize.height << " anchor (" << anchor.x << ", " << anchor.y
+                                << ") flags " << flags << std::endl;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // In place, the way MotionTracker calls it
+    cv::Mat mask = makeMask(480, 640), expected, inPlace = mask.clone();
+    cv::morphologyEx(mask, expected, cv::MORPH_CLOSE, cv::getStructuringElement(cv::MORPH_RECT, cv::Size(20, 20)));
+    rectMorphology(inPlace, inPlace, cv::MORPH_CLOSE, cv::Size(20, 20));
+    cases++;
+    if (cv::norm(inPlace, expected, cv::NORM_INF) != 0)
+    {
+        mismatches++;
+        std::cout << "  MISMATCH in place" << std::endl;
+    }
+
+    std::cout << "rectMorphology vs cv::morphologyEx: " << cases - mismatches << " of " << cases << " cases exact"
+        << std::endl;
+    return mismatches == 0;
+}
+
+
+/*
+ * void benchmarkSize(int rows, int cols)
+ *
+ * Description:
+ * Time the tracker's open + close with each variant, then a single erode at growing rectangle sizes.
+ *
+ * Inputs:
+ *		int rows                       mask height
+ *		int cols                       mask width
+ *
+ * Outputs:
+ *		N/A
+ */
+void benchmarkSize(int rows, int cols)
+{
+    const int single = RECT_MORPHOLOGY_SINGLE_THREAD;
+    const int scalar = RECT_MORPHOLOGY_SCALAR | RECT_MORPHOLOGY_SINGLE_THREAD;
+    const cv::Size openSize(10, 10), closeSize(20, 20);
+    cv::Mat openStrel = cv::getStructuringElement(cv::MORPH_RECT, openSize);
+    cv::Mat closeStrel = cv::getStructuringElement(cv::MORPH_RECT, closeSize);
+    cv::Mat mask = makeMask(rows, cols), out;
+
+    double tCv = timeIt([&]() {
+        cv::morphologyEx(mask, out, cv::MORPH_OPEN, openStrel);
+        cv::morphologyEx(out, out, cv::MORPH_CLOSE, closeStrel);
+    });
+    auto rectOpenClose = [&](int flags) {
+        return timeIt([&]() {
+            rectMorphology(mask, out, cv::MORPH_OPEN, openSize, cv::Point(-1, -1), flags);
+            rectMorphology(out, out, cv::MORPH_CLOSE, closeSize, cv::Point(-1, -1), flags);
+        });
+    };
+    double tScalar = rectOpenClose(scalar);
+    double tSimd = rectOpenClose(single);
+    double tStriped = rectOpenClose(0);
+
+    const std::string kernel = rectMorphologyKernel();
+    std::cout << cols << "x" << rows << std::endl;
+    std::cout << "  open 10x10 + close 20x20" << std::endl;
+    std::cout << "    cv::morphologyEx:       " << tCv << " ms" << std::endl;
+    std::cout << "    scalar (1 thread):      " << tScalar << " ms  " << std::setprecision(1) << (tCv / tScalar) << "x"
+        << std::setprecision(3) << std::endl;
+    std::cout << "    " << std::left << std::setw(24) << (kernel + " (1 thread):") << std::right << tSimd << " ms  "
+        << std::setprecision(1) << (tCv / tSimd) << "x" << std::setprecision(3) << std::endl;
+    std::cout << "    " << std::left << std::setw(24) << (kernel + " (striped):") << std::right << tStriped << " ms  "
+        << std::setprecision(1) << (tCv / tStriped) << "x" << std::setprecision(3) << std::endl;
+
+    std::cout << "  erode, ms (cv::morphologyEx / rectMorphology striped)" << std::endl;
+    for (int k : { 3, 5, 10, 20, 40, 80 })
+    {
+        cv::Mat strel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(k, k));
+        double tCvErode = timeIt([&]() { cv::morphologyEx(mask, out, cv::MORPH_ERODE, strel); });
+        double tRectErode = timeIt([&]() { rectMorphology(mask, out, cv::MORPH_ERODE, cv::Size(k, k)); });
+        std::cout << "    " << std::setw(2) << k << "x" << std::left << std::setw(2) << k << std::right << "  " << tCvErode
+            << " / " << tRectErode << "  " << std::setprecision(1) << (tCvErode / tRectErode) << "x"
+            << std::setprecision(3) << std::endl;
+    }
+}
+
+
+int main()
+{
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "RectMorphology kernel: " << rectMorphologyKernel() << ", " << cv::getNumThreads() << " threads, "
+        << NUM_ITERATIONS << " iterations" << std::endl;
+
+    bool ok = checkAccuracy();
+
+    benchmarkSize(480, 640);
+    benchmarkSize(1080, 1920);
+
+    return ok ? 0 : 1;
+}
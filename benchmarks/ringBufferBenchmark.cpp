@@ -0,0 +1,208 @@
+/*
+ * Author:  Jordan Leiker
+ * Class: ECE6122
+ * Last Date Modified: 10/16/2026
+ *
+ * Description:
+ * Microbenchmark comparing the lock-free RingBuffer against the original circular queue wrapped in a
+ * std::mutex (the QueueMat/QueuePkt + lock/unlock pattern the camera server and motion tracker used).
+ *
+ * One producer thread pushes N items and one consumer thread pops them, both retrying in a loop like the
+ * application threads do (with a yield, so the benchmark also finishes on a single core machine). The payload
+ * is a 64 bit integer so that only the hand-off cost is measured.
+ *
+ * Build:
+ * g++ -O2 -std=c++14 -pthread ringBufferBenchmark.cpp -o ringBufferBenchmark
+ *
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include "../source_pc/RingBuffer.h"
+
+#define NUM_ITEMS 1000000
+#define QUEUE_SIZE 64
+
+
+/*
+ * struct LegacyQueue
+ *
+ * Description:
+ * The original circular queue (front/rear indices, -1 when empty) that QueueMat/QueuePkt implemented.
+ * Kept here only as the benchmark baseline.
+ *
+ */
+template <typename T>
+struct LegacyQueue
+{
+    int rear, front;
+    int size;
+    std::vector<T> buffer;
+
+    LegacyQueue(int s)
+    {
+        front = rear = -1;
+        size = s;
+        buffer.resize(size);
+    }
+
+    bool enQueue(T& item)
+    {
+        if ((front == 0 && rear == size - 1) ||
+            (rear == (front - 1) % (size - 1)))
+            return false;
+        else if (front == -1)
+            front = rear = 0;
+        else if (rear == size - 1 && front != 0)
+            rear = 0;
+        else
+            rear++;
+
+        buffer[rear] = item;
+        return true;
+    }
+
+    bool deQueue(T& item)
+    {
+        if (front == -1)
+            return false;
+
+        item = buffer[front];
+
+        if (front == rear)
+            front = rear = -1;
+        else if (front == size - 1)
+            front = 0;
+        else
+            front++;
+
+        return true;
+    }
+};
+
+
+/*
+ * double runMutexQueue(uint64_t& checksum)
+ *
+ * Description:
+ * Transfer NUM_ITEMS through the legacy queue, locking a mutex around every call.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		uint64_t& checksum       sum of every item received (used to check nothing was lost)
+ *		double (return val)      elapsed seconds
+ */
+double runMutexQueue(uint64_t& checksum)
+{
+    LegacyQueue<uint64_t> queue(QUEUE_SIZE);
+    std::mutex queueMutex;
+    checksum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread producer([&]()
+    {
+        for (uint64_t i = 0; i < NUM_ITEMS; i++)
+        {
+            bool success;
+            do
+            {
+                queueMutex.lock();
+                success = queue.enQueue(i);
+                queueMutex.unlock();
+                if (!success)
+                    std::this_thread::yield();
+            } while (!success);
+        }
+    });
+
+    uint64_t item;
+    for (uint64_t i = 0; i < NUM_ITEMS; i++)
+    {
+        bool success;
+        do
+        {
+            queueMutex.lock();
+            success = queue.deQueue(item);
+            queueMutex.unlock();
+            if (!success)
+                std::this_thread::yield();
+        } while (!success);
+        checksum += item;
+    }
+
+    producer.join();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+/*
+ * double runRingBuffer(uint64_t& checksum)
+ *
+ * Description:
+ * Transfer NUM_ITEMS through the lock-free RingBuffer.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		uint64_t& checksum       sum of every item received (used to check nothing was lost)
+ *		double (return val)      elapsed seconds
+ */
+double runRingBuffer(uint64_t& checksum)
+{
+    static RingBuffer<uint64_t, QUEUE_SIZE> queue;
+    checksum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread producer([&]()
+    {
+        for (uint64_t i = 0; i < NUM_ITEMS; i++)
+        {
+            while (!queue.enQueue(i))
+                std::this_thread::yield();
+        }
+    });
+
+    uint64_t item;
+    for (uint64_t i = 0; i < NUM_ITEMS; i++)
+    {
+        while (!queue.deQueue(item))
+            std::this_thread::yield();
+        checksum += item;
+    }
+
+    producer.join();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+int main()
+{
+    const uint64_t expected = uint64_t(NUM_ITEMS) * (NUM_ITEMS - 1) / 2;
+    uint64_t checksum;
+
+    double tMutex = runMutexQueue(checksum);
+    bool okMutex = (checksum == expected);
+
+    double tRing = runRingBuffer(checksum);
+    bool okRing = (checksum == expected);
+
+    std::cout << std::fixed << std::setprecision(1);
+    if (std::thread::hardware_concurrency() < 2)
+        std::cout << "WARNING: single core machine, both queues are limited by the scheduler" << std::endl;
+    std::cout << "items: " << NUM_ITEMS << ", queue size: " << QUEUE_SIZE << std::endl;
+    std::cout << "mutex + queue:  " << (tMutex * 1e9 / NUM_ITEMS) << " ns/item" << (okMutex ? "" : "  (CHECKSUM MISMATCH)") << std::endl;
+    std::cout << "RingBuffer:     " << (tRing * 1e9 / NUM_ITEMS) << " ns/item" << (okRing ? "" : "  (CHECKSUM MISMATCH)") << std::endl;
+    std::cout << "speedup:        " << std::setprecision(2) << (tMutex / tRing) << "x" << std::endl;
+
+    return (okMutex && okRing) ? 0 : 1;
+}
@@ -0,0 +1,136 @@
+/*
+ * Author:  Jordan Leiker
+ * Class: ECE6122
+ * Last Date Modified: 10/16/2026
+ *
+ * Description:
+ * Microbenchmark for the 180 degree rotation applied to every frame when the camera is mounted upside down.
+ * Compares:
+ *   (1) the original flipMat(): a new zeroed Mat per frame, filled pixel by pixel with at<Vec3b>()
+ *   (2) cv::flip(src, dst, -1)
+ *   (3) rotate180() from one buffer into another (what the motion tracker does)
+ *   (4) rotate180() in place
+ * Every variant is checked against cv::flip for exactness before it is timed.
+ *
+ * Build:
+ * g++ -O2 -std=c++14 rotateBenchmark.cpp ../source_pc/FrameRotate.cpp `pkg-config --cflags --libs opencv4` -o rotateBenchmark
+ *
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <functional>
+#include <opencv2/opencv.hpp>
+#include "../source_pc/FrameRotate.h"
+
+#define NUM_ITERATIONS 500
+
+
+/*
+ * cv::Mat flipMatLegacy(const cv::Mat& inImage)
+ *
+ * Description:
+ * The original per-pixel flip from motionTracker_v010.cpp. Kept here only as the benchmark baseline.
+ *
+ * Inputs:
+ *		const cv::Mat& inImage       image to flip
+ *
+ * Outputs:
+ *		cv::Mat (return val)         flipped image
+ */
+cv::Mat flipMatLegacy(const cv::Mat& inImage)
+{
+    cv::Mat outImage = cv::Mat::zeros(inImage.rows, inImage.cols, CV_8UC3);
+
+    for (int row = 0; row < inImage.rows; row++)
+    {
+        for (int col = 0; col < inImage.cols; col++)
+        {
+            outImage.at<cv::Vec3b>((inImage.rows - 1) - row, (inImage.cols - 1) - col) = inImage.at<cv::Vec3b>(row, col);
+        }
+    }
+
+    return outImage;
+}
+
+
+/*
+ * double timeIt(std::function<void(void)> fn)
+ *
+ * Description:
+ * Run fn NUM_ITERATIONS times (after one warm up call).
+ *
+ * Inputs:
+ *		std::function<void(void)> fn   work to time
+ *
+ * Outputs:
+ *		double (return val)            average milliseconds per call
+ */
+double timeIt(std::function<void(void)> fn)
+{
+    fn();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < NUM_ITERATIONS; i++)
+        fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / NUM_ITERATIONS;
+}
+
+
+/*
+ * bool benchmarkSize(int rows, int cols)
+ *
+ * Description:
+ * Check and time every variant for one frame size.
+ *
+ * Inputs:
+ *		int rows                     frame height
+ *		int cols                     frame width
+ *
+ * Outputs:
+ *		bool (return val)            true if every variant matched cv::flip
+ */
+bool benchmarkSize(int rows, int cols)
+{
+    cv::Mat src(rows, cols, CV_8UC3), dst, ref, inPlace;
+    cv::randu(src, cv::Scalar::all(0), cv::Scalar::all(256));
+    cv::flip(src, ref, -1);
+
+    // Accuracy
+    rotate180(src, dst);
+    bool okOut = cv::norm(dst, ref, cv::NORM_INF) == 0;
+    inPlace = src.clone();
+    rotate180(inPlace, inPlace);
+    bool okIn = cv::norm(inPlace, ref, cv::NORM_INF) == 0;
+    bool okLegacy = cv::norm(flipMatLegacy(src), ref, cv::NORM_INF) == 0;
+
+    // Speed
+    cv::Mat out;
+    double tLegacy = timeIt([&]() { out = flipMatLegacy(src); });
+    double tFlip = timeIt([&]() { cv::flip(src, dst, -1); });
+    double tOut = timeIt([&]() { rotate180(src, dst); });
+    double tIn = timeIt([&]() { rotate180(inPlace, inPlace); });
+
+    std::cout << cols << "x" << rows << std::endl;
+    std::cout << "  flipMat (original):     " << tLegacy << " ms" << (okLegacy ? "" : "  (MISMATCH)") << std::endl;
+    std::cout << "  cv::flip:               " << tFlip << " ms" << std::endl;
+    std::cout << "  rotate180 (copy):       " << tOut << " ms  " << std::setprecision(1) << (tLegacy / tOut) << "x" << std::setprecision(3)
+        << (okOut ? "" : "  (MISMATCH)") << std::endl;
+    std::cout << "  rotate180 (in place):   " << tIn << " ms  " << std::setprecision(1) << (tLegacy / tIn) << "x" << std::setprecision(3)
+        << (okIn ? "" : "  (MISMATCH)") << std::endl;
+
+    return okOut && okIn && okLegacy;
+}
+
+
+int main()
+{
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "rotate180 kernel: " << rotate180Kernel() << ", " << NUM_ITERATIONS << " iterations" << std::endl;
+
+    bool ok = benchmarkSize(480, 640);
+    ok = benchmarkSize(720, 1280) && ok;
+    ok = benchmarkSize(37, 45) && ok; // odd sizes exercise the scalar tails and the middle row of the in place path
+
+    return ok ? 0 : 1;
+}
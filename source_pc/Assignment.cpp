@@ -0,0 +1,354 @@
+/*
+ * Author:  Jordan Leiker
+ * Class: ECE6122
+ * Last Date Modified: 10/16/2026
+ *
+ * Description:
+ * This is the functional code for the detection to track assignment (see Assignment.h).
+ *
+ */
+
+#include "Assignment.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Cost of a pair that is not allowed (farther apart than the gate). Large enough to never be picked over leaving
+// both unassigned, small enough that sums of it stay exact in a double.
+#define ASSIGNMENT_FORBIDDEN 1e12
+
+
+/*
+ * int findRoot(std::vector<int>& parent, int i)
+ *
+ * Description:
+ * Union-find lookup with path halving.
+ *
+ * Inputs:
+ *		std::vector<int>& parent	union-find parents (updated to shorten the path)
+ *		int i						element
+ *
+ * Outputs:
+ *		int (return val)			root of the set i is in
+ */
+static int findRoot(std::vector<int>& parent, int i)
+{
+    while (parent[i] != i)
+    {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+
+/*
+ * int gridCell(float coord, float cellSize)
+ *
+ * Description:
+ * Grid cell a coordinate falls in. Clamped so a wild coordinate can't overflow the neighbour lookup (points that
+ * share a clamped cell are still checked by distance).
+ *
+ * Inputs:
+ *		float coord					x or y (pixels)
+ *		float cellSize				cell size (pixels)
+ *
+ * Outputs:
+ *		int (return val)			cell index
+ */
+static int gridCell(float coord, float cellSize)
+{
+    return int(std::max(-1e6f, std::min(1e6f, std::floor(coord / cellSize))));
+}
+
+
+/*
+ * void countsToStarts(std::vector<int>& counts)
+ *
+ * Description:
+ * Turn per group counts (counts[g + 1] = size of group g, counts[0] = 0) into where each group starts in the flat
+ * list, in place.
+ *
+ * Inputs:
+ *		std::vector<int>& counts	counts, one more entry than there are groups
+ *
+ * Outputs:
+ *		std::vector<int>& counts	start of each group, and the total at the end
+ */
+static void countsToStarts(std::vector<int>& counts)
+{
+    for (size_t g = 1; g < counts.size(); g++)
+        counts[g] += counts[g - 1];
+}
+
+
+/*
+ * void solveHungarian(AssignmentWorkspace& work, int n)
+ *
+ * Description:
+ * Minimum cost perfect matching of a square cost matrix (Hungarian algorithm, O(n^3)): rows are added one at a
+ * time, each along the shortest augmenting path under the current row/column potentials.
+ *
+ * Inputs:
+ *		AssignmentWorkspace& work	work.cost: n x n cost matrix, row major
+ *		int n						size
+ *
+ * Outputs:
+ *		AssignmentWorkspace& work	work.rowToCol: column matched to each row
+ */
+static void solveHungarian(AssignmentWorkspace& work, int n)
+{
+    const double inf = std::numeric_limits<double>::infinity();
+    std::vector<double>& u = work.u;
+    std::vector<double>& v = work.v;
+    std::vector<double>& minv = work.minv;
+    std::vector<int>& colToRow = work.colToRow;
+    std::vector<int>& way = work.way;
+    std::vector<char>& used = work.used;
+
+    // 1 based, row/column 0 is the start of every augmenting path
+    u.assign(n + 1, 0.0);
+    v.assign(n + 1, 0.0);
+    minv.resize(n + 1);
+    colToRow.assign(n + 1, 0);
+    way.assign(n + 1, 0);
+    used.resize(n + 1);
+
+    for (int row = 1; row <= n; row++)
+    {
+        colToRow[0] = row;
+        int col0 = 0;
+        std::fill(minv.begin(), minv.end(), inf);
+        std::fill(used.begin(), used.end(), 0);
+
+        // Grow the shortest path tree from row until it reaches a free column
+        do
+        {
+            used[col0] = 1;
+            int row0 = colToRow[col0], col1 = 0;
+            const double* c = &work.cost[(row0 - 1) * n];
+            double delta = inf;
+
+            for (int col = 1; col <= n; col++)
+            {
+                if (used[col])
+                    continue;
+                double reduced = c[col - 1] - u[row0] - v[col];
+                if (reduced < minv[col])
+                {
+                    minv[col] = reduced;
+                    way[col] = col0;
+                }
+                if (minv[col] < delta)
+                {
+                    delta = minv[col];
+                    col1 = col;
+                }
+            }
+
+            for (int col = 0; col <= n; col++)
+            {
+                if (used[col])
+                {
+                    u[colToRow[col]] += delta;
+                    v[col] -= delta;
+                }
+                else
+                    minv[col] -= delta;
+            }
+            col0 = col1;
+        } while (colToRow[col0] != 0);
+
+        // Flip the matching along the path
+        do
+        {
+            int col1 = way[col0];
+            colToRow[col0] = colToRow[col1];
+            col0 = col1;
+        } while (col0);
+    }
+
+    work.rowToCol.assign(n, -1);
+    for (int col = 1; col <= n; col++)
+        work.rowToCol[colToRow[col] - 1] = col - 1;
+}
+
+
+/*
+ * void assignDetections(const std::vector<cv::Point2f>& tracks, const std::vector<cv::Point2f>& detections,
+ *                       float costOfNonAssignment, std::vector<std::pair<int, int>>& assignments,
+ *                       std::vector<int>& unassignedTracks, std::vector<int>& unassignedDetections,
+ *                       AssignmentWorkspace& work)
+ *
+ * Description:
+ * Find the assignment of detections to tracks with the lowest total cost (see Assignment.h).
+ *
+ * Inputs:
+ *		const std::vector<cv::Point2f>& tracks			predicted track positions
+ *		const std::vector<cv::Point2f>& detections		detected object positions
+ *		float costOfNonAssignment						cost of leaving a track or a detection unassigned (pixels)
+ *		AssignmentWorkspace& work						scratch buffers, reused from call to call
+ *
+ * Outputs:
+ *		std::vector<std::pair<int, int>>& assignments	(track index, detection index) pairs
+ *		std::vector<int>& unassignedTracks				tracks with no detection
+ *		std::vector<int>& unassignedDetections			detections with no track
+ */
+void assignDetections(const std::vector<cv::Point2f>& tracks, const std::vector<cv::Point2f>& detections,
+                      float costOfNonAssignment, std::vector<std::pair<int, int>>& assignments,
+                      std::vector<int>& unassignedTracks, std::vector<int>& unassignedDetections,
+                      AssignmentWorkspace& work)
+{
+    const int numTracks = int(tracks.size());
+    const int numDetections = int(detections.size());
+    const int numNodes = numTracks + numDetections;
+    const float gate = 2.0f * costOfNonAssignment; // a pair this far apart costs as much as leaving both unassigned
+
+    assignments.clear();
+    unassignedTracks.clear();
+    unassignedDetections.clear();
+
+    // Grid of detections, gate x gate cells, as (cell, detection) sorted by cell
+    work.grid.clear();
+    work.candidates.clear();
+    if (gate > 0 && numTracks > 0 && numDetections > 0)
+    {
+        for (int d = 0; d < numDetections; d++)
+            work.grid.push_back({ { gridCell(detections[d].y, gate), gridCell(detections[d].x, gate) }, d });
+        std::sort(work.grid.begin(), work.grid.end());
+
+        for (int t = 0; t < numTracks; t++)
+        {
+            int cellY = gridCell(tracks[t].y, gate);
+            int cellX = gridCell(tracks[t].x, gate);
+            for (int dy = -1; dy <= 1; dy++)
+            {
+                for (int dx = -1; dx <= 1; dx++)
+                {
+                    std::pair<int, int> cell(cellY + dy, cellX + dx);
+                    auto it = std::lower_bound(work.grid.begin(), work.grid.end(), std::make_pair(cell, -1));
+                    for (; it != work.grid.end() && it->first == cell; ++it)
+                    {
+                        double dist = cv::norm(tracks[t] - detections[it->second]);
+                        if (dist < gate)
+                            work.candidates.push_back({ t, it->second, dist });
+                    }
+                }
+            }
+        }
+    }
+
+    // Tracks (0..numTracks-1) and detections (numTracks..) that share a candidate pair are in the same group
+    work.parent.resize(numNodes);
+    work.hasCandidate.assign(numNodes, 0);
+    for (int i = 0; i < numNodes; i++)
+        work.parent[i] = i;
+    for (const AssignmentCandidate& pair : work.candidates)
+    {
+        work.hasCandidate[pair.track] = work.hasCandidate[numTracks + pair.detection] = 1;
+        int a = findRoot(work.parent, pair.track), b = findRoot(work.parent, numTracks + pair.detection);
+        if (a != b)
+            work.parent[b] = a;
+    }
+
+    // Number the groups, and each track/detection within its group. Anything without a candidate is unassigned.
+    // trackStart/detectionStart count each group's members (shifted by one) until countsToStarts().
+    work.groupOf.assign(numNodes, -1);
+    work.localIdx.assign(numNodes, -1);
+    work.trackStart.assign(1, 0);
+    work.detectionStart.assign(1, 0);
+    for (int node = 0; node < numNodes; node++)
+    {
+        if (!work.hasCandidate[node])
+        {
+            if (node < numTracks)
+                unassignedTracks.push_back(node);
+            else
+                unassignedDetections.push_back(node - numTracks);
+            continue;
+        }
+
+        int root = findRoot(work.parent, node);
+        if (work.groupOf[root] < 0)
+        {
+            work.groupOf[root] = int(work.trackStart.size()) - 1;
+            work.trackStart.push_back(0);
+            work.detectionStart.push_back(0);
+        }
+        int group = work.groupOf[root];
+        work.groupOf[node] = group;
+        work.localIdx[node] = (node < numTracks) ? work.trackStart[group + 1]++ : work.detectionStart[group + 1]++;
+    }
+    const int numGroups = int(work.trackStart.size()) - 1;
+    countsToStarts(work.trackStart);
+    countsToStarts(work.detectionStart);
+
+    work.groupTracks.resize(work.trackStart[numGroups]);
+    work.groupDetections.resize(work.detectionStart[numGroups]);
+    for (int node = 0; node < numNodes; node++)
+    {
+        int group = work.groupOf[node];
+        if (group < 0)
+            continue;
+        if (node < numTracks)
+            work.groupTracks[work.trackStart[group] + work.localIdx[node]] = node;
+        else
+            work.groupDetections[work.detectionStart[group] + work.localIdx[node]] = node - numTracks;
+    }
+
+    // Candidate pairs by group, in the order they were found
+    work.candidateStart.assign(numGroups + 1, 0);
+    for (const AssignmentCandidate& pair : work.candidates)
+        work.candidateStart[work.groupOf[pair.track] + 1]++;
+    countsToStarts(work.candidateStart);
+    work.groupCandidates.resize(work.candidates.size());
+    for (const AssignmentCandidate& pair : work.candidates)
+        work.groupCandidates[work.candidateStart[work.groupOf[pair.track]]++] = pair;
+    for (int g = numGroups; g > 0; g--) // the fill moved each start to the next group's, move them back
+        work.candidateStart[g] = work.candidateStart[g - 1];
+    work.candidateStart[0] = 0;
+
+    // Solve each group on the matrix Matlab's assignDetectionsToTracks builds:
+    //		[ cost (tracks x detections)          costOfNonAssignment on the diagonal (tracks x tracks) ]
+    //		[ costOfNonAssignment on the diagonal (detections x detections)          0                  ]
+    // everything else forbidden. A track matched to its diagonal, or a detection to its, is unassigned.
+    for (int g = 0; g < numGroups; g++)
+    {
+        const int* groupTracks = &work.groupTracks[work.trackStart[g]];
+        const int* groupDetections = &work.groupDetections[work.detectionStart[g]];
+        const int nt = work.trackStart[g + 1] - work.trackStart[g];
+        const int nd = work.detectionStart[g + 1] - work.detectionStart[g];
+        const int n = nt + nd;
+        work.cost.assign(size_t(n) * n, ASSIGNMENT_FORBIDDEN);
+
+        for (int c = work.candidateStart[g]; c < work.candidateStart[g + 1]; c++)
+        {
+            const AssignmentCandidate& pair = work.groupCandidates[c];
+            work.cost[work.localIdx[pair.track] * n + work.localIdx[numTracks + pair.detection]] = pair.cost;
+        }
+        for (int t = 0; t < nt; t++)
+            work.cost[t * n + nd + t] = costOfNonAssignment;
+        for (int d = 0; d < nd; d++)
+        {
+            work.cost[(nt + d) * n + d] = costOfNonAssignment;
+            for (int t = 0; t < nt; t++)
+                work.cost[(nt + d) * n + nd + t] = 0.0;
+        }
+
+        solveHungarian(work, n);
+
+        for (int row = 0; row < n; row++)
+        {
+            int col = work.rowToCol[row];
+            if (row < nt && col < nd)
+                assignments.push_back({ groupTracks[row], groupDetections[col] });
+            else if (row < nt)
+                unassignedTracks.push_back(groupTracks[row]);
+            else if (col < nd)
+                unassignedDetections.push_back(groupDetections[col]);
+        }
+    }
+
+    std::sort(unassignedTracks.begin(), unassignedTracks.end());
+    std::sort(unassignedDetections.begin(), unassignedDetections.end());
+}
@@ -0,0 +1,96 @@
+/*
+ * Author:  Jordan Leiker
+ * Class: ECE6122
+ * Last Date Modified: 10/16/2026
+ *
+ * Description:
+ * This is the header file for the detection to track assignment used by MotionTracker, the equivalent of the Matlab
+ * assignDetectionsToTracks(cost, costOfNonAssignment) the tracking algorithm was ported from.
+ *
+ * The cost of giving a detection to a track is the distance between the detection and the track's predicted
+ * position. Leaving a track or a detection unassigned costs costOfNonAssignment each, so a pair is only ever
+ * assigned if it is closer than 2 * costOfNonAssignment, and then only if that gives the lowest total cost over all
+ * tracks and detections (which is what keeps two objects crossing each other on their own tracks).
+ *
+ * Only pairs closer than 2 * costOfNonAssignment can be assigned, so the detections are put in a uniform grid with
+ * cells that size and each track only looks at the 3x3 cells around it. The candidate pairs split the tracks and
+ * detections into independent groups (objects far apart never compete), and each group is solved exactly with the
+ * Hungarian algorithm (shortest augmenting paths with potentials, as in Jonker-Volgenant) on its own small cost
+ * matrix. Hundreds of tracks spread over a frame cost about as much as the same number of isolated pairs.
+ *
+ */
+
+#pragma once
+#include <vector>
+#include <utility>
+#include <opencv2/opencv.hpp>
+
+
+/*
+ * struct AssignmentCandidate
+ *
+ * Description:
+ * A track and a detection close enough to be assigned to each other.
+ *
+ */
+struct AssignmentCandidate
+{
+	int track;
+	int detection;
+	double cost;
+};
+
+
+/*
+ * struct AssignmentWorkspace
+ *
+ * Description:
+ * Everything assignDetections() works in. Keep one between calls (e.g. as a member of the tracker) and once its
+ * buffers have grown to the busiest frame's size, assigning no longer allocates. The groups are stored flat: group
+ * g's tracks are groupTracks[trackStart[g]] to groupTracks[trackStart[g + 1] - 1], and the same for its detections
+ * and candidate pairs.
+ *
+ */
+struct AssignmentWorkspace
+{
+	std::vector<std::pair<std::pair<int, int>, int>> grid;	// (cell, detection), sorted by cell
+	std::vector<AssignmentCandidate> candidates;			// pairs closer than the gate
+	std::vector<int> parent;								// union-find over tracks then detections
+	std::vector<char> hasCandidate;
+	std::vector<int> groupOf;								// group of each track/detection
+	std::vector<int> localIdx;								// index of each track/detection within its group
+	std::vector<int> trackStart, detectionStart, candidateStart;
+	std::vector<int> groupTracks, groupDetections;
+	std::vector<AssignmentCandidate> groupCandidates;
+	std::vector<double> cost;								// one group's cost matrix
+	std::vector<int> rowToCol;
+	std::vector<double> u, v, minv;							// Hungarian potentials and path lengths
+	std::vector<int> colToRow, way;
+	std::vector<char> used;
+};
+
+
+/*
+ * void assignDetections(const std::vector<cv::Point2f>& tracks, const std::vector<cv::Point2f>& detections,
+ *                       float costOfNonAssignment, std::vector<std::pair<int, int>>& assignments,
+ *                       std::vector<int>& unassignedTracks, std::vector<int>& unassignedDetections,
+ *                       AssignmentWorkspace& work);
+ *
+ * Description:
+ * Find the assignment of detections to tracks with the lowest total cost (see above).
+ *
+ * Inputs:
+ *		const std::vector<cv::Point2f>& tracks			predicted track positions
+ *		const std::vector<cv::Point2f>& detections		detected object positions
+ *		float costOfNonAssignment						cost of leaving a track or a detection unassigned (pixels)
+ *		AssignmentWorkspace& work						scratch buffers, reused from call to call
+ *
+ * Outputs:
+ *		std::vector<std::pair<int, int>>& assignments	(track index, detection index) pairs
+ *		std::vector<int>& unassignedTracks				tracks with no detection
+ *		std::vector<int>& unassignedDetections			detections with no track
+ */
+void assignDetections(const std::vector<cv::Point2f>& tracks, const std::vector<cv::Point2f>& detections,
+                      float costOfNonAssignment, std::vector<std::pair<int, int>>& assignments,
+                      std::vector<int>& unassignedTracks, std::vector<int>& unassignedDetections,
+                      AssignmentWorkspace& work);
@@ -0,0 +1,184 @@
+/*
+ * Author:  Jordan Leiker
+ * Class: ECE6122
+ * Last Date Modified: 10/16/2026
+ *
+ * Description:
+ * This is the functional code for the connected components blob extraction (see BlobExtract.h).
+ *
+ */
+
+#include "BlobExtract.h"
+#include <algorithm>
+#include <cmath>
+
+
+/*
+ * int findRoot(std::vector<int>& parent, int i)
+ *
+ * Description:
+ * Union-find lookup with path halving.
+ *
+ * Inputs:
+ *		std::vector<int>& parent	union-find parents (updated to shorten the path)
+ *		int i						element
+ *
+ * Outputs:
+ *		int (return val)			root of the set i is in
+ */
+static int findRoot(std::vector<int>& parent, int i)
+{
+    while (parent[i] != i)
+    {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+
+/*
+ * void unite(std::vector<int>& parent, std::vector<int>& rank, int a, int b)
+ *
+ * Description:
+ * Union-find merge of the sets a and b are in (union by rank).
+ *
+ * Inputs:
+ *		int a, int b				elements
+ *
+ * Outputs:
+ *		std::vector<int>& parent	union-find parents
+ *		std::vector<int>& rank		union-find ranks
+ */
+static void unite(std::vector<int>& parent, std::vector<int>& rank, int a, int b)
+{
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if (a == b)
+        return;
+    if (rank[a] < rank[b])
+        std::swap(a, b);
+    parent[b] = a;
+    if (rank[a] == rank[b])
+        rank[a]++;
+}
+
+
+/*
+ * void extractBlobs(const cv::Mat& mask, const BlobParams& params, std::vector<blob>& blobs)
+ *
+ * Description:
+ * Find the blobs in a binary mask: label the connected components, merge the ones closer than
+ * params.minDistBetweenBlobs and keep the merged blobs with an area in [params.minArea, params.maxArea].
+ *
+ * Inputs:
+ *		const cv::Mat& mask			CV_8UC1 mask, non-zero = foreground
+ *		const BlobParams& params	area limits, merge distance and connectivity
+ *
+ * Outputs:
+ *		std::vector<blob>& blobs	detected blobs, largest first
+ */
+void extractBlobs(const cv::Mat& mask, const BlobParams& params, std::vector<blob>& blobs)
+{
+    // Kept between calls (one set per thread), the label image is the size of a frame
+    static thread_local cv::Mat labels, stats, centroids;
+    static thread_local std::vector<int> parent, rank, order;
+    static thread_local std::vector<blob> merged;
+
+    blobs.clear();
+
+    // Label 0 is the background
+    int numLabels = cv::connectedComponentsWithStats(mask, labels, stats, centroids, params.connectivity, CV_32S);
+    if (numLabels <= 1)
+        return;
+
+    parent.resize(numLabels);
+    rank.assign(numLabels, 0);
+    for (int i = 0; i < numLabels; i++)
+        parent[i] = i;
+
+    // Merge components whose bounding boxes are less than minDistBetweenBlobs apart. Going through them by left edge,
+    // each component only has to be compared with the ones that start before its right edge + minDistBetweenBlobs.
+    if (params.minDistBetweenBlobs > 0)
+    {
+        const int* s = stats.ptr<int>();
+        const int cols = stats.cols;
+        const float minDist = params.minDistBetweenBlobs;
+
+        order.resize(numLabels - 1);
+        for (int i = 1; i < numLabels; i++)
+            order[i - 1] = i;
+        std::sort(order.begin(), order.end(), [s, cols](int a, int b)
+            { return s[a * cols + cv::CC_STAT_LEFT] < s[b * cols + cv::CC_STAT_LEFT]; });
+
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            const int* a = s + order[i] * cols;
+            int aRight = a[cv::CC_STAT_LEFT] + a[cv::CC_STAT_WIDTH];
+            int aBottom = a[cv::CC_STAT_TOP] + a[cv::CC_STAT_HEIGHT];
+
+            for (size_t j = i + 1; j < order.size(); j++)
+            {
+                const int* b = s + order[j] * cols;
+                float gapX = float(std::max(0, b[cv::CC_STAT_LEFT] - aRight));
+                if (gapX >= minDist)
+                    break; // every later component starts even further right
+
+                float gapY = float(std::max(0, std::max(a[cv::CC_STAT_TOP], b[cv::CC_STAT_TOP]) -
+                    std::min(aBottom, b[cv::CC_STAT_TOP] + b[cv::CC_STAT_HEIGHT])));
+                if (gapX * gapX + gapY * gapY < minDist * minDist)
+                    unite(parent, rank, order[i], order[j]);
+            }
+        }
+    }
+
+    // Sum up each merged blob at its root: area, box, and the area weighted centroid
+    merged.assign(numLabels, blob());
+    for (int i = 1; i < numLabels; i++)
+    {
+        const int* s = stats.ptr<int>(i);
+        const double* c = centroids.ptr<double>(i);
+        cv::Rect box(s[cv::CC_STAT_LEFT], s[cv::CC_STAT_TOP], s[cv::CC_STAT_WIDTH], s[cv::CC_STAT_HEIGHT]);
+        int area = s[cv::CC_STAT_AREA];
+
+        blob& root = merged[findRoot(parent, i)];
+        root.bbox = root.area ? (root.bbox | box) : box;
+        root.centroid.x += float(c[0] * area);
+        root.centroid.y += float(c[1] * area);
+        root.area += area;
+    }
+
+    for (int i = 1; i < numLabels; i++)
+    {
+        blob& b = merged[i];
+        if (b.area == 0 || b.area < params.minArea || (params.maxArea > 0 && b.area > params.maxArea))
+            continue;
+        b.centroid.x /= b.area;
+        b.centroid.y /= b.area;
+        blobs.push_back(b);
+    }
+
+    std::sort(blobs.begin(), blobs.end(), [](const blob& a, const blob& b) { return a.area > b.area; });
+}
+
+
+/*
+ * void blobsToKeyPoints(const std::vector<blob>& blobs, std::vector<cv::KeyPoint>& keypoints)
+ *
+ * Description:
+ * Convert blobs to the KeyPoints SimpleBlobDetector would have given (centroid, and the diameter of a circle with
+ * the blob's area as the size), for code that still works on KeyPoints.
+ *
+ * Inputs:
+ *		const std::vector<blob>& blobs	blobs
+ *
+ * Outputs:
+ *		std::vector<cv::KeyPoint>& keypoints	one KeyPoint per blob
+ */
+void blobsToKeyPoints(const std::vector<blob>& blobs, std::vector<cv::KeyPoint>& keypoints)
+{
+    keypoints.clear();
+    keypoints.reserve(blobs.size());
+    for (const blob& b : blobs)
+        keypoints.push_back(cv::KeyPoint(b.centroid, 2.0f * std::sqrt(b.area / float(CV_PI))));
+}
@@ -0,0 +1,87 @@
+/*
+ * Author:  Jordan Leiker
+ * Class: ECE6122
+ * Last Date Modified: 10/16/2026
+ *
+ * Description:
+ * This is the header file for the connected components blob extraction used by MotionTracker to find moving
+ * objects in the foreground mask, in place of cv::SimpleBlobDetector.
+ *
+ * SimpleBlobDetector re-thresholds the (already binary) mask, runs findContours and computes moments per contour,
+ * then compares every blob center with every other one to merge close blobs, and in the end only gives back a
+ * center and a size. extractBlobs() instead labels the mask in one pass (cv::connectedComponentsWithStats), which
+ * gives the area, bounding box and centroid of every component directly. Components that are close together
+ * (a person broken up by a tree, say) are merged with a union-find, only comparing components whose bounding boxes
+ * are near each other along x, and the merged blobs are filtered by area. Each blob comes out with a real box.
+ *
+ */
+
+#pragma once
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+
+/*
+ * struct BlobParams
+ *
+ * Description:
+ * Settings for extractBlobs(). The names follow cv::SimpleBlobDetector::Params where they mean the same thing.
+ *
+ */
+struct BlobParams
+{
+	int minArea;					// smallest blob kept (pixels, after merging)
+	int maxArea;					// largest blob kept (pixels, after merging). 0 = no limit
+	float minDistBetweenBlobs;		// components whose bounding boxes are closer than this are one blob (pixels). 0 = no merging
+	int connectivity;				// 4 or 8
+
+	BlobParams() : minArea(400), maxArea(0), minDistBetweenBlobs(50.0f), connectivity(8) {}
+};
+
+
+/*
+ * struct blob
+ *
+ * Description:
+ * One detected object.
+ *
+ */
+struct blob
+{
+	cv::Rect bbox;					// bounding box of all its pixels
+	cv::Point2f centroid;			// center of mass of its pixels
+	int area;						// number of pixels
+};
+
+
+/*
+ * void extractBlobs(const cv::Mat& mask, const BlobParams& params, std::vector<blob>& blobs);
+ *
+ * Description:
+ * Find the blobs in a binary mask: label the connected components, merge the ones closer than
+ * params.minDistBetweenBlobs and keep the merged blobs with an area in [params.minArea, params.maxArea].
+ *
+ * Inputs:
+ *		const cv::Mat& mask			CV_8UC1 mask, non-zero = foreground
+ *		const BlobParams& params	area limits, merge distance and connectivity
+ *
+ * Outputs:
+ *		std::vector<blob>& blobs	detected blobs, largest first
+ */
+void extractBlobs(const cv::Mat& mask, const BlobParams& params, std::vector<blob>& blobs);
+
+
+/*
+ * void blobsToKeyPoints(const std::vector<blob>& blobs, std::vector<cv::KeyPoint>& keypoints);
+ *
+ * Description:
+ * Convert blobs to the KeyPoints SimpleBlobDetector would have given (centroid, and the diameter of a circle with
+ * the blob's area as the size), for code that still works on KeyPoints.
+ *
+ * Inputs:
+ *		const std::vector<blob>& blobs	blobs
+ *
+ * Outputs:
+ *		std::vector<cv::KeyPoint>& keypoints	one KeyPoint per blob
+ */
+void blobsToKeyPoints(const std::vector<blob>& blobs, std::vector<cv::KeyPoint>& keypoints);
@@ -1,185 +1,135 @@
 /*
  * Author:  Jordan Leiker
  * Class: ECE6122
- * Last Date Modified: 11/14/2020
+ * Last Date Modified: 10/16/2026
  *
  * Description:
- * This is the functional code for two ciruclar buffers. They are identical except for the type of data they hold.
- * All of the code has been taken directly from (with light modifications):
- * https://www.geeksforgeeks.org/circular-queue-set-1-introduction-array-implementation/
- *
- * The two circular queues hold (1) cv::Mat frames and (2) "struct packet" type.
+ * This is the functional code for the PacketRef handle that moves encoded packets through the circular buffers.
  *
  */
 
+#include <iostream>
+#include <cstdlib>
 #include "CircularFrameBuf.h"
 
 
 /*
- * bool enQueue(cv::Mat& frame);
+ * PacketRef(void) :
  *
  * Description:
- * Struct function to add items to the queue
+ * Constructor. Allocates the AVPacket this handle keeps for its whole lifetime, it starts out with no data.
+ * Exits if FFMPEG cannot allocate it (same as the rest of the codec setup).
  *
  * Inputs:
- *		cv::Mat& frame       frame to copy into queue
+ *		N/A
  *
  * Outputs:
- *		bool (return val)    indicates success of placing into queue
+ *		N/A
  */
-bool QueueMat::enQueue(cv::Mat& frame)
+PacketRef::PacketRef(void)
 {
-    if ((front == 0 && rear == size - 1) ||
-        (rear == (front - 1) % (size - 1)))
-    {
-#ifdef DEBUG
-        std::cout << "Frame queue is Full" << std::endl;
-#endif
-        return false;
-    }
-
-    else if (front == -1) /* Insert First Element */
-    {
-        front = rear = 0;
-        buffer[rear] = frame.clone();
-    }
-
-    else if (rear == size - 1 && front != 0)
+    pkt = av_packet_alloc();
+    if (!pkt)
     {
-        rear = 0;
-        buffer[rear] = frame.clone();
+        std::cerr << "Could not allocate packet" << std::endl;
+        exit(1);
     }
-
-    else
-    {
-        rear++;
-        buffer[rear] = frame.clone();
-    }
-
-    return true;
 }
 
 
 /*
- * bool deQueue(cv::Mat& frame);
+ * PacketRef(PacketRef&& other) :
  *
  * Description:
- * Struct function to remove items from the queue
+ * Move constructor. Allocates our own AVPacket, then moves other's data reference into it. other keeps its
+ * (now empty) AVPacket.
  *
  * Inputs:
- *		cv::Mat& frame       frame to store removed queue item
+ *		PacketRef&& other			packet to take the reference from
  *
  * Outputs:
- *		bool (return val)    indicates success of removing from queue
+ *		N/A
  */
-bool QueueMat::deQueue(cv::Mat& frame)
+PacketRef::PacketRef(PacketRef&& other) : PacketRef()
 {
-    if (front == -1)
-    {
-#ifdef DEBUG
-        std::cout << "Frame queue is Empty" << std::endl;
-#endif
-        return false; 
-    }
-
-    buffer[front].copyTo(frame);
-
-    if (front == rear)
-    {
-        front = -1;
-        rear = -1;
-    }
-    else if (front == size - 1)
-        front = 0;
-    else
-        front++;
-
-    return true;
+    av_packet_move_ref(pkt, other.pkt);
 }
 
 
 /*
- * bool enQueue(packet& pkt);
+ * ~PacketRef(void) :
  *
  * Description:
- * Struct function to add items to the queue
+ * Destructor. av_packet_free() drops the data reference (if any) before freeing the AVPacket.
  *
  * Inputs:
- *		packet& pkt          packet to copy into queue
+ *		N/A
  *
  * Outputs:
- *	    bool (return val)    indicates success of placing into queue
+ *		N/A
  */
-bool QueuePkt::enQueue(packet& pkt)
+PacketRef::~PacketRef(void)
 {
-    if ((front == 0 && rear == size - 1) ||
-        (rear == (front - 1) % (size - 1)))
-    {
-#ifdef DEBUG
-        std::cout << "Pkt queue is Full" << std::endl;
-#endif
-        return false;
-    }
-
-    else if (front == -1) /* Insert First Element */
-    {
-        front = rear = 0;
-        buffer[rear].size = pkt.size;
-        memcpy(buffer[rear].buffer, pkt.buffer, pkt.size);
-    }
+    av_packet_free(&pkt);
+}
 
-    else if (rear == size - 1 && front != 0)
-    {
-        rear = 0;
-        buffer[rear].size = pkt.size;
-        memcpy(buffer[rear].buffer, pkt.buffer, pkt.size);
-    }
 
-    else
+/*
+ * PacketRef& operator=(PacketRef&& other);
+ *
+ * Description:
+ * Drop our current data reference and move other's into our AVPacket, other is left empty. Neither AVPacket is
+ * freed or allocated, which is what lets RingBuffer slots be reused.
+ *
+ * Inputs:
+ *		PacketRef&& other			packet to take the reference from
+ *
+ * Outputs:
+ *		PacketRef& (return val)		this packet
+ */
+PacketRef& PacketRef::operator=(PacketRef&& other)
+{
+    if (this != &other)
     {
-        rear++;
-        buffer[rear].size = pkt.size;
-        memcpy(buffer[rear].buffer, pkt.buffer, pkt.size);
+        av_packet_unref(pkt);
+        av_packet_move_ref(pkt, other.pkt);
     }
-
-    return true;
+    return *this;
 }
 
 
 /*
- * bool deQueue(packet& pkt);
+ * void unref(void);
  *
  * Description:
- * Struct function to remove items from the queue
+ * Drop the data reference, the AVPacket itself is kept for the next packet.
  *
  * Inputs:
- *		packet& pkt          packet to store removed queue item
+ *		N/A
  *
  * Outputs:
- *		bool (return val)    indicates success of removing from queue
+ *		N/A
  */
-bool QueuePkt::deQueue(packet& pkt)
+void PacketRef::unref(void)
 {
-    if (front == -1)
-    {
-#ifdef DEBUG
-        std::cout << "Pkt queue is Empty" << std::endl;
-#endif
-        return false;
-    }
-
-    pkt.size = buffer[front].size;
-    memcpy(pkt.buffer, buffer[front].buffer, buffer[front].size);
+    av_packet_unref(pkt);
+}
 
-    if (front == rear)
-    {
-        front = -1;
-        rear = -1;
-    }
-    else if (front == size - 1)
-        front = 0;
-    else
-        front++;
 
-    return true;
+/*
+ * bool ref(const PacketRef& other);
+ *
+ * Description:
+ * Drop our current data reference and share other's (av_packet_ref), the encoded bytes are not copied.
+ *
+ * Inputs:
+ *		const PacketRef& other		packet to share
+ *
+ * Outputs:
+ *		bool (return val)			false if the reference could not be taken (we are left empty)
+ */
+bool PacketRef::ref(const PacketRef& other)
+{
+    av_packet_unref(pkt);
+    return av_packet_ref(pkt, other.pkt) == 0;
 }
@@ -1,180 +1,167 @@
 /*
  * Author:  Jordan Leiker
  * Class: ECE6122
- * Last Date Modified: 11/14/2020
+ * Last Date Modified: 10/16/2026
  *
  * Description:
- * This is the header for two ciruclar buffers. The are identical except for the type of data they hold.
- * All of the code has been taken directly from (with light modifications):
- * https://www.geeksforgeeks.org/circular-queue-set-1-introduction-array-implementation/
- * 
- * The two circular queues hold (1) cv::Mat frames and (2) "struct packet" type.
- * 
+ * This is the header for the data that moves through the circular buffers between threads.
+ * The circular buffer itself is the generic lock-free RingBuffer (see RingBuffer.h). Frames are moved through
+ * it by handle (see FramePool.h for where the frame buffers come from), and so are encoded packets: this file
+ * defines PacketRef, a move-only handle to a reference counted FFMPEG AVPacket.
+ *
+ * Moving a PacketRef only hands over the reference to the encoder's packet buffer. The encoded bytes are written
+ * once by the encoder and read by send(), they are never copied between threads. When one packet goes to several
+ * clients each gets its own PacketRef to the same buffer (ref()), the buffer is freed after the last one is done.
+ *
  */
 
+#pragma once
+#include "RingBuffer.h"
 
-#include <opencv2/opencv.hpp>
-#include <vector>
+// FFMPEG is in native so, so need the extern "C" to compile
+extern "C"
+{
+    #include <libavcodec/avcodec.h>
+}
 
-//#define DEBUG
 
 
 /*
-* struct QueueMat
-*
-* Description:
-* A structure implementating a circular queue for OpenCV Mat types.
-* Queue is initialized at construction. The queue contains actual copies of the 
-* data, NOT pointers.
-* 
-*/
-struct QueueMat
+ * class PacketRef
+ *
+ * Description:
+ * Owns one AVPacket struct for its whole lifetime. Move construct/assign transfers the packet's data reference
+ * (av_packet_move_ref) and leaves the source empty, so RingBuffer<PacketRef, N> slots are allocated once and
+ * reused for every packet.
+ *
+ */
+class PacketRef
 {
-    // Initialize front and rear 
-    int rear, front;
+    /********** Private Members **********/
+    AVPacket* pkt;
+
 
-    // Circular Queue 
-    int size;
-    std::vector<cv::Mat> buffer;
 
+public:
+    /********** Public Members **********/
 
     /*
-     * QueueMat(int s)
+     * PacketRef(void) :
      *
      * Description:
-     * Constructor for queue. Initialzation Ex.:
-     * QueuePkt qBuf(64);
+     * Constructor. Allocates an empty (blank) AVPacket.
      *
      * Inputs:
-     *		int s       Size of queue
+     *		N/A
      *
      * Outputs:
      *		N/A
      */
-    QueueMat(int s)
-    {
-        front = rear = -1;
-        size = s;
-        buffer.resize(size);
-    }
+    PacketRef(void);
 
 
     /*
-     * bool enQueue(cv::Mat& frame);
+     * PacketRef(PacketRef&& other) :
      *
      * Description:
-     * Struct function to add items to the queue
+     * Move constructor. Takes over the data reference of other, other is left empty.
      *
      * Inputs:
-     *		cv::Mat& frame       frame to copy into queue
+     *		PacketRef&& other        packet to take the reference from
      *
      * Outputs:
-     *		bool (return val)    indicates success of placing into queue
+     *		N/A
      */
-    bool enQueue(cv::Mat& frame);
+    PacketRef(PacketRef&& other);
 
 
     /*
-     * bool deQueue(cv::Mat& frame);
+     * ~PacketRef(void) :
      *
      * Description:
-     * Struct function to remove items from the queue
+     * Destructor. Drops the data reference (if any) and frees the AVPacket.
      *
      * Inputs:
-     *		cv::Mat& frame       frame to store removed queue item
+     *		N/A
      *
      * Outputs:
-     *		bool (return val)    indicates success of removing from queue
+     *		N/A
      */
-    bool deQueue(cv::Mat& frame);
-};
-
-
-
-/*
- * struct packet
- *
- * Description:
- * A very simple struct that holds a buffer and the size of the data in the buffer. this is meant to be a low 
- * overhead method for queueing FFMPEG AVFrame data and sizes.
- * 
- * Note: Size of buffer is hardcoded for now. No reason to make it larger until FFMPEG codec issues get resolved.
- *
- */
-struct packet
-{
-    int size;
-    char* buffer = new char[480 * 640 * 3];
-};
+    ~PacketRef(void);
 
+    // No implicit copies: a PacketRef is moved along, and sharing a packet is explicit through ref()
+    PacketRef(const PacketRef&) = delete;
+    PacketRef& operator=(const PacketRef&) = delete;
 
 
-/*
- * struct QueuePkt
- *
- * Description:
- * A structure implementating a circular queue for packet types.
- * Queue is initialized at construction. The queue contains actual copies of the
- * data, NOT pointers.
- * 
- */
-struct QueuePkt
-{
-    // Initialize front and rear 
-    int rear, front;
-
-    // Circular Queue 
-    int size;
-    std::vector<packet> buffer;
+    /*
+     * PacketRef& operator=(PacketRef&& other);
+     *
+     * Description:
+     * Drop our current data reference and take over the one in other, other is left empty.
+     *
+     * Inputs:
+     *		PacketRef&& other        packet to take the reference from
+     *
+     * Outputs:
+     *		PacketRef& (return val)  this packet
+     */
+    PacketRef& operator=(PacketRef&& other);
 
 
     /*
-     * QueuePkt(int s)
+     * AVPacket* get(void) const;
      *
      * Description:
-     * Constructor for queue. Initialzation Ex.:
-     * QueuePkt qBuf(64);
+     * Access the underlying AVPacket, e.g. to have the encoder fill it or to send its data.
      *
      * Inputs:
-     *		int s       Size of queue
+     *		N/A
      *
      * Outputs:
-     *		N/A
+     *		AVPacket* (return val)   the owned packet
      */
-    QueuePkt(int s)
-    {
-        front = rear = -1;
-        size = s;
-        buffer.resize(size);
-    }
+    AVPacket* get(void) const { return pkt; }
+    AVPacket* operator->(void) const { return pkt; }
 
 
     /*
-     * bool enQueue(packet& pkt);
+     * void unref(void);
      *
      * Description:
-     * Struct function to add items to the queue
+     * Drop the data reference so the buffer goes back to FFMPEG as soon as we are done with it.
      *
      * Inputs:
-     *		packet& pkt          packet to copy into queue
+     *		N/A
      *
      * Outputs:
-     *	    bool (return val)    indicates success of placing into queue
+     *		N/A
      */
-    bool enQueue(packet& pkt);
+    void unref(void);
 
 
     /*
-     * bool deQueue(packet& pkt);
+     * bool ref(const PacketRef& other);
      *
      * Description:
-     * Struct function to remove items from the queue
+     * Drop our current data reference and take a new reference to other's data (av_packet_ref). The encoded
+     * bytes are shared, not copied, and other keeps its reference.
      *
      * Inputs:
-     *		packet& pkt          packet to store removed queue item
+     *		const PacketRef& other   packet to share
      *
      * Outputs:
-     *		bool (return val)    indicates success of removing from queue
+     *		bool (return val)        false if the reference could not be taken (we are left empty)
      */
-    bool deQueue(packet& pkt);
-};
\ No newline at end of file
+    bool ref(const PacketRef& other);
+};
+
+
+// A PacketRef dropped by a queue just lets go of its data, the slot keeps its AVPacket (see RingBuffer.h)
+template <>
+struct RingBufferTraits<PacketRef>
+{
+    static void enQueue(PacketRef& item, PacketRef& slot) { slot = std::move(item); }
+    static void deQueue(PacketRef& slot, PacketRef& item) { item = std::move(slot); }
+    static void release(PacketRef& item) { item.unref(); }
+};
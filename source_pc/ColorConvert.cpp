@@ -0,0 +1,601 @@
+/*
+ * Author:  Jordan Leiker
+ * Class: ECE6122
+ * Last Date Modified: 10/16/2026
+ *
+ * Description:
+ * This is the functional code for the BGR24 <-> YUV420P color conversion (see ColorConvert.h).
+ *
+ * Each kernel handles one row of chroma: two rows of BGR and Y one way, one row of BGR and Y (called twice per
+ * chroma row) the other way. The SIMD kernels do 16 pixels per step with the same integer math as the scalar ones
+ * (16 bit where the values fit, 32 bit for the 298C terms of the inverse that don't) and hand the last few pixels
+ * of a row to the scalar kernel.
+ *
+ */
+
+#include "ColorConvert.h"
+#include <algorithm>
+#include <functional>
+#include <opencv2/core.hpp>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define COLOR_CONVERT_NEON
+#include <arm_neon.h>
+#elif defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define COLOR_CONVERT_SSSE3
+#include <tmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define COLOR_CONVERT_TARGET_SSSE3
+#else
+#define COLOR_CONVERT_TARGET_SSSE3 __attribute__((target("ssse3")))
+#endif
+#endif
+
+// Rows per stripe handed to the thread pool. Below this the hand off costs more than the conversion.
+#define MIN_STRIPE_ROWS 64
+
+
+static inline uint8_t clip8(int x)
+{
+    return (uint8_t)(x < 0 ? 0 : (x > 255 ? 255 : x));
+}
+
+
+/*
+ * static void bgrToYuvRowsScalar(const uint8_t* bgr0, const uint8_t* bgr1, uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v, int cols);
+ *
+ * Description:
+ * Convert two rows of BGR to two rows of Y and one row of U and V.
+ *
+ * Inputs:
+ *		const uint8_t* bgr0			top BGR row
+ *		const uint8_t* bgr1			bottom BGR row
+ *		int cols					pixels in the row (even)
+ *
+ * Outputs:
+ *		uint8_t* y0					top Y row
+ *		uint8_t* y1					bottom Y row
+ *		uint8_t* u					U row (cols / 2 samples)
+ *		uint8_t* v					V row (cols / 2 samples)
+ */
+static void bgrToYuvRowsScalar(const uint8_t* bgr0, const uint8_t* bgr1, uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v,
+                               int cols)
+{
+    for (int col = 0; col < cols; col += 2, bgr0 += 6, bgr1 += 6)
+    {
+        y0[col] = (uint8_t)((66 * bgr0[2] + 129 * bgr0[1] + 25 * bgr0[0] + 4224) >> 8);
+        y0[col + 1] = (uint8_t)((66 * bgr0[5] + 129 * bgr0[4] + 25 * bgr0[3] + 4224) >> 8);
+        y1[col] = (uint8_t)((66 * bgr1[2] + 129 * bgr1[1] + 25 * bgr1[0] + 4224) >> 8);
+        y1[col + 1] = (uint8_t)((66 * bgr1[5] + 129 * bgr1[4] + 25 * bgr1[3] + 4224) >> 8);
+
+        // Average of the 2x2 block, rounded
+        int b = (bgr0[0] + bgr0[3] + bgr1[0] + bgr1[3] + 2) >> 2;
+        int g = (bgr0[1] + bgr0[4] + bgr1[1] + bgr1[4] + 2) >> 2;
+        int r = (bgr0[2] + bgr0[5] + bgr1[2] + bgr1[5] + 2) >> 2;
+
+        // >> on a negative int is an arithmetic shift (floor), the same as the SIMD kernels
+        u[col / 2] = (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+        v[col / 2] = (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+}
+
+
+/*
+ * static void yuvToBgrRowScalar(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* bgr, int cols);
+ *
+ * Description:
+ * Convert one row of Y (and the row of U and V it shares with its neighbour) to BGR.
+ *
+ * Inputs:
+ *		const uint8_t* y			Y row
+ *		const uint8_t* u			U row (cols / 2 samples)
+ *		const uint8_t* v			V row (cols / 2 samples)
+ *		int cols					pixels in the row (even)
+ *
+ * Outputs:
+ *		uint8_t* bgr				BGR row
+ */
+static void yuvToBgrRowScalar(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* bgr, int cols)
+{
+    for (int col = 0; col < cols; col++, bgr += 3)
+    {
+        int c = 298 * (y[col] - 16) + 128;
+        int d = u[col / 2] - 128;
+        int e = v[col / 2] - 128;
+
+        bgr[0] = clip8((c + 516 * d) >> 8);
+        bgr[1] = clip8((c - 100 * d - 208 * e) >> 8);
+        bgr[2] = clip8((c + 409 * e) >> 8);
+    }
+}
+
+
+#ifdef COLOR_CONVERT_NEON
+// Y of 8 pixels. Fits in 16 bits unsigned: 66 * 255 + 129 * 255 + 25 * 255 + 4224 < 65536
+static inline uint8x8_t lumaNeon(uint8x8_t b, uint8x8_t g, uint8x8_t r)
+{
+    uint16x8_t y = vmull_u8(r, vdup_n_u8(66));
+    y = vmlal_u8(y, g, vdup_n_u8(129));
+    y = vmlal_u8(y, b, vdup_n_u8(25));
+    return vshrn_n_u16(vaddq_u16(y, vdupq_n_u16(4224)), 8);
+}
+
+
+/*
+ * static void bgrToYuvRowsNeon(const uint8_t* bgr0, const uint8_t* bgr1, uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v, int cols);
+ *
+ * Description:
+ * NEON version of bgrToYuvRowsScalar(). vld3 splits 16 pixels into B, G and R vectors, Y is a widening multiply
+ * accumulate and the 2x2 chroma sums come from pairwise widening adds.
+ *
+ * Inputs:
+ *		const uint8_t* bgr0			top BGR row
+ *		const uint8_t* bgr1			bottom BGR row
+ *		int cols					pixels in the row (even)
+ *
+ * Outputs:
+ *		uint8_t* y0					top Y row
+ *		uint8_t* y1					bottom Y row
+ *		uint8_t* u					U row (cols / 2 samples)
+ *		uint8_t* v					V row (cols / 2 samples)
+ */
+static void bgrToYuvRowsNeon(const uint8_t* bgr0, const uint8_t* bgr1, uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v,
+                             int cols)
+{
+    int col = 0;
+    for (; col + 16 <= cols; col += 16)
+    {
+        uint8x16x3_t px0 = vld3q_u8(bgr0 + 3 * col);
+        uint8x16x3_t px1 = vld3q_u8(bgr1 + 3 * col);
+
+        vst1q_u8(y0 + col, vcombine_u8(lumaNeon(vget_low_u8(px0.val[0]), vget_low_u8(px0.val[1]), vget_low_u8(px0.val[2])),
+                                       lumaNeon(vget_high_u8(px0.val[0]), vget_high_u8(px0.val[1]), vget_high_u8(px0.val[2]))));
+        vst1q_u8(y1 + col, vcombine_u8(lumaNeon(vget_low_u8(px1.val[0]), vget_low_u8(px1.val[1]), vget_low_u8(px1.val[2])),
+                                       lumaNeon(vget_high_u8(px1.val[0]), vget_high_u8(px1.val[1]), vget_high_u8(px1.val[2]))));
+
+        // 2x2 block averages (rounded) of B, G and R
+        int16x8_t avg[3];
+        for (int c = 0; c < 3; c++)
+            avg[c] = vreinterpretq_s16_u16(vrshrq_n_u16(vpadalq_u8(vpaddlq_u8(px0.val[c]), px1.val[c]), 2));
+
+        // Fits in 16 bits signed at every step: |112 * 255| + 128 < 32768
+        int16x8_t uw = vmlaq_n_s16(vdupq_n_s16(128), avg[0], 112);
+        uw = vmlaq_n_s16(uw, avg[2], -38);
+        uw = vmlaq_n_s16(uw, avg[1], -74);
+        int16x8_t vw = vmlaq_n_s16(vdupq_n_s16(128), avg[2], 112);
+        vw = vmlaq_n_s16(vw, avg[1], -94);
+        vw = vmlaq_n_s16(vw, avg[0], -18);
+
+        vst1_u8(u + col / 2, vqmovun_s16(vaddq_s16(vshrq_n_s16(uw, 8), vdupq_n_s16(128))));
+        vst1_u8(v + col / 2, vqmovun_s16(vaddq_s16(vshrq_n_s16(vw, 8), vdupq_n_s16(128))));
+    }
+
+    bgrToYuvRowsScalar(bgr0 + 3 * col, bgr1 + 3 * col, y0 + col, y1 + col, u + col / 2, v + col / 2, cols - col);
+}
+
+
+// (lo, hi) 32 bit sums of 8 pixels >> 8, clipped to 0..255
+static inline uint8x8_t narrowNeon(int32x4_t lo, int32x4_t hi)
+{
+    return vqmovun_s16(vcombine_s16(vqmovn_s32(vshrq_n_s32(lo, 8)), vqmovn_s32(vshrq_n_s32(hi, 8))));
+}
+
+
+/*
+ * static void yuvToBgrRowNeon(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* bgr, int cols);
+ *
+ * Description:
+ * NEON version of yuvToBgrRowScalar(). Chroma is doubled up with vzip, the products are accumulated in 32 bits,
+ * narrowed with saturation and vst3 interleaves B, G and R.
+ *
+ * Inputs:
+ *		const uint8_t* y			Y row
+ *		const uint8_t* u			U row (cols / 2 samples)
+ *		const uint8_t* v			V row (cols / 2 samples)
+ *		int cols					pixels in the row (even)
+ *
+ * Outputs:
+ *		uint8_t* bgr				BGR row
+ */
+static void yuvToBgrRowNeon(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* bgr, int cols)
+{
+    int col = 0;
+    for (; col + 16 <= cols; col += 16)
+    {
+        uint8x16_t yv = vld1q_u8(y + col);
+        uint8x8_t u8 = vld1_u8(u + col / 2);
+        uint8x8_t v8 = vld1_u8(v + col / 2);
+        uint8x8x2_t uu = vzip_u8(u8, u8);
+        uint8x8x2_t vv = vzip_u8(v8, v8);
+
+        uint8x8_t ch[3][2]; // [B, G, R][8 pixel half]
+        for (int half = 0; half < 2; half++)
+        {
+            int16x8_t c = vreinterpretq_s16_u16(vsubl_u8(half ? vget_high_u8(yv) : vget_low_u8(yv), vdup_n_u8(16)));
+            int16x8_t d = vreinterpretq_s16_u16(vsubl_u8(uu.val[half], vdup_n_u8(128)));
+            int16x8_t e = vreinterpretq_s16_u16(vsubl_u8(vv.val[half], vdup_n_u8(128)));
+
+            // 298C + 128, shared by all three channels
+            int32x4_t cLo = vmlal_n_s16(vdupq_n_s32(128), vget_low_s16(c), 298);
+            int32x4_t cHi = vmlal_n_s16(vdupq_n_s32(128), vget_high_s16(c), 298);
+
+            ch[0][half] = narrowNeon(vmlal_n_s16(cLo, vget_low_s16(d), 516), vmlal_n_s16(cHi, vget_high_s16(d), 516));
+            ch[1][half] = narrowNeon(vmlal_n_s16(vmlal_n_s16(cLo, vget_low_s16(d), -100), vget_low_s16(e), -208),
+                                     vmlal_n_s16(vmlal_n_s16(cHi, vget_high_s16(d), -100), vget_high_s16(e), -208));
+            ch[2][half] = narrowNeon(vmlal_n_s16(cLo, vget_low_s16(e), 409), vmlal_n_s16(cHi, vget_high_s16(e), 409));
+        }
+
+        uint8x16x3_t px;
+        for (int c = 0; c < 3; c++)
+            px.val[c] = vcombine_u8(ch[c][0], ch[c][1]);
+        vst3q_u8(bgr + 3 * col, px);
+    }
+
+    yuvToBgrRowScalar(y + col, u + col / 2, v + col / 2, bgr + 3 * col, cols - col);
+}
+#endif
+
+
+#ifdef COLOR_CONVERT_SSSE3
+// Split 16 BGR pixels (three 16 byte vectors) into B, G and R vectors with pshufb
+COLOR_CONVERT_TARGET_SSSE3
+static inline void deinterleaveSsse3(const uint8_t* src, __m128i& b, __m128i& g, __m128i& r)
+{
+    // Shuffle masks: channel c of 16 pixels taken from input vector n (-1 = not from this input)
+    const __m128i bFrom0 = _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i bFrom1 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1);
+    const __m128i bFrom2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13);
+    const __m128i gFrom0 = _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i gFrom1 = _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1);
+    const __m128i gFrom2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14);
+    const __m128i rFrom0 = _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i rFrom1 = _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1);
+    const __m128i rFrom2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15);
+
+    const __m128i* s = (const __m128i*)src;
+    __m128i a0 = _mm_loadu_si128(s);
+    __m128i a1 = _mm_loadu_si128(s + 1);
+    __m128i a2 = _mm_loadu_si128(s + 2);
+
+    b = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a0, bFrom0), _mm_shuffle_epi8(a1, bFrom1)), _mm_shuffle_epi8(a2, bFrom2));
+    g = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a0, gFrom0), _mm_shuffle_epi8(a1, gFrom1)), _mm_shuffle_epi8(a2, gFrom2));
+    r = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a0, rFrom0), _mm_shuffle_epi8(a1, rFrom1)), _mm_shuffle_epi8(a2, rFrom2));
+}
+
+
+// Y of 16 pixels. Fits in 16 bits unsigned: 66 * 255 + 129 * 255 + 25 * 255 + 4224 < 65536
+COLOR_CONVERT_TARGET_SSSE3
+static inline __m128i lumaSsse3(__m128i b, __m128i g, __m128i r)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i yw[2];
+    for (int half = 0; half < 2; half++)
+    {
+        __m128i bw = half ? _mm_unpackhi_epi8(b, zero) : _mm_unpacklo_epi8(b, zero);
+        __m128i gw = half ? _mm_unpackhi_epi8(g, zero) : _mm_unpacklo_epi8(g, zero);
+        __m128i rw = half ? _mm_unpackhi_epi8(r, zero) : _mm_unpacklo_epi8(r, zero);
+        __m128i y = _mm_add_epi16(_mm_mullo_epi16(rw, _mm_set1_epi16(66)), _mm_mullo_epi16(gw, _mm_set1_epi16(129)));
+        y = _mm_add_epi16(y, _mm_mullo_epi16(bw, _mm_set1_epi16(25)));
+        yw[half] = _mm_srli_epi16(_mm_add_epi16(y, _mm_set1_epi16(4224)), 8);
+    }
+    return _mm_packus_epi16(yw[0], yw[1]);
+}
+
+
+/*
+ * static void bgrToYuvRowsSsse3(const uint8_t* bgr0, const uint8_t* bgr1, uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v, int cols);
+ *
+ * Description:
+ * SSSE3 version of bgrToYuvRowsScalar(). 16 pixels are loaded as three 16 byte vectors and split into B, G and R
+ * with pshufb. Y is computed in 16 bit lanes, the 2x2 chroma sums come from pmaddubsw against 1s (horizontal pairs)
+ * plus the same for the other row.
+ *
+ * Inputs:
+ *		const uint8_t* bgr0			top BGR row
+ *		const uint8_t* bgr1			bottom BGR row
+ *		int cols					pixels in the row (even)
+ *
+ * Outputs:
+ *		uint8_t* y0					top Y row
+ *		uint8_t* y1					bottom Y row
+ *		uint8_t* u					U row (cols / 2 samples)
+ *		uint8_t* v					V row (cols / 2 samples)
+ */
+COLOR_CONVERT_TARGET_SSSE3
+static void bgrToYuvRowsSsse3(const uint8_t* bgr0, const uint8_t* bgr1, uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v,
+                              int cols)
+{
+    const __m128i ones = _mm_set1_epi8(1);
+    const __m128i two = _mm_set1_epi16(2);
+    const __m128i c128 = _mm_set1_epi16(128);
+
+    int col = 0;
+    for (; col + 16 <= cols; col += 16)
+    {
+        __m128i b0, g0, r0, b1, g1, r1;
+        deinterleaveSsse3(bgr0 + 3 * col, b0, g0, r0);
+        deinterleaveSsse3(bgr1 + 3 * col, b1, g1, r1);
+
+        _mm_storeu_si128((__m128i*)(y0 + col), lumaSsse3(b0, g0, r0));
+        _mm_storeu_si128((__m128i*)(y1 + col), lumaSsse3(b1, g1, r1));
+
+        // 2x2 block averages (rounded) of B, G and R
+        __m128i b = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(_mm_maddubs_epi16(b0, ones), _mm_maddubs_epi16(b1, ones)), two), 2);
+        __m128i g = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(_mm_maddubs_epi16(g0, ones), _mm_maddubs_epi16(g1, ones)), two), 2);
+        __m128i r = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(_mm_maddubs_epi16(r0, ones), _mm_maddubs_epi16(r1, ones)), two), 2);
+
+        // Fits in 16 bits signed at every step: |112 * 255| + 128 < 32768
+        __m128i uw = _mm_add_epi16(c128, _mm_mullo_epi16(b, _mm_set1_epi16(112)));
+        uw = _mm_sub_epi16(uw, _mm_mullo_epi16(r, _mm_set1_epi16(38)));
+        uw = _mm_sub_epi16(uw, _mm_mullo_epi16(g, _mm_set1_epi16(74)));
+        __m128i vw = _mm_add_epi16(c128, _mm_mullo_epi16(r, _mm_set1_epi16(112)));
+        vw = _mm_sub_epi16(vw, _mm_mullo_epi16(g, _mm_set1_epi16(94)));
+        vw = _mm_sub_epi16(vw, _mm_mullo_epi16(b, _mm_set1_epi16(18)));
+
+        // 8 U samples in the low half, 8 V samples in the high half
+        __m128i uv = _mm_packus_epi16(_mm_add_epi16(_mm_srai_epi16(uw, 8), c128), _mm_add_epi16(_mm_srai_epi16(vw, 8), c128));
+        _mm_storel_epi64((__m128i*)(u + col / 2), uv);
+        _mm_storel_epi64((__m128i*)(v + col / 2), _mm_srli_si128(uv, 8));
+    }
+
+    bgrToYuvRowsScalar(bgr0 + 3 * col, bgr1 + 3 * col, y0 + col, y1 + col, u + col / 2, v + col / 2, cols - col);
+}
+
+
+// (lo, hi) 32 bit sums of 8 pixels, + 128 >> 8, packed to 16 bits with saturation
+COLOR_CONVERT_TARGET_SSSE3
+static inline __m128i narrowSsse3(__m128i lo, __m128i hi)
+{
+    const __m128i round = _mm_set1_epi32(128);
+    return _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(lo, round), 8), _mm_srai_epi32(_mm_add_epi32(hi, round), 8));
+}
+
+
+/*
+ * static void yuvToBgrRowSsse3(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* bgr, int cols);
+ *
+ * Description:
+ * SSSE3 version of yuvToBgrRowScalar(). Chroma is doubled up by unpacking it with itself, the products are summed
+ * in 32 bits with pmaddwd on interleaved (C, D) / (C, E) pairs, packed back down with saturation and re-interleaved
+ * to BGR with pshufb.
+ *
+ * Inputs:
+ *		const uint8_t* y			Y row
+ *		const uint8_t* u			U row (cols / 2 samples)
+ *		const uint8_t* v			V row (cols / 2 samples)
+ *		int cols					pixels in the row (even)
+ *
+ * Outputs:
+ *		uint8_t* bgr				BGR row
+ */
+COLOR_CONVERT_TARGET_SSSE3
+static void yuvToBgrRowSsse3(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* bgr, int cols)
+{
+    // Shuffle masks: output vector n takes channel c from pixel i (-1 = not this channel)
+    const __m128i o0FromB = _mm_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5);
+    const __m128i o0FromG = _mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1);
+    const __m128i o0FromR = _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+    const __m128i o1FromB = _mm_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1);
+    const __m128i o1FromG = _mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10);
+    const __m128i o1FromR = _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1);
+    const __m128i o2FromB = _mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1);
+    const __m128i o2FromG = _mm_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1);
+    const __m128i o2FromR = _mm_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15);
+
+    // pmaddwd coefficients for (C, D), (C, E) and (E, 0) pairs
+    const __m128i kB = _mm_setr_epi16(298, 516, 298, 516, 298, 516, 298, 516);
+    const __m128i kG = _mm_setr_epi16(298, -100, 298, -100, 298, -100, 298, -100);
+    const __m128i kGe = _mm_setr_epi16(-208, 0, -208, 0, -208, 0, -208, 0);
+    const __m128i kR = _mm_setr_epi16(298, 409, 298, 409, 298, 409, 298, 409);
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c16 = _mm_set1_epi16(16);
+    const __m128i c128 = _mm_set1_epi16(128);
+
+    int col = 0;
+    for (; col + 16 <= cols; col += 16)
+    {
+        __m128i yv = _mm_loadu_si128((const __m128i*)(y + col));
+        __m128i uv = _mm_loadl_epi64((const __m128i*)(u + col / 2));
+        __m128i vv = _mm_loadl_epi64((const __m128i*)(v + col / 2));
+        uv = _mm_unpacklo_epi8(uv, uv);
+        vv = _mm_unpacklo_epi8(vv, vv);
+
+        __m128i ch[3][2]; // [B, G, R][8 pixel half], 16 bit
+        for (int half = 0; half < 2; half++)
+        {
+            __m128i c = _mm_sub_epi16(half ? _mm_unpackhi_epi8(yv, zero) : _mm_unpacklo_epi8(yv, zero), c16);
+            __m128i d = _mm_sub_epi16(half ? _mm_unpackhi_epi8(uv, zero) : _mm_unpacklo_epi8(uv, zero), c128);
+            __m128i e = _mm_sub_epi16(half ? _mm_unpackhi_epi8(vv, zero) : _mm_unpacklo_epi8(vv, zero), c128);
+
+            __m128i cdLo = _mm_unpacklo_epi16(c, d), cdHi = _mm_unpackhi_epi16(c, d);
+            __m128i ceLo = _mm_unpacklo_epi16(c, e), ceHi = _mm_unpackhi_epi16(c, e);
+            __m128i eLo = _mm_unpacklo_epi16(e, zero), eHi = _mm_unpackhi_epi16(e, zero);
+
+            ch[0][half] = narrowSsse3(_mm_madd_epi16(cdLo, kB), _mm_madd_epi16(cdHi, kB));
+            ch[1][half] = narrowSsse3(_mm_add_epi32(_mm_madd_epi16(cdLo, kG), _mm_madd_epi16(eLo, kGe)),
+                                      _mm_add_epi32(_mm_madd_epi16(cdHi, kG), _mm_madd_epi16(eHi, kGe)));
+            ch[2][half] = narrowSsse3(_mm_madd_epi16(ceLo, kR), _mm_madd_epi16(ceHi, kR));
+        }
+        __m128i b = _mm_packus_epi16(ch[0][0], ch[0][1]);
+        __m128i g = _mm_packus_epi16(ch[1][0], ch[1][1]);
+        __m128i r = _mm_packus_epi16(ch[2][0], ch[2][1]);
+
+        __m128i* d = (__m128i*)(bgr + 3 * col);
+        _mm_storeu_si128(d, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(b, o0FromB), _mm_shuffle_epi8(g, o0FromG)),
+                                         _mm_shuffle_epi8(r, o0FromR)));
+        _mm_storeu_si128(d + 1, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(b, o1FromB), _mm_shuffle_epi8(g, o1FromG)),
+                                             _mm_shuffle_epi8(r, o1FromR)));
+        _mm_storeu_si128(d + 2, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(b, o2FromB), _mm_shuffle_epi8(g, o2FromG)),
+                                             _mm_shuffle_epi8(r, o2FromR)));
+    }
+
+    yuvToBgrRowScalar(y + col, u + col / 2, v + col / 2, bgr + 3 * col, cols - col);
+}
+
+
+/*
+ * static bool cpuHasSsse3(void);
+ *
+ * Description:
+ * Check (once) whether the CPU we are running on supports SSSE3.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		bool (return val)			true if SSSE3 is available
+ */
+static bool cpuHasSsse3(void)
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    return __builtin_cpu_supports("ssse3");
+#endif
+}
+#endif
+
+
+// Row kernels for this machine, picked the first time they are needed
+typedef void (*bgrToYuvRowsFn)(const uint8_t* bgr0, const uint8_t* bgr1, uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v, int cols);
+typedef void (*yuvToBgrRowFn)(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* bgr, int cols);
+
+struct colorKernels
+{
+    const char* name;
+    bgrToYuvRowsFn bgrToYuv;
+    yuvToBgrRowFn yuvToBgr;
+};
+
+static colorKernels selectKernels(void)
+{
+#if defined(COLOR_CONVERT_NEON)
+    return { "neon", bgrToYuvRowsNeon, yuvToBgrRowNeon };
+#elif defined(COLOR_CONVERT_SSSE3)
+    if (cpuHasSsse3())
+        return { "ssse3", bgrToYuvRowsSsse3, yuvToBgrRowSsse3 };
+#endif
+    return { "scalar", bgrToYuvRowsScalar, yuvToBgrRowScalar };
+}
+
+static const colorKernels kernels = selectKernels();
+
+
+/*
+ * static void forEachStripe(int rows, int flags, const std::function<void(int, int)>& body);
+ *
+ * Description:
+ * Run body over the row pairs [0, rows / 2), split into stripes on OpenCV's thread pool unless the frame is too
+ * small or COLOR_CONVERT_SINGLE_THREAD is set.
+ *
+ * Inputs:
+ *		int rows					image height (even)
+ *		int flags					COLOR_CONVERT_* flags
+ *		body						called with [first, last) row pairs of one stripe
+ *
+ * Outputs:
+ *		N/A
+ */
+static void forEachStripe(int rows, int flags, const std::function<void(int, int)>& body)
+{
+    int pairs = rows / 2;
+    int stripes = std::min(cv::getNumThreads(), rows / MIN_STRIPE_ROWS);
+    if ((flags & COLOR_CONVERT_SINGLE_THREAD) || stripes <= 1)
+    {
+        body(0, pairs);
+        return;
+    }
+
+    cv::parallel_for_(cv::Range(0, pairs), [&](const cv::Range& range) { body(range.start, range.end); }, stripes);
+}
+
+
+/*
+ * void bgr24ToYuv420p(const uint8_t* bgr, size_t bgrStep, uint8_t* const yuv[3], const int yuvStride[3], int rows, int cols, int flags = 0);
+ *
+ * Description:
+ * Convert a BGR24 image to planar YUV 4:2:0 of the same size. rows and cols must be even.
+ *
+ * Inputs:
+ *		const uint8_t* bgr			first pixel of the BGR image
+ *		size_t bgrStep				bytes between BGR rows
+ *		const int yuvStride[3]		bytes between rows of the Y, U and V planes
+ *		int rows					image height
+ *		int cols					image width (pixels)
+ *		int flags					COLOR_CONVERT_* flags
+ *
+ * Outputs:
+ *		uint8_t* const yuv[3]		Y, U and V planes (e.g. AVFrame::data)
+ */
+void bgr24ToYuv420p(const uint8_t* bgr, size_t bgrStep, uint8_t* const yuv[3], const int yuvStride[3], int rows, int cols,
+                    int flags)
+{
+    CV_Assert(rows % 2 == 0 && cols % 2 == 0);
+    bgrToYuvRowsFn convertRows = (flags & COLOR_CONVERT_SCALAR) ? bgrToYuvRowsScalar : kernels.bgrToYuv;
+
+    forEachStripe(rows, flags, [&](int first, int last) {
+        for (int pair = first; pair < last; pair++)
+        {
+            const uint8_t* bgr0 = bgr + (size_t)(2 * pair) * bgrStep;
+            uint8_t* y0 = yuv[0] + (size_t)(2 * pair) * yuvStride[0];
+            convertRows(bgr0, bgr0 + bgrStep, y0, y0 + yuvStride[0], yuv[1] + (size_t)pair * yuvStride[1],
+                        yuv[2] + (size_t)pair * yuvStride[2], cols);
+        }
+    });
+}
+
+
+/*
+ * void yuv420pToBgr24(const uint8_t* const yuv[3], const int yuvStride[3], uint8_t* bgr, size_t bgrStep, int rows, int cols, int flags = 0);
+ *
+ * Description:
+ * Convert a planar YUV 4:2:0 image to BGR24 of the same size. rows and cols must be even.
+ *
+ * Inputs:
+ *		const uint8_t* const yuv[3]	Y, U and V planes (e.g. AVFrame::data)
+ *		const int yuvStride[3]		bytes between rows of the Y, U and V planes
+ *		size_t bgrStep				bytes between BGR rows
+ *		int rows					image height
+ *		int cols					image width (pixels)
+ *		int flags					COLOR_CONVERT_* flags
+ *
+ * Outputs:
+ *		uint8_t* bgr				first pixel of the BGR image
+ */
+void yuv420pToBgr24(const uint8_t* const yuv[3], const int yuvStride[3], uint8_t* bgr, size_t bgrStep, int rows, int cols,
+                    int flags)
+{
+    CV_Assert(rows % 2 == 0 && cols % 2 == 0);
+    yuvToBgrRowFn convertRow = (flags & COLOR_CONVERT_SCALAR) ? yuvToBgrRowScalar : kernels.yuvToBgr;
+
+    forEachStripe(rows, flags, [&](int first, int last) {
+        for (int row = 2 * first; row < 2 * last; row++)
+        {
+            const uint8_t* u = yuv[1] + (size_t)(row / 2) * yuvStride[1];
+            const uint8_t* v = yuv[2] + (size_t)(row / 2) * yuvStride[2];
+            convertRow(yuv[0] + (size_t)row * yuvStride[0], u, v, bgr + (size_t)row * bgrStep, cols);
+        }
+    });
+}
+
+
+/*
+ * const char* colorConvertKernel(void);
+ *
+ * Description:
+ * Name of the kernel the conversions run on this machine ("ssse3", "neon" or "scalar").
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		const char* (return val)	kernel name
+ */
+const char* colorConvertKernel(void)
+{
+    return kernels.name;
+}
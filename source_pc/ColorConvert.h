@@ -0,0 +1,90 @@
+/*
+ * Author:  Jordan Leiker
+ * Class: ECE6122
+ * Last Date Modified: 10/16/2026
+ *
+ * Description:
+ * This is the header file for the BGR24 <-> YUV420P color conversion used on either side of the codec, in place of
+ * sws_scale for the one conversion this project actually does (same size in and out, BT.601 limited range).
+ *
+ * The kernels work on a pair of rows at a time (one row of chroma), 16 pixels at a time with SIMD (SSSE3 on x86,
+ * NEON on ARM) and plain C++ for whatever is left over and on other CPUs. The SSSE3 path is picked at run time so
+ * the same binary still runs on a CPU without it. Every path gives bit for bit the same output as the scalar code,
+ * so which one ran never shows up in the video. Large frames are split into horizontal stripes of row pairs that
+ * run on OpenCV's thread pool.
+ *
+ * Conversion math (8 bit fixed point, BT.601 limited range, the same matrix sws_scale uses by default):
+ *		Y = (66R + 129G + 25B + 128) / 256 + 16
+ *		U = (-38R - 74G + 112B + 128) / 256 + 128		(R, G, B averaged over each 2x2 block)
+ *		V = (112R - 94G - 18B + 128) / 256 + 128
+ * and back, with C = Y - 16, D = U - 128, E = V - 128 (each chroma sample shared by its 2x2 block):
+ *		R = clip((298C + 409E + 128) / 256)
+ *		G = clip((298C - 100D - 208E + 128) / 256)
+ *		B = clip((298C + 516D + 128) / 256)
+ *
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// flags for bgr24ToYuv420p() / yuv420pToBgr24()
+#define COLOR_CONVERT_SCALAR 0x1			// skip the SIMD kernel (reference output)
+#define COLOR_CONVERT_SINGLE_THREAD 0x2		// convert the whole frame on the calling thread
+
+
+/*
+ * void bgr24ToYuv420p(const uint8_t* bgr, size_t bgrStep, uint8_t* const yuv[3], const int yuvStride[3], int rows, int cols, int flags = 0);
+ *
+ * Description:
+ * Convert a BGR24 image to planar YUV 4:2:0 of the same size. rows and cols must be even.
+ *
+ * Inputs:
+ *		const uint8_t* bgr			first pixel of the BGR image
+ *		size_t bgrStep				bytes between BGR rows
+ *		const int yuvStride[3]		bytes between rows of the Y, U and V planes
+ *		int rows					image height
+ *		int cols					image width (pixels)
+ *		int flags					COLOR_CONVERT_* flags
+ *
+ * Outputs:
+ *		uint8_t* const yuv[3]		Y, U and V planes (e.g. AVFrame::data)
+ */
+void bgr24ToYuv420p(const uint8_t* bgr, size_t bgrStep, uint8_t* const yuv[3], const int yuvStride[3], int rows, int cols,
+                    int flags = 0);
+
+
+/*
+ * void yuv420pToBgr24(const uint8_t* const yuv[3], const int yuvStride[3], uint8_t* bgr, size_t bgrStep, int rows, int cols, int flags = 0);
+ *
+ * Description:
+ * Convert a planar YUV 4:2:0 image to BGR24 of the same size. rows and cols must be even.
+ *
+ * Inputs:
+ *		const uint8_t* const yuv[3]	Y, U and V planes (e.g. AVFrame::data)
+ *		const int yuvStride[3]		bytes between rows of the Y, U and V planes
+ *		size_t bgrStep				bytes between BGR rows
+ *		int rows					image height
+ *		int cols					image width (pixels)
+ *		int flags					COLOR_CONVERT_* flags
+ *
+ * Outputs:
+ *		uint8_t* bgr				first pixel of the BGR image
+ */
+void yuv420pToBgr24(const uint8_t* const yuv[3], const int yuvStride[3], uint8_t* bgr, size_t bgrStep, int rows, int cols,
+                    int flags = 0);
+
+
+/*
+ * const char* colorConvertKernel(void);
+ *
+ * Description:
+ * Name of the kernel the conversions run on this machine ("ssse3", "neon" or "scalar").
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		const char* (return val)	kernel name
+ */
+const char* colorConvertKernel(void);
@@ -0,0 +1,751 @@
+/*
+ * Author:  Jordan Leiker
+ * Class: ECE6122
+ * Last Date Modified: 10/16/2026
+ *
+ * Description:
+ * This is the header for a Kalman filter with the state and measurement sizes fixed at compile time, used by
+ * MotionTracker in place of cv::KalmanFilter.
+ *
+ * cv::KalmanFilter keeps every matrix in a heap allocated cv::Mat and runs each predict()/correct() through
+ * generic gemm() calls with Mat temporaries, which costs microseconds for a 6 state filter. FixedKalmanFilter keeps
+ * its matrices in plain fixed size arrays inside the object (no allocation after construction) and only multiplies
+ * by the non-zero entries of the transition and measurement matrices, which it lists when they are set. For the
+ * tracker's constant acceleration model that is 12 of the 36 transition entries and 2 of the 12 measurement entries.
+ * The math is the same as cv::KalmanFilter without a control input:
+ *
+ *		predict:	x = F x,  P = F P F' + Q
+ *		correct:	K = P H' (H P H' + R)^-1,  x = x + K (z - H x),  P = P - K H P
+ *
+ * (cv::KalmanFilter keeps the pre and post values separately; after predict() they are the same, so only one
+ * copy is kept here.)
+ *
+ * KalmanFilterBatch holds many filters that share one model (F, H, Q, R) in structure of arrays layout, one array
+ * per state/covariance element across all the filters, and predicts them all at once with SIMD (SSE on x86-64,
+ * NEON on ARM), 4 filters per instruction.
+ *
+ */
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#if __ARM_NEON
+#include <arm_neon.h>
+#elif defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define FIXED_KALMAN_SSE 1
+#endif
+
+
+/*
+ * void kalmanAxpy(float a, const float* x, float* y, size_t n)
+ *
+ * Description:
+ * y += a * x over n floats (SIMD where available). Used by KalmanFilterBatch.
+ *
+ * Inputs:
+ *		float a						scale
+ *		const float* x				input array
+ *		size_t n					number of elements
+ *
+ * Outputs:
+ *		float* y					accumulated array (must not overlap x)
+ */
+inline void kalmanAxpy(float a, const float* x, float* y, size_t n)
+{
+	size_t i = 0;
+#if __ARM_NEON
+	float32x4_t va = vdupq_n_f32(a);
+	for (; i + 4 <= n; i += 4)
+		vst1q_f32(y + i, vmlaq_f32(vld1q_f32(y + i), va, vld1q_f32(x + i)));
+#elif FIXED_KALMAN_SSE
+	__m128 va = _mm_set1_ps(a);
+	for (; i + 4 <= n; i += 4)
+		_mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(va, _mm_loadu_ps(x + i))));
+#endif
+	for (; i < n; i++)
+		y[i] += a * x[i];
+}
+
+
+template<int N, int M> class KalmanFilterBatch;
+
+
+/*
+ * class FixedKalmanFilter
+ *
+ * One Kalman filter with N state variables and M measured variables, all storage inside the object.
+ * Set the model with setTransition()/setMeasurementMatrix()/set*Cov() and the starting point with setState()/
+ * setErrorCov(), then alternate predict() and correct() like cv::KalmanFilter.
+ *
+ */
+template<int N, int M>
+class FixedKalmanFilter
+{
+	static_assert(N > 0 && M > 0 && M <= N, "FixedKalmanFilter needs 0 < M <= N");
+	friend class KalmanFilterBatch<N, M>;
+
+	/********** Private Members **********/
+	float x[N];			// state
+	float P[N][N];		// error covariance
+	float F[N][N];		// transition matrix
+	float H[M][N];		// measurement matrix
+	float Q[N][N];		// process noise covariance
+	float R[M][M];		// measurement noise covariance
+
+	// Non-zero entries of F and H (row, column, value), refreshed by the setters
+	int numF, numH;
+	int fRow[N * N], fCol[N * N];
+	float fVal[N * N];
+	int hRow[M * N], hCol[M * N];
+	float hVal[M * N];
+
+
+	/*
+	 * void listNonZero(const float* matrix, int rows, int* row, int* col, float* val, int& count)
+	 *
+	 * Description:
+	 * List the non-zero entries of a rows x N matrix.
+	 *
+	 * Inputs:
+	 *		const float* matrix			row major matrix, N columns
+	 *		int rows					number of rows
+	 *
+	 * Outputs:
+	 *		int* row, int* col, float* val	non-zero entries
+	 *		int& count					number of non-zero entries
+	 */
+	static void listNonZero(const float* matrix, int rows, int* row, int* col, float* val, int& count)
+	{
+		count = 0;
+		for (int r = 0; r < rows; r++)
+		{
+			for (int c = 0; c < N; c++)
+			{
+				if (matrix[r * N + c] != 0.0f)
+				{
+					row[count] = r;
+					col[count] = c;
+					val[count] = matrix[r * N + c];
+					count++;
+				}
+			}
+		}
+	}
+
+
+	/*
+	 * static bool invert(float (&a)[M][M], float (&inv)[M][M])
+	 *
+	 * Description:
+	 * Invert the innovation covariance (Gauss-Jordan with partial pivoting; closed form for M = 1, 2).
+	 *
+	 * Inputs:
+	 *		float (&a)[M][M]			matrix (destroyed)
+	 *
+	 * Outputs:
+	 *		float (&inv)[M][M]			inverse
+	 *		bool (return val)			false if the matrix is singular
+	 */
+	static bool invert(float (&a)[M][M], float (&inv)[M][M])
+	{
+		if (M == 1)
+		{
+			if (a[0][0] == 0.0f)
+				return false;
+			inv[0][0] = 1.0f / a[0][0];
+			return true;
+		}
+		if (M == 2)
+		{
+			// (M - 1 is 1 here, written that way so the indices are in range for every M)
+			float det = a[0][0] * a[M - 1][M - 1] - a[0][M - 1] * a[M - 1][0];
+			if (det == 0.0f)
+				return false;
+			float invDet = 1.0f / det;
+			inv[0][0] = a[M - 1][M - 1] * invDet;
+			inv[0][M - 1] = -a[0][M - 1] * invDet;
+			inv[M - 1][0] = -a[M - 1][0] * invDet;
+			inv[M - 1][M - 1] = a[0][0] * invDet;
+			return true;
+		}
+
+		for (int r = 0; r < M; r++)
+			for (int c = 0; c < M; c++)
+				inv[r][c] = (r == c) ? 1.0f : 0.0f;
+
+		for (int c = 0; c < M; c++)
+		{
+			int pivot = c;
+			for (int r = c + 1; r < M; r++)
+				if (std::fabs(a[r][c]) > std::fabs(a[pivot][c]))
+					pivot = r;
+			if (a[pivot][c] == 0.0f)
+				return false;
+			for (int k = 0; k < M; k++)
+			{
+				std::swap(a[c][k], a[pivot][k]);
+				std::swap(inv[c][k], inv[pivot][k]);
+			}
+
+			float scale = 1.0f / a[c][c];
+			for (int k = 0; k < M; k++)
+			{
+				a[c][k] *= scale;
+				inv[c][k] *= scale;
+			}
+			for (int r = 0; r < M; r++)
+			{
+				if (r == c || a[r][c] == 0.0f)
+					continue;
+				float f = a[r][c];
+				for (int k = 0; k < M; k++)
+				{
+					a[r][k] -= f * a[c][k];
+					inv[r][k] -= f * inv[c][k];
+				}
+			}
+		}
+		return true;
+	}
+
+
+	/*
+	 * void update(float (&state)[N], float (&cov)[N][N], const float (&z)[M]) const
+	 *
+	 * Description:
+	 * The correct() math on a state and error covariance held anywhere, with this filter's model (H, R). Lets
+	 * KalmanFilterBatch correct one of its filters without copying the model. If H P H' + R can't be inverted
+	 * state and cov are left as they were.
+	 *
+	 * Inputs:
+	 *		float (&state)[N]			state
+	 *		float (&cov)[N][N]			error covariance
+	 *		const float (&z)[M]			measurement
+	 *
+	 * Outputs:
+	 *		float (&state)[N]			corrected state
+	 *		float (&cov)[N][N]			corrected error covariance
+	 */
+	void update(float (&state)[N], float (&cov)[N][N], const float (&z)[M]) const
+	{
+		// PHt = P H'
+		float PHt[N][M] = {};
+		for (int i = 0; i < numH; i++)
+			for (int r = 0; r < N; r++)
+				PHt[r][hRow[i]] += hVal[i] * cov[r][hCol[i]];
+
+		// S = H PHt + R
+		float S[M][M], Sinv[M][M];
+		for (int r = 0; r < M; r++)
+			for (int c = 0; c < M; c++)
+				S[r][c] = R[r][c];
+		for (int i = 0; i < numH; i++)
+			for (int c = 0; c < M; c++)
+				S[hRow[i]][c] += hVal[i] * PHt[hCol[i]][c];
+		if (!invert(S, Sinv))
+			return;
+
+		// K = PHt S^-1
+		float K[N][M] = {};
+		for (int r = 0; r < N; r++)
+			for (int k = 0; k < M; k++)
+				for (int c = 0; c < M; c++)
+					K[r][c] += PHt[r][k] * Sinv[k][c];
+
+		// y = z - H x
+		float y[M];
+		for (int r = 0; r < M; r++)
+			y[r] = z[r];
+		for (int i = 0; i < numH; i++)
+			y[hRow[i]] -= hVal[i] * state[hCol[i]];
+
+		for (int r = 0; r < N; r++)
+			for (int k = 0; k < M; k++)
+				state[r] += K[r][k] * y[k];
+
+		// H P = PHt' (P is symmetric)
+		for (int r = 0; r < N; r++)
+			for (int c = 0; c < N; c++)
+				for (int k = 0; k < M; k++)
+					cov[r][c] -= K[r][k] * PHt[c][k];
+	}
+
+
+public:
+	/********** Public Members **********/
+
+	/*
+	 * FixedKalmanFilter(void)
+	 *
+	 * Description:
+	 * Constructor. Same defaults as cv::KalmanFilter: zero state, identity transition and error covariance,
+	 * identity process and measurement noise, zero measurement matrix.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	FixedKalmanFilter(void)
+	{
+		for (int r = 0; r < N; r++)
+		{
+			x[r] = 0.0f;
+			for (int c = 0; c < N; c++)
+				P[r][c] = F[r][c] = Q[r][c] = (r == c) ? 1.0f : 0.0f;
+		}
+		for (int r = 0; r < M; r++)
+		{
+			for (int c = 0; c < N; c++)
+				H[r][c] = 0.0f;
+			for (int c = 0; c < M; c++)
+				R[r][c] = (r == c) ? 1.0f : 0.0f;
+		}
+		listNonZero(&F[0][0], N, fRow, fCol, fVal, numF);
+		listNonZero(&H[0][0], M, hRow, hCol, hVal, numH);
+	}
+
+
+	/*
+	 * void setTransition(const float (&transition)[N][N]) / void setMeasurementMatrix(const float (&measurement)[M][N])
+	 *
+	 * Description:
+	 * Set the transition matrix F / measurement matrix H. Zero entries are skipped from then on.
+	 *
+	 * Inputs:
+	 *		const float (&transition)[N][N]		F
+	 *		const float (&measurement)[M][N]	H
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void setTransition(const float (&transition)[N][N])
+	{
+		for (int r = 0; r < N; r++)
+			for (int c = 0; c < N; c++)
+				F[r][c] = transition[r][c];
+		listNonZero(&F[0][0], N, fRow, fCol, fVal, numF);
+	}
+
+	void setMeasurementMatrix(const float (&measurement)[M][N])
+	{
+		for (int r = 0; r < M; r++)
+			for (int c = 0; c < N; c++)
+				H[r][c] = measurement[r][c];
+		listNonZero(&H[0][0], M, hRow, hCol, hVal, numH);
+	}
+
+
+	/*
+	 * void setMeasurementIdentity(void)
+	 *
+	 * Description:
+	 * Measure the first M state variables directly (H = [I 0], setIdentity(measurementMatrix) in OpenCV).
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void setMeasurementIdentity(void)
+	{
+		float identity[M][N];
+		for (int r = 0; r < M; r++)
+			for (int c = 0; c < N; c++)
+				identity[r][c] = (r == c) ? 1.0f : 0.0f;
+		setMeasurementMatrix(identity);
+	}
+
+
+	/*
+	 * void setProcessNoiseCov(float q) / void setMeasurementNoiseCov(float r) / void setErrorCov(float p)
+	 *
+	 * Description:
+	 * Set Q / R / P to a multiple of the identity (setIdentity(..., Scalar::all(v)) in OpenCV).
+	 *
+	 * Inputs:
+	 *		float q, r, p				diagonal value
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void setProcessNoiseCov(float q)
+	{
+		for (int r = 0; r < N; r++)
+			for (int c = 0; c < N; c++)
+				Q[r][c] = (r == c) ? q : 0.0f;
+	}
+
+	void setMeasurementNoiseCov(float r)
+	{
+		for (int i = 0; i < M; i++)
+			for (int j = 0; j < M; j++)
+				R[i][j] = (i == j) ? r : 0.0f;
+	}
+
+	void setErrorCov(float p)
+	{
+		for (int r = 0; r < N; r++)
+			for (int c = 0; c < N; c++)
+				P[r][c] = (r == c) ? p : 0.0f;
+	}
+
+
+	/*
+	 * void setState(const float (&state)[N])
+	 *
+	 * Description:
+	 * Set the state (statePost in OpenCV).
+	 *
+	 * Inputs:
+	 *		const float (&state)[N]		state
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void setState(const float (&state)[N])
+	{
+		for (int r = 0; r < N; r++)
+			x[r] = state[r];
+	}
+
+
+	/*
+	 * const float* getState(void) const / float getErrorCov(int r, int c) const
+	 *
+	 * Description:
+	 * Current state (N values) / one element of the error covariance.
+	 *
+	 * Inputs:
+	 *		int r, int c				row, column
+	 *
+	 * Outputs:
+	 *		const float* (return val)	state
+	 *		float (return val)			P[r][c]
+	 */
+	const float* getState(void) const
+	{
+		return x;
+	}
+
+	float getErrorCov(int r, int c) const
+	{
+		return P[r][c];
+	}
+
+
+	/*
+	 * const float* predict(void)
+	 *
+	 * Description:
+	 * Step the filter forward: x = F x, P = F P F' + Q.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		const float* (return val)	predicted state (N values)
+	 */
+	const float* predict(void)
+	{
+		float xNew[N] = {};
+		for (int i = 0; i < numF; i++)
+			xNew[fRow[i]] += fVal[i] * x[fCol[i]];
+		for (int r = 0; r < N; r++)
+			x[r] = xNew[r];
+
+		// A = F P, then P = A F' + Q
+		float A[N][N] = {};
+		for (int i = 0; i < numF; i++)
+			for (int c = 0; c < N; c++)
+				A[fRow[i]][c] += fVal[i] * P[fCol[i]][c];
+
+		for (int r = 0; r < N; r++)
+			for (int c = 0; c < N; c++)
+				P[r][c] = Q[r][c];
+		for (int i = 0; i < numF; i++)
+			for (int r = 0; r < N; r++)
+				P[r][fRow[i]] += fVal[i] * A[r][fCol[i]];
+
+		return x;
+	}
+
+
+	/*
+	 * const float* correct(const float (&z)[M])
+	 *
+	 * Description:
+	 * Update the filter with a measurement: K = P H' (H P H' + R)^-1, x = x + K (z - H x), P = P - K H P.
+	 * If H P H' + R can't be inverted the filter is left as it was.
+	 *
+	 * Inputs:
+	 *		const float (&z)[M]			measurement
+	 *
+	 * Outputs:
+	 *		const float* (return val)	corrected state (N values)
+	 */
+	const float* correct(const float (&z)[M])
+	{
+		update(x, P, z);
+		return x;
+	}
+};
+
+
+/*
+ * class KalmanFilterBatch
+ *
+ * Many FixedKalmanFilters that share one model (F, H, Q, R), stored as structure of arrays: element e of the state
+ * of every filter is stateArray(e)[0 .. size()-1], and the same for each error covariance element. predictAll()
+ * runs every step of predict() as one SIMD loop across all the filters. Filters are added at the end and removed
+ * by moving the last one into the hole (indices of other filters only change on remove()).
+ *
+ */
+template<int N, int M>
+class KalmanFilterBatch
+{
+	/********** Private Members **********/
+	FixedKalmanFilter<N, M> model;
+	size_t count;
+	std::vector<float> x[N], xNew[N];
+	std::vector<float> P[N][N], A[N][N];
+
+
+public:
+	/********** Public Members **********/
+
+	/*
+	 * KalmanFilterBatch(const FixedKalmanFilter<N, M>& filterModel)
+	 *
+	 * Description:
+	 * Constructor. Every filter in the batch uses filterModel's F, H, Q and R.
+	 *
+	 * Inputs:
+	 *		const FixedKalmanFilter<N, M>& filterModel	model
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	explicit KalmanFilterBatch(const FixedKalmanFilter<N, M>& filterModel) :
+		model(filterModel),
+		count(0)
+	{
+	}
+
+
+	/*
+	 * size_t size(void) const
+	 *
+	 * Description:
+	 * Number of filters in the batch.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		size_t (return val)			number of filters
+	 */
+	size_t size(void) const
+	{
+		return count;
+	}
+
+
+	/*
+	 * size_t add(const FixedKalmanFilter<N, M>& filter)
+	 *
+	 * Description:
+	 * Add a filter, starting from filter's state and error covariance.
+	 *
+	 * Inputs:
+	 *		const FixedKalmanFilter<N, M>& filter	filter to copy the state/covariance from
+	 *
+	 * Outputs:
+	 *		size_t (return val)			index of the new filter
+	 */
+	size_t add(const FixedKalmanFilter<N, M>& filter)
+	{
+		for (int r = 0; r < N; r++)
+		{
+			x[r].push_back(filter.x[r]);
+			xNew[r].push_back(0.0f);
+			for (int c = 0; c < N; c++)
+			{
+				P[r][c].push_back(filter.P[r][c]);
+				A[r][c].push_back(0.0f);
+			}
+		}
+		return count++;
+	}
+
+
+	/*
+	 * void remove(size_t idx)
+	 *
+	 * Description:
+	 * Remove a filter in O(1): the last filter moves to idx.
+	 *
+	 * Inputs:
+	 *		size_t idx					filter to remove
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void remove(size_t idx)
+	{
+		size_t last = count - 1;
+		for (int r = 0; r < N; r++)
+		{
+			x[r][idx] = x[r][last];
+			x[r].pop_back();
+			xNew[r].pop_back();
+			for (int c = 0; c < N; c++)
+			{
+				P[r][c][idx] = P[r][c][last];
+				P[r][c].pop_back();
+				A[r][c].pop_back();
+			}
+		}
+		count--;
+	}
+
+
+	/*
+	 * const float* stateArray(int element) const
+	 *
+	 * Description:
+	 * One state element of every filter (e.g. element 0 = x position of filter 0, 1, 2, ...).
+	 *
+	 * Inputs:
+	 *		int element					state element, 0 .. N-1
+	 *
+	 * Outputs:
+	 *		const float* (return val)	size() values
+	 */
+	const float* stateArray(int element) const
+	{
+		return x[element].data();
+	}
+
+
+	/*
+	 * void get(size_t idx, FixedKalmanFilter<N, M>& filter) const / void set(size_t idx, const FixedKalmanFilter<N, M>& filter)
+	 *
+	 * Description:
+	 * Copy one filter's state and error covariance out of / in to the batch.
+	 *
+	 * Inputs:
+	 *		size_t idx					filter
+	 *		const FixedKalmanFilter<N, M>& filter	filter to copy from (set)
+	 *
+	 * Outputs:
+	 *		FixedKalmanFilter<N, M>& filter		filter with the batch's model and filter idx's state (get)
+	 */
+	void get(size_t idx, FixedKalmanFilter<N, M>& filter) const
+	{
+		filter = model;
+		for (int r = 0; r < N; r++)
+		{
+			filter.x[r] = x[r][idx];
+			for (int c = 0; c < N; c++)
+				filter.P[r][c] = P[r][c][idx];
+		}
+	}
+
+	void set(size_t idx, const FixedKalmanFilter<N, M>& filter)
+	{
+		for (int r = 0; r < N; r++)
+		{
+			x[r][idx] = filter.x[r];
+			for (int c = 0; c < N; c++)
+				P[r][c][idx] = filter.P[r][c];
+		}
+	}
+
+
+	/*
+	 * void correct(size_t idx, const float (&z)[M])
+	 *
+	 * Description:
+	 * FixedKalmanFilter::correct() for one filter of the batch. Only that filter's state and error covariance
+	 * are gathered and scattered, the shared model is used where it is.
+	 *
+	 * Inputs:
+	 *		size_t idx					filter
+	 *		const float (&z)[M]			measurement
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void correct(size_t idx, const float (&z)[M])
+	{
+		float xOne[N], POne[N][N];
+		for (int r = 0; r < N; r++)
+		{
+			xOne[r] = x[r][idx];
+			for (int c = 0; c < N; c++)
+				POne[r][c] = P[r][c][idx];
+		}
+
+		model.update(xOne, POne, z);
+
+		for (int r = 0; r < N; r++)
+		{
+			x[r][idx] = xOne[r];
+			for (int c = 0; c < N; c++)
+				P[r][c][idx] = POne[r][c];
+		}
+	}
+
+
+	/*
+	 * void predictAll(void)
+	 *
+	 * Description:
+	 * FixedKalmanFilter::predict() for every filter in the batch, each step a SIMD loop over all the filters.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void predictAll(void)
+	{
+		if (count == 0)
+			return;
+
+		const FixedKalmanFilter<N, M>& m = model;
+
+		// x = F x
+		for (int r = 0; r < N; r++)
+			std::fill(xNew[r].begin(), xNew[r].end(), 0.0f);
+		for (int i = 0; i < m.numF; i++)
+			kalmanAxpy(m.fVal[i], x[m.fCol[i]].data(), xNew[m.fRow[i]].data(), count);
+		for (int r = 0; r < N; r++)
+			x[r].swap(xNew[r]);
+
+		// A = F P
+		for (int r = 0; r < N; r++)
+			for (int c = 0; c < N; c++)
+				std::fill(A[r][c].begin(), A[r][c].end(), 0.0f);
+		for (int i = 0; i < m.numF; i++)
+			for (int c = 0; c < N; c++)
+				kalmanAxpy(m.fVal[i], P[m.fCol[i]][c].data(), A[m.fRow[i]][c].data(), count);
+
+		// P = A F' + Q
+		for (int r = 0; r < N; r++)
+			for (int c = 0; c < N; c++)
+				std::fill(P[r][c].begin(), P[r][c].end(), m.Q[r][c]);
+		for (int i = 0; i < m.numF; i++)
+			for (int r = 0; r < N; r++)
+				kalmanAxpy(m.fVal[i], A[r][m.fCol[i]].data(), P[r][m.fRow[i]].data(), count);
+	}
+};
@@ -0,0 +1,350 @@
+/*
+ * Author:  Jordan Leiker
+ * Class: ECE6122
+ * Last Date Modified: 10/16/2026
+ *
+ * Description:
+ * This is the functional code for the FramePool class. FramePool is a fixed size pool of preallocated, 64 byte
+ * aligned frame buffers that hands out ordinary reference counted cv::Mat's (see FramePool.h).
+ *
+ */
+
+#include "FramePool.h"
+#include <algorithm>
+#include <cstdint>
+
+
+/*
+ * FramePool(void) :
+ *
+ * Description:
+ * Default constructor. The pool is empty (every allocation falls back to the heap) until configure() is called.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		N/A
+ */
+FramePool::FramePool(void) :
+    rows(0),
+    cols(0),
+    type(CV_8UC3),
+    bufferSize(0),
+    generation(1),
+    numBuffers(0),
+    inUse(0),
+    peakInUse(0),
+    acquired(0),
+    exhausted(0),
+    oversize(0)
+{
+}
+
+
+/*
+ * FramePool(int inRows, int inCols, int inType, size_t inNumBuffers) :
+ *
+ * Description:
+ * Constructor that immediately preallocates the pool. See configure().
+ *
+ * Inputs:
+ *		int inRows					frame height
+ *		int inCols					frame width
+ *		int inType					OpenCV frame type (e.g. CV_8UC3)
+ *		size_t inNumBuffers			number of buffers to preallocate
+ *
+ * Outputs:
+ *		N/A
+ */
+FramePool::FramePool(int inRows, int inCols, int inType, size_t inNumBuffers) :
+    FramePool()
+{
+    configure(inRows, inCols, inType, inNumBuffers);
+}
+
+
+/*
+ * ~FramePool(void) :
+ *
+ * Description:
+ * Destructor for FramePool class. Frees the pooled buffers.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		N/A
+ */
+FramePool::~FramePool(void)
+{
+    freeBuffers();
+}
+
+
+/*
+ * void freeBuffers(void);
+ *
+ * Description:
+ * (Private member function)
+ * Free every buffer sitting in the free list. Buffers still handed out are freed when they come back.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		N/A
+ */
+void FramePool::freeBuffers(void)
+{
+    for (auto& buffer : freeList)
+        cv::fastFree(buffer.origData);
+
+    freeList.clear();
+}
+
+
+/*
+ * void configure(int inRows, int inCols, int inType, size_t inNumBuffers);
+ *
+ * Description:
+ * (Public member function)
+ * (Re)allocate the pool for frames of the given size/type. Buffers of a previous configuration that are still
+ * handed out stay valid and are freed (not pooled) when they are released.
+ *
+ * Inputs:
+ *		int inRows					frame height
+ *		int inCols					frame width
+ *		int inType					OpenCV frame type (e.g. CV_8UC3)
+ *		size_t inNumBuffers			number of buffers to preallocate
+ *
+ * Outputs:
+ *		N/A
+ */
+void FramePool::configure(int inRows, int inCols, int inType, size_t inNumBuffers)
+{
+    std::lock_guard<std::mutex> lock(poolMutex);
+
+    freeBuffers();
+    generation++;
+
+    rows = inRows;
+    cols = inCols;
+    type = inType;
+    bufferSize = cv::alignSize(size_t(rows) * cols * CV_ELEM_SIZE(type), FRAME_POOL_ALIGN);
+
+    // Allocate every buffer up front with enough slack to align it to FRAME_POOL_ALIGN
+    freeList.reserve(inNumBuffers);
+    for (size_t i = 0; i < inNumBuffers; i++)
+    {
+        poolBuffer buffer;
+        buffer.origData = (uchar*)cv::fastMalloc(bufferSize + FRAME_POOL_ALIGN);
+        buffer.data = cv::alignPtr(buffer.origData, FRAME_POOL_ALIGN);
+        freeList.push_back(buffer);
+    }
+
+    // inUse is left alone, buffers from the old configuration are still out there
+    numBuffers = inNumBuffers;
+    peakInUse = inUse;
+}
+
+
+/*
+ * void acquire(cv::Mat& frame);
+ *
+ * Description:
+ * (Public member function)
+ * Drop whatever frame was holding and point it at a free pool buffer of the configured size/type.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		cv::Mat& frame				Mat backed by a pool buffer (heap buffer if the pool is exhausted)
+ */
+void FramePool::acquire(cv::Mat& frame)
+{
+    frame.release();
+    frame.allocator = this;
+    frame.create(rows, cols, type);
+}
+
+
+/*
+ * FramePoolStats getStats(void) const;
+ *
+ * Description:
+ * (Public member function)
+ * Get a snapshot of the pool usage counters.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		FramePoolStats (return val)	pool usage counters
+ */
+FramePoolStats FramePool::getStats(void) const
+{
+    std::lock_guard<std::mutex> lock(poolMutex);
+
+    FramePoolStats stats;
+    stats.numBuffers = numBuffers;
+    stats.inUse = inUse;
+    stats.peakInUse = peakInUse;
+    stats.acquired = acquired;
+    stats.exhausted = exhausted;
+    stats.oversize = oversize;
+
+    return stats;
+}
+
+
+/*
+ * cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const;
+ *
+ * Description:
+ * (cv::MatAllocator interface)
+ * Called by cv::Mat::create(). Hands out a pool buffer if one is free and large enough, otherwise falls back to the
+ * heap (and counts it). The step calculation mirrors OpenCV's default allocator.
+ *
+ * Inputs:
+ *		int dims					number of dimensions
+ *		const int* sizes			size of each dimension
+ *		int type					OpenCV element type
+ *		void* data					user supplied data (not pooled) or NULL
+ *		size_t* step				step of each dimension (filled in)
+ *
+ * Outputs:
+ *		cv::UMatData* (return val)	OpenCV buffer descriptor
+ */
+cv::UMatData* FramePool::allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                                  cv::AccessFlag /*flags*/, cv::UMatUsageFlags /*usageFlags*/) const
+{
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; i--)
+    {
+        if (step)
+        {
+            if (data && step[i] != CV_AUTOSTEP)
+            {
+                CV_Assert(total <= step[i]);
+                total = step[i];
+            }
+            else
+            {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+
+    cv::UMatData* u = new cv::UMatData(this);
+    u->size = total;
+
+    // User supplied memory is never pooled or freed by us
+    if (data)
+    {
+        u->data = u->origdata = (uchar*)data;
+        u->flags |= cv::UMatData::USER_ALLOCATED;
+        return u;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+
+        if (total <= bufferSize && !freeList.empty())
+        {
+            poolBuffer buffer = freeList.back();
+            freeList.pop_back();
+
+            u->data = buffer.data;
+            u->origdata = buffer.origData;
+            u->userdata = (void*)(uintptr_t)generation; // non-NULL marks a pooled buffer
+
+            acquired++;
+            inUse++;
+            peakInUse = std::max(peakInUse, inUse);
+            return u;
+        }
+
+        if (total > bufferSize)
+            oversize++;
+        else
+            exhausted++;
+    }
+
+    // Pool can't serve this request, fall back to a regular (aligned) heap buffer
+    u->origdata = (uchar*)cv::fastMalloc(total + FRAME_POOL_ALIGN);
+    u->data = cv::alignPtr(u->origdata, FRAME_POOL_ALIGN);
+    return u;
+}
+
+
+/*
+ * bool allocate(cv::UMatData* data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const;
+ *
+ * Description:
+ * (cv::MatAllocator interface)
+ * Only used for OpenCL UMat's, host memory is always already allocated.
+ *
+ * Inputs:
+ *		cv::UMatData* data			OpenCV buffer descriptor
+ *
+ * Outputs:
+ *		bool (return val)			true if data is valid
+ */
+bool FramePool::allocate(cv::UMatData* data, cv::AccessFlag /*accessFlags*/, cv::UMatUsageFlags /*usageFlags*/) const
+{
+    return data != NULL;
+}
+
+
+/*
+ * void deallocate(cv::UMatData* data) const;
+ *
+ * Description:
+ * (cv::MatAllocator interface)
+ * Called when the last Mat referencing a buffer is released. Pool buffers of the current configuration go back
+ * on the free list, anything else is freed.
+ *
+ * Inputs:
+ *		cv::UMatData* data			OpenCV buffer descriptor
+ *
+ * Outputs:
+ *		N/A
+ */
+void FramePool::deallocate(cv::UMatData* data) const
+{
+    if (!data)
+        return;
+
+    CV_Assert(data->urefcount == 0);
+    CV_Assert(data->refcount == 0);
+
+    if (!(data->flags & cv::UMatData::USER_ALLOCATED))
+    {
+        bool recycled = false;
+
+        if (data->userdata)
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+
+            inUse--;
+            if ((uintptr_t)data->userdata == generation)
+            {
+                poolBuffer buffer;
+                buffer.data = data->data;
+                buffer.origData = data->origdata;
+                freeList.push_back(buffer);
+                recycled = true;
+            }
+        }
+
+        if (!recycled)
+            cv::fastFree(data->origdata);
+    }
+
+    data->origdata = 0;
+    data->userdata = 0;
+    delete data;
+}
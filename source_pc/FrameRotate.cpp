@@ -0,0 +1,279 @@
+/*
+ * Author:  Jordan Leiker
+ * Class: ECE6122
+ * Last Date Modified: 10/16/2026
+ *
+ * Description:
+ * This is the functional code for the 180 degree frame rotation (see FrameRotate.h).
+ *
+ * Rotating by 180 degrees is "reverse the pixel order of each row, and write the rows bottom to top". All of the
+ * work is in reversing a row of 3 byte pixels, which is done in blocks of 16 pixels (48 bytes).
+ *
+ */
+
+#include "FrameRotate.h"
+#include <cstring>
+#include <vector>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define FRAME_ROTATE_NEON
+#include <arm_neon.h>
+#elif defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define FRAME_ROTATE_SSSE3
+#include <tmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define FRAME_ROTATE_TARGET_SSSE3
+#else
+#define FRAME_ROTATE_TARGET_SSSE3 __attribute__((target("ssse3")))
+#endif
+#endif
+
+
+/*
+ * static void reverseRowScalar(const uint8_t* src, uint8_t* dst, int cols);
+ *
+ * Description:
+ * Reverse the pixel order of one row of 3 byte pixels. src and dst must not overlap.
+ *
+ * Inputs:
+ *		const uint8_t* src			source row
+ *		int cols					pixels in the row
+ *
+ * Outputs:
+ *		uint8_t* dst				reversed row
+ */
+static void reverseRowScalar(const uint8_t* src, uint8_t* dst, int cols)
+{
+    const uint8_t* s = src + 3 * (cols - 1);
+    for (int col = 0; col < cols; col++, s -= 3, dst += 3)
+    {
+        dst[0] = s[0];
+        dst[1] = s[1];
+        dst[2] = s[2];
+    }
+}
+
+
+#ifdef FRAME_ROTATE_NEON
+/*
+ * static void reverseRowNeon(const uint8_t* src, uint8_t* dst, int cols);
+ *
+ * Description:
+ * NEON version of reverseRowScalar(). vld3 splits 16 pixels into B, G and R vectors, each is byte reversed and
+ * vst3 interleaves them back.
+ *
+ * Inputs:
+ *		const uint8_t* src			source row
+ *		int cols					pixels in the row
+ *
+ * Outputs:
+ *		uint8_t* dst				reversed row
+ */
+static void reverseRowNeon(const uint8_t* src, uint8_t* dst, int cols)
+{
+    int col = 0;
+    for (; col + 16 <= cols; col += 16)
+    {
+        uint8x16x3_t px = vld3q_u8(src + 3 * (cols - 16 - col));
+        for (int c = 0; c < 3; c++)
+        {
+            uint8x16_t v = vrev64q_u8(px.val[c]);
+            px.val[c] = vcombine_u8(vget_high_u8(v), vget_low_u8(v));
+        }
+        vst3q_u8(dst + 3 * col, px);
+    }
+
+    reverseRowScalar(src, dst + 3 * col, cols - col);
+}
+#endif
+
+
+#ifdef FRAME_ROTATE_SSSE3
+/*
+ * static void reverseRowSsse3(const uint8_t* src, uint8_t* dst, int cols);
+ *
+ * Description:
+ * SSSE3 version of reverseRowScalar(). 16 pixels are loaded as three 16 byte vectors, each output vector is
+ * gathered from the (at most three) input vectors holding its bytes with pshufb and OR'd together.
+ *
+ * Inputs:
+ *		const uint8_t* src			source row
+ *		int cols					pixels in the row
+ *
+ * Outputs:
+ *		uint8_t* dst				reversed row
+ */
+FRAME_ROTATE_TARGET_SSSE3
+static void reverseRowSsse3(const uint8_t* src, uint8_t* dst, int cols)
+{
+    // Shuffle masks: output vector m takes its bytes from input vector n (-1 = not from this input)
+    const __m128i m0from1 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 14);
+    const __m128i m0from2 = _mm_setr_epi8(13, 14, 15, 10, 11, 12, 7, 8, 9, 4, 5, 6, 1, 2, 3, -1);
+    const __m128i m1from0 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 15, -1);
+    const __m128i m1from1 = _mm_setr_epi8(15, -1, 11, 12, 13, 8, 9, 10, 5, 6, 7, 2, 3, 4, -1, 0);
+    const __m128i m1from2 = _mm_setr_epi8(-1, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i m2from0 = _mm_setr_epi8(-1, 12, 13, 14, 9, 10, 11, 6, 7, 8, 3, 4, 5, 0, 1, 2);
+    const __m128i m2from1 = _mm_setr_epi8(1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+    int col = 0;
+    for (; col + 16 <= cols; col += 16)
+    {
+        const __m128i* s = (const __m128i*)(src + 3 * (cols - 16 - col));
+        __m128i a0 = _mm_loadu_si128(s);
+        __m128i a1 = _mm_loadu_si128(s + 1);
+        __m128i a2 = _mm_loadu_si128(s + 2);
+
+        __m128i o0 = _mm_or_si128(_mm_shuffle_epi8(a1, m0from1), _mm_shuffle_epi8(a2, m0from2));
+        __m128i o1 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a0, m1from0), _mm_shuffle_epi8(a1, m1from1)),
+                                  _mm_shuffle_epi8(a2, m1from2));
+        __m128i o2 = _mm_or_si128(_mm_shuffle_epi8(a0, m2from0), _mm_shuffle_epi8(a1, m2from1));
+
+        __m128i* d = (__m128i*)(dst + 3 * col);
+        _mm_storeu_si128(d, o0);
+        _mm_storeu_si128(d + 1, o1);
+        _mm_storeu_si128(d + 2, o2);
+    }
+
+    reverseRowScalar(src, dst + 3 * col, cols - col);
+}
+
+
+/*
+ * static bool cpuHasSsse3(void);
+ *
+ * Description:
+ * Check (once) whether the CPU we are running on supports SSSE3.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		bool (return val)			true if SSSE3 is available
+ */
+static bool cpuHasSsse3(void)
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    return __builtin_cpu_supports("ssse3");
+#endif
+}
+#endif
+
+
+// Row reversal kernel for this machine, picked the first time it is needed
+typedef void (*reverseRowFn)(const uint8_t* src, uint8_t* dst, int cols);
+
+static reverseRowFn selectKernel(const char** name)
+{
+#if defined(FRAME_ROTATE_NEON)
+    *name = "neon";
+    return reverseRowNeon;
+#elif defined(FRAME_ROTATE_SSSE3)
+    if (cpuHasSsse3())
+    {
+        *name = "ssse3";
+        return reverseRowSsse3;
+    }
+#endif
+    *name = "scalar";
+    return reverseRowScalar;
+}
+
+static const char* kernelName = nullptr;
+static const reverseRowFn reverseRow = selectKernel(&kernelName);
+
+
+/*
+ * void rotate180BGR(const uint8_t* src, size_t srcStep, uint8_t* dst, size_t dstStep, int rows, int cols);
+ *
+ * Description:
+ * Rotate a 3 byte per pixel image by 180 degrees. src and dst must either be the same buffer (same pointer
+ * and step, rotated in place) or not overlap at all.
+ *
+ * Inputs:
+ *		const uint8_t* src			first pixel of the source image
+ *		size_t srcStep				bytes between source rows
+ *		size_t dstStep				bytes between destination rows
+ *		int rows					image height
+ *		int cols					image width (pixels)
+ *
+ * Outputs:
+ *		uint8_t* dst				first pixel of the rotated image
+ */
+void rotate180BGR(const uint8_t* src, size_t srcStep, uint8_t* dst, size_t dstStep, int rows, int cols)
+{
+    if (src != dst)
+    {
+        // Source row r becomes destination row (rows - 1 - r), reversed
+        for (int row = 0; row < rows; row++)
+            reverseRow(src + (size_t)row * srcStep, dst + (size_t)(rows - 1 - row) * dstStep, cols);
+        return;
+    }
+
+    // In place: swap the top and bottom rows of each pair through one row of scratch
+    thread_local std::vector<uint8_t> scratch;
+    scratch.resize((size_t)cols * 3);
+
+    for (int top = 0, bottom = rows - 1; top <= bottom; top++, bottom--)
+    {
+        uint8_t* topRow = dst + (size_t)top * dstStep;
+        uint8_t* bottomRow = dst + (size_t)bottom * dstStep;
+
+        memcpy(scratch.data(), topRow, scratch.size());
+        if (top != bottom)
+            reverseRow(bottomRow, topRow, cols);
+        reverseRow(scratch.data(), bottomRow, cols);
+    }
+}
+
+
+/*
+ * void rotate180(const cv::Mat& inImage, cv::Mat& outImage);
+ *
+ * Description:
+ * Rotate a CV_8UC3 or CV_8UC1 Mat by 180 degrees. outImage is (re)allocated only if it is not already the right
+ * size/type, so a pooled frame can be passed in, and it may be the same Mat as inImage (rotated in place).
+ *
+ * Inputs:
+ *		const cv::Mat& inImage		image to rotate (CV_8UC3 or CV_8UC1)
+ *
+ * Outputs:
+ *		cv::Mat& outImage			rotated image
+ */
+void rotate180(const cv::Mat& inImage, cv::Mat& outImage)
+{
+    // Single byte pixels are what cv::flip() is already vectorized for
+    if (inImage.type() == CV_8UC1)
+    {
+        cv::flip(inImage, outImage, -1);
+        return;
+    }
+
+    CV_Assert(inImage.type() == CV_8UC3);
+
+    // Mats sharing one buffer are rotated in place, create() leaves it alone since the size/type already match
+    outImage.create(inImage.rows, inImage.cols, CV_8UC3);
+    rotate180BGR(inImage.data, inImage.step, outImage.data, outImage.step, inImage.rows, inImage.cols);
+}
+
+
+/*
+ * const char* rotate180Kernel(void);
+ *
+ * Description:
+ * Name of the kernel rotate180BGR() runs on this machine ("ssse3", "neon" or "scalar").
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		const char* (return val)	kernel name
+ */
+const char* rotate180Kernel(void)
+{
+    return kernelName;
+}
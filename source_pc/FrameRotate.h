@@ -0,0 +1,71 @@
+/*
+ * Author:  Jordan Leiker
+ * Class: ECE6122
+ * Last Date Modified: 10/16/2026
+ *
+ * Description:
+ * This is the header file for the 180 degree frame rotation (horizontal + vertical flip) used when the camera is
+ * mounted upside down.
+ *
+ * The kernel reverses rows of 3 byte BGR pixels 16 pixels at a time with SIMD (SSSE3 shuffles on x86, NEON
+ * de-interleaving loads on ARM) and falls back to plain C++ elsewhere. The SSSE3 path is picked at run time so
+ * the same binary still runs on a CPU without it. It works in place or from one buffer into another, so the flip
+ * can take the place of a copy the caller has to do anyway.
+ *
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+
+
+/*
+ * void rotate180BGR(const uint8_t* src, size_t srcStep, uint8_t* dst, size_t dstStep, int rows, int cols);
+ *
+ * Description:
+ * Rotate a 3 byte per pixel image by 180 degrees. src and dst must either be the same buffer (same pointer
+ * and step, rotated in place) or not overlap at all.
+ *
+ * Inputs:
+ *		const uint8_t* src			first pixel of the source image
+ *		size_t srcStep				bytes between source rows
+ *		size_t dstStep				bytes between destination rows
+ *		int rows					image height
+ *		int cols					image width (pixels)
+ *
+ * Outputs:
+ *		uint8_t* dst				first pixel of the rotated image
+ */
+void rotate180BGR(const uint8_t* src, size_t srcStep, uint8_t* dst, size_t dstStep, int rows, int cols);
+
+
+/*
+ * void rotate180(const cv::Mat& inImage, cv::Mat& outImage);
+ *
+ * Description:
+ * Rotate a CV_8UC3 or CV_8UC1 Mat by 180 degrees. outImage is (re)allocated only if it is not already the right
+ * size/type, so a pooled frame can be passed in, and it may be the same Mat as inImage (rotated in place).
+ *
+ * Inputs:
+ *		const cv::Mat& inImage		image to rotate (CV_8UC3 or CV_8UC1)
+ *
+ * Outputs:
+ *		cv::Mat& outImage			rotated image
+ */
+void rotate180(const cv::Mat& inImage, cv::Mat& outImage);
+
+
+/*
+ * const char* rotate180Kernel(void);
+ *
+ * Description:
+ * Name of the kernel rotate180BGR() runs on this machine ("ssse3", "neon" or "scalar").
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		const char* (return val)	kernel name
+ */
+const char* rotate180Kernel(void);
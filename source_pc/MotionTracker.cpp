@@ -20,27 +20,46 @@
 
 
 /*
- * void detectObject(const Mat& inImage, Mat& outMask, KeyPoint& centroid);
+ * void detect(const Mat& inImage, Mat& outMask, std::vector<blob>& blobs);
  *
  * Description:
  * Perform motion segmentation using foreground detector, remove noise using morphological open+close, then
- * find any blobs and return their centers.
+ * find any blobs and return their boxes, centers and areas. With a SimpleBlobDetector the box is the square
+ * around the detector's size and the area is that of the circle.
  *
  * Inputs:
- *		N/A
+ *		const Mat& inImage				Video frame
  *
  * Outputs:
  *		Mat& outMask					Binary mask, same size as input. 255 = foreground, 0 = background
- *      KeyPoint& centroid				Centroid of detected object.
+ *										(inverted with a SimpleBlobDetector, it finds black blobs)
+ *      std::vector<blob>& blobs		Detected objects
  */
-void MotionTracker::detect(const Mat& inImage, Mat& outMask, std::vector<KeyPoint>& centroids)
+void MotionTracker::detect(const Mat& inImage, Mat& outMask, std::vector<blob>& blobs)
 {
 	// Segment the foreground from background
 	pBackSub->apply(inImage, outMask);
 
-	// Morpological open/close to remove noise
-	morphologyEx(outMask, outMask, MORPH_OPEN, openStrel);
-	morphologyEx(outMask, outMask, MORPH_CLOSE, closeStrel);
+	// Morpological open/close to remove noise. Rectangles (the usual case) run as separable constant time min/max
+	// filters (see RectMorphology.h), same output as morphologyEx.
+	if (isRectStrel(openStrel))
+		rectMorphology(outMask, outMask, MORPH_OPEN, openStrel.size());
+	else
+		morphologyEx(outMask, outMask, MORPH_OPEN, openStrel);
+
+	if (isRectStrel(closeStrel))
+		rectMorphology(outMask, outMask, MORPH_CLOSE, closeStrel.size());
+	else
+		morphologyEx(outMask, outMask, MORPH_CLOSE, closeStrel);
+
+	if (pBlobDetector.empty())
+	{
+		// The background detector outputs a mask that has the background as black, objects as white and shadows
+		// as gray. Turn objects + shadows to white, then label the white regions in one pass.
+		threshold(outMask, outMask, 1, 255, THRESH_BINARY);
+		extractBlobs(outMask, blobParams, blobs);
+		return;
+	}
 
 	// Binary threshold with inversion. The background detector outputs a mask that has the background as 
 	// black, objects as white and shadows as gray. So turn objects + shadows to white and keep the background black.
@@ -48,7 +67,41 @@ void MotionTracker::detect(const Mat& inImage, Mat& outMask, std::vector<KeyPoin
 	threshold(outMask, outMask, 1, 255, THRESH_BINARY_INV);
 
 	// Detect blobs / groups of related pixels and return their centroid
-	pBlobDetector->detect(outMask, centroids);
+	std::vector<KeyPoint> keypoints;
+	pBlobDetector->detect(outMask, keypoints);
+
+	blobs.clear();
+	for (auto& keypoint : keypoints)
+	{
+		blob b;
+		float radius = keypoint.size / 2;
+		b.bbox = Rect(Point(cvRound(keypoint.pt.x - radius), cvRound(keypoint.pt.y - radius)),
+			Point(cvRound(keypoint.pt.x + radius), cvRound(keypoint.pt.y + radius))) & Rect(0, 0, outMask.cols, outMask.rows);
+		b.centroid = keypoint.pt;
+		b.area = cvRound(CV_PI * radius * radius);
+		blobs.push_back(b);
+	}
+}
+
+
+/*
+ * void detect(const Mat& inImage, Mat& outMask, std::vector<KeyPoint>& centroids);
+ *
+ * Description:
+ * Same as above, but only return the centers (and sizes) of the blobs.
+ *
+ * Inputs:
+ *		const Mat& inImage				Video frame
+ *
+ * Outputs:
+ *		Mat& outMask					Binary mask, same size as input
+ *      std::vector<KeyPoint>& centroids	Centroids of detected objects
+ */
+void MotionTracker::detect(const Mat& inImage, Mat& outMask, std::vector<KeyPoint>& centroids)
+{
+	std::vector<blob> blobs;
+	detect(inImage, outMask, blobs);
+	blobsToKeyPoints(blobs, centroids);
 }
 
 
@@ -67,13 +120,8 @@ void MotionTracker::detect(const Mat& inImage, Mat& outMask, std::vector<KeyPoin
  */
 void MotionTracker::predictNewLocationsOfTracks(void)
 {
-	// For every detected track run the Kalman filter
-	for (auto& track : tracks)
-	{
-		Mat prediction = track.kalmanFilter.predict();
-		track.centroid.pt.x = prediction.at<float>(0);
-		track.centroid.pt.y = prediction.at<float>(1);
-	}
+	// Run every track's Kalman filter at once, each track moves to its prediction
+	tracks.predictAll();
 }
 
 
@@ -81,7 +129,7 @@ void MotionTracker::predictNewLocationsOfTracks(void)
  * void MotionTracker::createNewTrack(const KeyPoint& centroid)
  *
  * Description:
- * Initializes a new track and adds it to the tracks vector memeber variable
+ * Initializes a new track and adds it to the tracks table memeber variable
  * Note : The Kalman filter is configured for constant velocity tracking. See the following for more info:
  * https://www.mathworks.com/help/vision/ref/configurekalmanfilter.html#d122e144530
  * https://docs.opencv.org/master/de/d70/samples_2cpp_2kalman_8cpp-example.html#a23
@@ -93,30 +141,49 @@ void MotionTracker::predictNewLocationsOfTracks(void)
  *		N/A
  */
 void MotionTracker::createNewTrack(const KeyPoint& centroid)
+{
+	TrackFilter kf = trackFilterModel();
+	const float state[6] = { centroid.pt.x, centroid.pt.y, 0, 0, 0, 0 };
+	kf.setState(state); // Load state with current location of unassignedDetection (this estimates the starting point for the filter)
+	kf.setErrorCov(1);
+
+	// Add to table of tracks. Assign to current number and then increment for next track
+	tracks.add(numTracks++, kf, centroid);
+}
+
+
+/*
+ * static TrackFilter trackFilterModel(void)
+ *
+ * Description:
+ * The Kalman filter model every track uses (constant acceleration, measuring position).
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		TrackFilter (return val)	filter with the model set and a zero state
+ */
+TrackFilter MotionTracker::trackFilterModel(void)
 {
 	//KalmanFilter kf(4, 2, 0);
 	//kf.statePost = (Mat_<float>(4, 1) << centroid.pt.x, centroid.pt.y, 0, 0); // Load state with current location of unassignedDetection (this estimates the starting point for the filter)
 	//float dt = 1.0f / float(fps);
 	//kf.transitionMatrix = (Mat_<float>(4, 4) << 1, 0, dt, 0, 0, 1, 0, dt, 0, 0, 1, 0, 0, 0, 0, 1); // 'constant velocity'
-	KalmanFilter kf(6, 2, 0);
-	kf.statePost = (Mat_<float>(6, 1) << centroid.pt.x, centroid.pt.y, 0, 0, 0, 0); // Load state with current location of unassignedDetection (this estimates the starting point for the filter)
+	TrackFilter kf;
 	float dt = 2;// 1.0f / float(fps);
-	kf.transitionMatrix = (Mat_<float>(6, 6) << 1, 0, dt, 0, dt*dt, 0, 0, 1, 0, dt, 0, dt*dt, 0, 0, 1, 0, dt, 0, 0, 0 ,0 ,1, 0, dt, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 1); // 'constant velocity'
-	setIdentity(kf.measurementMatrix);
-	setIdentity(kf.processNoiseCov, Scalar::all(1e-5));
-	setIdentity(kf.measurementNoiseCov, Scalar::all(1e-1));
-	setIdentity(kf.errorCovPost, Scalar::all(1));
-	
-	track newTrack;
-	newTrack.kalmanFilter = kf;
-	newTrack.id = numTracks++; // Assign to current number and then increment for next track
-	newTrack.age = 1;
-	newTrack.totalVisibleCount = 1;
-	newTrack.consecutiveInvisibleCount = 0;
-	newTrack.flag = true;
-
-	// Add to array of tracks
-	tracks.push_back(newTrack);
+	const float transition[6][6] = {
+		{ 1, 0, dt, 0, dt*dt, 0 },
+		{ 0, 1, 0, dt, 0, dt*dt },
+		{ 0, 0, 1, 0, dt, 0 },
+		{ 0, 0, 0, 1, 0, dt },
+		{ 0, 0, 0, 0, 1, 0 },
+		{ 0, 0, 0, 0, 0, 1 } }; // 'constant velocity'
+	kf.setTransition(transition);
+	kf.setMeasurementIdentity();
+	kf.setProcessNoiseCov(1e-5f);
+	kf.setMeasurementNoiseCov(1e-1f);
+	return kf;
 }
 
 
@@ -134,25 +201,23 @@ void MotionTracker::createNewTrack(const KeyPoint& centroid)
  */
 void MotionTracker::deleteLostTracks(void)
 {
-	long int invisibleForTooLong = 20;
-	long int ageThreshold = 8;
+	unsigned long invisibleForTooLong = 20;
+	unsigned long ageThreshold = 8;
 
+	const std::vector<unsigned long>& ages = tracks.getAges();
+	const std::vector<unsigned long>& visibleCounts = tracks.getTotalVisibleCounts();
+	const std::vector<unsigned long>& invisibleCounts = tracks.getConsecutiveInvisibleCounts();
 
-	for (auto track = tracks.begin(); track != tracks.end(); ++track)
+	// One pass. Deleting moves the last track into this row, so the same row is checked again.
+	size_t row = 0;
+	while (row < tracks.size())
 	{
-		int idx = std::distance(tracks.begin(), track);
-
 		// Invisibility / age heuristics were taken straight from Matlab demo reference throughout 
-		int visibility = track->totalVisibleCount / track->age;
-		if ((track->age < ageThreshold && visibility < 0.6) || track->consecutiveInvisibleCount >= invisibleForTooLong)
-		{
-			tracks.erase(tracks.begin() + idx);
-
-			// Because erasing the track alters the vector, I recursively call deleteLostTracks to refresh the iterators with
-			// the newly allocated vector. Once all tracks are deleted the recursions will all return consecutively.
-			deleteLostTracks();
-			return;
-		}
+		double visibility = double(visibleCounts[row]) / ages[row];
+		if ((ages[row] < ageThreshold && visibility < 0.6) || invisibleCounts[row] >= invisibleForTooLong)
+			tracks.remove(row);
+		else
+			row++;
 	}
 }
 
@@ -171,88 +236,48 @@ void MotionTracker::deleteLostTracks(void)
  */
 void MotionTracker::getCentroids(std::vector<KeyPoint>& centroids)
 {
-	std::vector<KeyPoint> pts;
-	pts.resize(tracks.size());
-
-	for (auto& track : tracks)
-	{
-		pts.push_back(track.centroid);
-	}
-
-	centroids = pts;
+	tracks.getCentroids(centroids);
 }
 
 
 /*
- * void MotionTracker::assignDetectionsToTracks(std::vector<KeyPoint> centroids, double distCutoff)
+ * void MotionTracker::assignDetectionsToTracks(const std::vector<KeyPoint>& centroids, double distCutoff)
  *
  * Description:
- * Assigns all detections to a "most likely" track, i.e. a track with current position having L2 norm less than distCutoff from detection. 
- * If no paths exist wtihin distCutoff of the detection a new track is created.
+ * Assigns detections to tracks with the lowest total distance between each track's predicted position and its
+ * detection (see Assignment.h), never pairing a track and a detection distCutoff or more apart. Detections that
+ * aren't assigned start a new track.
  * 
  * IF the detection IS placed on a track then the Kalman Filter is updated along with all track parameters. Existing tracks that are not
  * assigned a new detection will have their "invisibility" parameters incremented
  *
  * Inputs:
- *		std::vector<KeyPoint> centroids				vector of detected objects KeyPoints that need placed
+ *		const std::vector<KeyPoint>& centroids		vector of detected objects KeyPoints that need placed
  *		double distCutoff							cutoff length for determining if a detection belongs to a track or not
  *
  * Outputs:
  *		N/A
  */
-void MotionTracker::assignDetectionsToTracks(std::vector<KeyPoint> centroids, double distCutoff)
+void MotionTracker::assignDetectionsToTracks(const std::vector<KeyPoint>& centroids, double distCutoff)
 {
-	// set all tracks flags to false initially so we can keep track of which tracks get new detections
-	for (auto& track : tracks)
-		track.flag = false;
-
-	// Cycle through all detected centriods and attempt to place to path
+	// Cost is the distance from the predicted position (predictNewLocationsOfTracks() left it in the track's position).
+	// Leaving a track and a detection both unassigned costs distCutoff, so closer pairs can be assigned and farther
+	// ones never are, like the old cutoff.
+	detectionPositions.clear();
 	for (auto& centroid : centroids)
-	{
-		bool assigned = false;
-
-		// This if/else only needed for intiialization
-		if (tracks.size() > 0)
-		{
-			// Check all tracks to try and assign
-			for (auto& track : tracks)
-			{
-				Mat st(track.kalmanFilter.statePost); // get current position (i.e. the first two kalman filter state variables)
-				Point2f curPoint(st.at<float>(0), st.at<float>(1));
+		detectionPositions.push_back(centroid.pt);
 
-				if (norm(curPoint - centroid.pt) < distCutoff)
-				{
-					track.kalmanFilter.correct((Mat_<float>(2, 1) << centroid.pt.x, centroid.pt.y));
-					track.centroid = centroid;
-					track.age++;
-					track.totalVisibleCount++;
-					track.consecutiveInvisibleCount = 0;
-					track.flag = true;
-					assigned = true;
-					break;
-				}
-			}
+	assignDetections(tracks.getPositions(), detectionPositions, float(distCutoff / 2), assignments, unassignedTracks, unassignedDetections,
+		assignmentWork);
 
-
-			// We checked all tracks but did not assign the detection to any, so create new track
-			if (!assigned)
-			{
-				createNewTrack(centroid);
-			}
-		}
-		else
-		{
-			createNewTrack(centroid);
-		}
-	}
+	for (auto& assignment : assignments)
+		tracks.detected(assignment.first, centroids[assignment.second]);
 
 	// If a track wasn't assigned a new detection then update the invisible track count (and age)
-	for (auto& track : tracks)
-	{
-		if (!track.flag)
-		{
-			track.age++;
-			track.consecutiveInvisibleCount++;
-		}
-	}
+	for (int row : unassignedTracks)
+		tracks.missed(row);
+
+	// Detections that didn't go to a track start new ones (after the updates above, they index the old rows)
+	for (int idx : unassignedDetections)
+		createNewTrack(centroids[idx]);
 }
@@ -18,21 +18,13 @@
 
 #pragma once
 #include <opencv2/opencv.hpp>
+#include "BlobExtract.h"
+#include "RectMorphology.h"
+#include "Assignment.h"
+#include "TrackStore.h"
 
 using namespace cv;
 
-// All track related information necessary for maintaing active/lost tracks
-struct track {
-	unsigned long id;
-	KeyPoint centroid;
-	KalmanFilter kalmanFilter;
-	unsigned long age;
-	unsigned long totalVisibleCount;
-	unsigned long consecutiveInvisibleCount;
-	bool flag;
-};
-
-
 /*
  * class VideoCapturePi
  *
@@ -49,16 +41,37 @@ class MotionTracker
 	/********** Private Members **********/
 	// Image Processing Members
 	Ptr<BackgroundSubtractorMOG2> pBackSub;
-	SimpleBlobDetector::Params blobParams;
+	BlobParams blobParams; // connected components detection (see BlobExtract.h), used when pBlobDetector is empty
 	Ptr<SimpleBlobDetector> pBlobDetector;
 	Mat openStrel;
 	Mat closeStrel; 
 	int fps;
 
 	// Motion Tracking Members
-	std::vector<track> tracks;
+	TrackStore tracks; // all track related information necessary for maintaing active/lost tracks
 	unsigned long numTracks;
 
+	// Assignment inputs, outputs and workspace, kept between frames so assigning doesn't allocate once they have
+	// grown to the busiest frame's size
+	std::vector<Point2f> detectionPositions;
+	std::vector<std::pair<int, int>> assignments;
+	std::vector<int> unassignedTracks, unassignedDetections;
+	AssignmentWorkspace assignmentWork;
+
+
+	/*
+	 * static TrackFilter trackFilterModel(void)
+	 *
+	 * Description:
+	 * The Kalman filter model every track uses (constant acceleration, measuring position).
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		TrackFilter (return val)	filter with the model set and a zero state
+	 */
+	static TrackFilter trackFilterModel(void);
 
 	
 public:	
@@ -77,6 +90,7 @@ public:
 	 *		N/A
 	 */
 	MotionTracker(void):
+		tracks(trackFilterModel()),
 		numTracks(0)
 	{
 		/******************** Background Subtractor Initialization ********************/
@@ -87,43 +101,17 @@ public:
 
 
 
-		/******************** Blob Detector Initialization ****************************/
-
-		// Change thresholds
-		// The image is separated in to multiple images:
-		// 1. thresholded @ minThreshold 
-		// 2. thresholded @ minThreshold + thresholdStep
-		// 3. ...
-		// 4. thresholded @ maxThreshold.
-		// Since the image I'm detecting in is not grayscale but B/W
-		// I'm choosing to do this in as few steps as possible for speed.
-		// Note: Unforunately it doesn't work to do min = 0, max = step. So choosing
-		// step to be JUST under max to minimize number of images.
-		blobParams.minThreshold = 0;
-		blobParams.maxThreshold = 254;
-		blobParams.thresholdStep = 253;
+		/******************** Blob Detection Initialization ***************************/
 
+		// Connected components on the binary mask (pBlobDetector stays empty)
 		// Sometimes things like trees break up a blob into a bunch of close blobs, so 
 		// combine anything within 50
 		blobParams.minDistBetweenBlobs = 50;
 
 		// Filter by Area
 		// Chosen based on image resolution/etc. This is a manually tuned param
-		blobParams.filterByArea = true;
 		blobParams.minArea = 400;
 
-		// Color disabled because we're using black/white
-		blobParams.filterByColor = false;
-
-		// Shape filters disabled
-		// Disable all filters that detect based on shape. These all deal with varying
-		// degrees of "how circular the blob is"
-		blobParams.filterByCircularity = false;
-		blobParams.filterByConvexity = false;
-		blobParams.filterByInertia = false;
-		
-		pBlobDetector = SimpleBlobDetector::create(blobParams);
-
 
 	
 		/************* Morphological Structuring Element Initialization ***************/
@@ -155,24 +143,72 @@ public:
 		openStrel(openStructEle),
 		closeStrel(closeStructEle),
 		fps(inFps),
+		tracks(trackFilterModel()),
 		numTracks(0)
 	{
 	}
 
 
 	/*
-	 * void detectObject(const Mat& inImage, Mat& outMask, KeyPoint& centroid);
+	 * MotionTracker(cv::Ptr<cv::BackgroundSubtractorMOG2> ptrBackSub, const BlobParams& params, cv::Mat openStructEle, cv::Mat closeStructEle, int inFps):
 	 *
 	 * Description:
-	 * Perform motion segmentation using foreground detector, remove noise using morphological open+close, then
-	 * find any blobs and return their centers.
+	 * Constructor for full customization of image processing algorithm, detecting blobs with connected components
+	 * (see BlobExtract.h) instead of a SimpleBlobDetector.
 	 *
 	 * Inputs:
+	 *		Ptr<cv::BackgroundSubtractorMOG2> ptrBackSub		Pointer to background subtractor
+	 *      const BlobParams& params							Blob area limits / merge distance
+	 *      Mat openStructEle									Morphological opening structural element (for noise after foreground estimation/background subtract)
+	 *      Mat closeStructEle									Morphological closing structural element (for noise after foreground estimation/background subtract)
+	 *		int fps												the fps of the camera
+	 *
+	 * Outputs:
 	 *		N/A
+	 */
+	MotionTracker(Ptr<BackgroundSubtractorMOG2> ptrBackSub, const BlobParams& params, Mat openStructEle, Mat closeStructEle, int inFps):
+		pBackSub(ptrBackSub),
+		blobParams(params),
+		openStrel(openStructEle),
+		closeStrel(closeStructEle),
+		fps(inFps),
+		tracks(trackFilterModel()),
+		numTracks(0)
+	{
+	}
+
+
+	/*
+	 * void detect(const Mat& inImage, Mat& outMask, std::vector<blob>& blobs);
+	 *
+	 * Description:
+	 * Perform motion segmentation using foreground detector, remove noise using morphological open+close, then
+	 * find any blobs and return their boxes, centers and areas. With a SimpleBlobDetector the box is the square
+	 * around the detector's size and the area is that of the circle.
+	 *
+	 * Inputs:
+	 *		const Mat& inImage				Video frame
 	 *
 	 * Outputs:
 	 *		Mat& outMask					Binary mask, same size as input. 255 = foreground, 0 = background
-	 *      KeyPoint& centroid				Centroid of detected object.
+	 *										(inverted with a SimpleBlobDetector, it finds black blobs)
+	 *      std::vector<blob>& blobs		Detected objects
+	 */
+	void detect(const Mat& inImage, Mat& outMask, std::vector<blob>& blobs);
+
+
+	/*
+	 * void detect(const Mat& inImage, Mat& outMask, std::vector<KeyPoint>& centroids);
+	 *
+	 * Description:
+	 * Same as above, but only return the centers (and sizes) of the blobs.
+	 *
+	 * Inputs:
+	 *		const Mat& inImage				Video frame
+	 *
+	 * Outputs:
+	 *		Mat& outMask					Binary mask, same size as input
+	 *      std::vector<KeyPoint>& centroids	Centroids of detected objects
 	 */
 	void detect(const Mat& inImage, Mat& outMask, std::vector<KeyPoint>& centroids);
 
@@ -197,7 +233,7 @@ public:
 	 * void createNewTrack(const KeyPoint& centroid)
 	 *
 	 * Description:
-	 * Initializes a new track and adds it to the tracks vector memeber variable
+	 * Initializes a new track and adds it to the tracks table memeber variable
 	 * Note : The Kalman filter is configured for constant velocity tracking. See the following for more info:
 	 * https://www.mathworks.com/help/vision/ref/configurekalmanfilter.html#d122e144530
 	 * https://docs.opencv.org/master/de/d70/samples_2cpp_2kalman_8cpp-example.html#a23
@@ -243,22 +279,23 @@ public:
 
 
 	/*
-	 * void MotionTracker::assignDetectionsToTracks(std::vector<KeyPoint> centroids, double distCutoff)
+	 * void MotionTracker::assignDetectionsToTracks(const std::vector<KeyPoint>& centroids, double distCutoff)
 	 *
 	 * Description:
-	 * Assigns all detections to a "most likely" track, i.e. a track with current position having L2 norm less than distCutoff from detection.
-	 * If no paths exist wtihin distCutoff of the detection a new track is created.
+	 * Assigns detections to tracks with the lowest total distance between each track's predicted position and its
+	 * detection (see Assignment.h), never pairing a track and a detection distCutoff or more apart. Detections that
+	 * aren't assigned start a new track.
 	 *
 	 * IF the detection IS placed on a track then the Kalman Filter is updated along with all track parameters. Existing tracks that are not
 	 * assigned a new detection will have their "invisibility" parameters incremented
 	 *
 	 * Inputs:
-	 *		std::vector<KeyPoint> centroids				vector of detected objects KeyPoints that need placed
+	 *		const std::vector<KeyPoint>& centroids		vector of detected objects KeyPoints that need placed
 	 *		double distCutoff							cutoff length for determining if a detection belongs to a track or not
 	 *
 	 * Outputs:
 	 *		N/A
 	 */
-	void assignDetectionsToTracks(std::vector<KeyPoint> centroids, double distCutoff);
+	void assignDetectionsToTracks(const std::vector<KeyPoint>& centroids, double distCutoff);
 
 };
\ No newline at end of file
@@ -0,0 +1,499 @@
+/*
+ * Author:  Jordan Leiker
+ * Class: ECE6122
+ * Last Date Modified: 10/16/2026
+ *
+ * Description:
+ * This is the functional code for the rectangular structuring element morphology (see RectMorphology.h).
+ *
+ */
+
+#include "RectMorphology.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define RECT_MORPHOLOGY_NEON
+#include <arm_neon.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RECT_MORPHOLOGY_SSE2 // part of the x86-64 baseline, so no run time check
+#include <emmintrin.h>
+#endif
+
+#define LANES 16        // pixels per SIMD vector, and rows the row pass transposes at a time
+#define MIN_STRIPE_ROWS 64
+#define TILE_COLS 128   // width of one column pass tile, keeps its scratch in L1/L2
+
+
+#if defined(RECT_MORPHOLOGY_NEON)
+typedef uint8x16_t vec8x16;
+static inline vec8x16 load16(const uint8_t* p) { return vld1q_u8(p); }
+static inline void store16(uint8_t* p, vec8x16 v) { vst1q_u8(p, v); }
+static inline vec8x16 min16(vec8x16 a, vec8x16 b) { return vminq_u8(a, b); }
+static inline vec8x16 max16(vec8x16 a, vec8x16 b) { return vmaxq_u8(a, b); }
+static inline void zip16(vec8x16 a, vec8x16 b, vec8x16& lo, vec8x16& hi)
+{
+    uint8x16x2_t z = vzipq_u8(a, b);
+    lo = z.val[0];
+    hi = z.val[1];
+}
+#elif defined(RECT_MORPHOLOGY_SSE2)
+typedef __m128i vec8x16;
+static inline vec8x16 load16(const uint8_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+static inline void store16(uint8_t* p, vec8x16 v) { _mm_storeu_si128((__m128i*)p, v); }
+static inline vec8x16 min16(vec8x16 a, vec8x16 b) { return _mm_min_epu8(a, b); }
+static inline vec8x16 max16(vec8x16 a, vec8x16 b) { return _mm_max_epu8(a, b); }
+static inline void zip16(vec8x16 a, vec8x16 b, vec8x16& lo, vec8x16& hi)
+{
+    lo = _mm_unpacklo_epi8(a, b);
+    hi = _mm_unpackhi_epi8(a, b);
+}
+#endif
+
+#if defined(RECT_MORPHOLOGY_NEON) || defined(RECT_MORPHOLOGY_SSE2)
+#define RECT_MORPHOLOGY_SIMD
+#endif
+
+
+/*
+ * struct erodeOp / struct dilateOp
+ *
+ * Description:
+ * The min (erode) / max (dilate) the passes are templated on, and its identity (the value pixels outside the
+ * image take, so they never change the result).
+ *
+ */
+struct erodeOp
+{
+    enum { identity = 255 };
+    static inline uint8_t apply(uint8_t a, uint8_t b) { return a < b ? a : b; }
+#ifdef RECT_MORPHOLOGY_SIMD
+    static inline vec8x16 apply(vec8x16 a, vec8x16 b) { return min16(a, b); }
+#endif
+};
+
+struct dilateOp
+{
+    enum { identity = 0 };
+    static inline uint8_t apply(uint8_t a, uint8_t b) { return a > b ? a : b; }
+#ifdef RECT_MORPHOLOGY_SIMD
+    static inline vec8x16 apply(vec8x16 a, vec8x16 b) { return max16(a, b); }
+#endif
+};
+
+
+/*
+ * template<class Op> static void combineLines(const uint8_t* a, const uint8_t* b, uint8_t* dst, int width, bool simd);
+ *
+ * Description:
+ * dst = Op(a, b), element wise.
+ *
+ * Inputs:
+ *		const uint8_t* a, const uint8_t* b	input lines
+ *		int width					elements per line
+ *		bool simd					use the SIMD kernel
+ *
+ * Outputs:
+ *		uint8_t* dst				output line (may be a or b)
+ */
+template<class Op>
+static inline void combineLines(const uint8_t* a, const uint8_t* b, uint8_t* dst, int width, bool simd)
+{
+    int i = 0;
+#ifdef RECT_MORPHOLOGY_SIMD
+    if (simd)
+    {
+        for (; i + LANES <= width; i += LANES)
+            store16(dst + i, Op::apply(load16(a + i), load16(b + i)));
+    }
+#else
+    (void)simd;
+#endif
+    for (; i < width; i++)
+        dst[i] = Op::apply(a[i], b[i]);
+}
+
+
+/*
+ * template<class Op, class InLine, class OutLine>
+ * static void vanHerkGilWerman(InLine inLine, OutLine outLine, int n, int k, int width, uint8_t* h, uint8_t* g, bool simd);
+ *
+ * Description:
+ * 1D van Herk/Gil-Werman min/max filter over a sequence of lines, every element of a line filtered independently:
+ * output line y = Op over input lines y .. y+k-1. Input lines are cut into blocks of k; for the block starting at
+ * s, h holds the backward running values (h[i] = Op(in[s+i .. s+k-1])) and g the forward ones of the next block
+ * (g[i] = Op(in[s+k .. s+k+i])), so output s+i = Op(h[i], g[i-1]).
+ *
+ * Inputs:
+ *		InLine inLine				inLine(j) = input line j, for j in [0, n + 2k - 2) (identity past the image)
+ *		int n						number of output lines
+ *		int k						window length
+ *		int width					elements per line
+ *		uint8_t* h, uint8_t* g		scratch, k lines each
+ *		bool simd					use the SIMD kernel
+ *
+ * Outputs:
+ *		OutLine outLine				outLine(y) = output line y, for y in [0, n)
+ */
+template<class Op, class InLine, class OutLine>
+static void vanHerkGilWerman(InLine inLine, OutLine outLine, int n, int k, int width, uint8_t* h, uint8_t* g, bool simd)
+{
+    for (int start = 0; start < n; start += k)
+    {
+        std::memcpy(h + (size_t)(k - 1) * width, inLine(start + k - 1), width);
+        for (int i = k - 2; i >= 0; i--)
+            combineLines<Op>(h + (size_t)(i + 1) * width, inLine(start + i), h + (size_t)i * width, width, simd);
+
+        if (k > 1)
+        {
+            std::memcpy(g, inLine(start + k), width);
+            for (int i = 1; i < k - 1; i++)
+                combineLines<Op>(g + (size_t)(i - 1) * width, inLine(start + k + i), g + (size_t)i * width, width, simd);
+        }
+
+        // The window starting at the block start is the whole block
+        std::memcpy(outLine(start), h, width);
+        for (int i = 1; i < k && start + i < n; i++)
+            combineLines<Op>(h + (size_t)i * width, g + (size_t)(i - 1) * width, outLine(start + i), width, simd);
+    }
+}
+
+
+/*
+ * static void transpose16x16(const uint8_t* src, size_t srcStep, uint8_t* dst, size_t dstStep);
+ *
+ * Description:
+ * Transpose a 16x16 block of bytes. Interleaving row i with row i+8 (for i < 8) moves the top bit of the row index
+ * to the bottom of the column index and rotates the rest up by one, so four rounds of it are a transpose.
+ *
+ * Inputs:
+ *		const uint8_t* src			first byte of the block
+ *		size_t srcStep				bytes between src rows
+ *		size_t dstStep				bytes between dst rows
+ *
+ * Outputs:
+ *		uint8_t* dst				first byte of the transposed block
+ */
+#ifdef RECT_MORPHOLOGY_SIMD
+static inline void transpose16x16(const uint8_t* src, size_t srcStep, uint8_t* dst, size_t dstStep)
+{
+    vec8x16 a[LANES], b[LANES];
+    for (int i = 0; i < LANES; i++)
+        a[i] = load16(src + i * srcStep);
+
+    // Four rounds, a -> b -> a -> b -> a
+    for (int i = 0; i < LANES / 2; i++)
+        zip16(a[i], a[i + LANES / 2], b[2 * i], b[2 * i + 1]);
+    for (int i = 0; i < LANES / 2; i++)
+        zip16(b[i], b[i + LANES / 2], a[2 * i], a[2 * i + 1]);
+    for (int i = 0; i < LANES / 2; i++)
+        zip16(a[i], a[i + LANES / 2], b[2 * i], b[2 * i + 1]);
+    for (int i = 0; i < LANES / 2; i++)
+        zip16(b[i], b[i + LANES / 2], a[2 * i], a[2 * i + 1]);
+
+    for (int i = 0; i < LANES; i++)
+        store16(dst + i * dstStep, a[i]);
+}
+#endif
+
+
+/*
+ * template<class Op> static void rowPass(const cv::Mat& src, cv::Mat& dst, int k, int anchor, int firstGroup, int lastGroup, bool simd);
+ *
+ * Description:
+ * Filter each row of groups [firstGroup, lastGroup) of 16 rows with a k wide window (anchor pixels left of the
+ * output pixel). Each group is transposed so its 16 rows are the elements of a line, one line per column, filtered
+ * with vanHerkGilWerman(), and transposed back. A group is read before it is written, so src may be dst.
+ *
+ * Inputs:
+ *		const cv::Mat& src			8 bit single channel image
+ *		int k						window width
+ *		int anchor					window offset
+ *		int firstGroup, int lastGroup	groups of 16 rows to filter
+ *		bool simd					use the SIMD kernels
+ *
+ * Outputs:
+ *		cv::Mat& dst				filtered rows
+ */
+template<class Op>
+static void rowPass(const cv::Mat& src, cv::Mat& dst, int k, int anchor, int firstGroup, int lastGroup, bool simd)
+{
+    const int cols = src.cols;
+    const int inLines = cols + 2 * k - 2;
+
+    thread_local std::vector<uint8_t> scratch;
+    scratch.resize((size_t)(inLines + cols + 2 * k) * LANES);
+    uint8_t* in = scratch.data();
+    uint8_t* out = in + (size_t)inLines * LANES;
+    uint8_t* h = out + (size_t)cols * LANES;
+    uint8_t* g = h + (size_t)k * LANES;
+
+    // Lines left and right of the image
+    std::memset(in, Op::identity, (size_t)anchor * LANES);
+    std::memset(in + (size_t)(anchor + cols) * LANES, Op::identity, (size_t)(inLines - anchor - cols) * LANES);
+    uint8_t* body = in + (size_t)anchor * LANES;
+
+    for (int group = firstGroup; group < lastGroup; group++)
+    {
+        const int row0 = group * LANES;
+        const int numRows = std::min(LANES, src.rows - row0);
+
+        int col = 0;
+#ifdef RECT_MORPHOLOGY_SIMD
+        const bool fullGroup = simd && numRows == LANES;
+        if (fullGroup)
+        {
+            for (; col + LANES <= cols; col += LANES)
+                transpose16x16(src.ptr<uint8_t>(row0) + col, src.step, body + (size_t)col * LANES, LANES);
+        }
+#endif
+        for (; col < cols; col++)
+        {
+            for (int r = 0; r < LANES; r++)
+                body[(size_t)col * LANES + r] = r < numRows ? src.ptr<uint8_t>(row0 + r)[col] : uint8_t(Op::identity);
+        }
+
+        vanHerkGilWerman<Op>([&](int j) { return in + (size_t)j * LANES; }, [&](int y) { return out + (size_t)y * LANES; },
+                             cols, k, LANES, h, g, simd);
+
+        col = 0;
+#ifdef RECT_MORPHOLOGY_SIMD
+        if (fullGroup)
+        {
+            for (; col + LANES <= cols; col += LANES)
+                transpose16x16(out + (size_t)col * LANES, LANES, dst.ptr<uint8_t>(row0) + col, dst.step);
+        }
+#endif
+        for (; col < cols; col++)
+        {
+            for (int r = 0; r < numRows; r++)
+                dst.ptr<uint8_t>(row0 + r)[col] = out[(size_t)col * LANES + r];
+        }
+    }
+}
+
+
+/*
+ * template<class Op> static void colPass(const cv::Mat& src, cv::Mat& dst, int k, int anchor, int firstTile, int lastTile, bool simd);
+ *
+ * Description:
+ * Filter each column of tiles [firstTile, lastTile) of TILE_COLS columns with a k tall window (anchor pixels above
+ * the output pixel). Rows of a tile are the lines for vanHerkGilWerman(). src must not be dst.
+ *
+ * Inputs:
+ *		const cv::Mat& src			8 bit single channel image
+ *		int k						window height
+ *		int anchor					window offset
+ *		int firstTile, int lastTile	tiles of columns to filter
+ *		bool simd					use the SIMD kernel
+ *
+ * Outputs:
+ *		cv::Mat& dst				filtered columns
+ */
+template<class Op>
+static void colPass(const cv::Mat& src, cv::Mat& dst, int k, int anchor, int firstTile, int lastTile, bool simd)
+{
+    thread_local std::vector<uint8_t> scratch;
+    scratch.resize((size_t)(2 * k + 1) * TILE_COLS);
+    uint8_t* h = scratch.data();
+    uint8_t* g = h + (size_t)k * TILE_COLS;
+    uint8_t* outside = g + (size_t)k * TILE_COLS; // a row above/below the image
+    std::memset(outside, Op::identity, TILE_COLS);
+
+    for (int tile = firstTile; tile < lastTile; tile++)
+    {
+        const int col0 = tile * TILE_COLS;
+        const int width = std::min(TILE_COLS, src.cols - col0);
+
+        vanHerkGilWerman<Op>(
+            [&](int j) {
+                int row = j - anchor;
+                return (row >= 0 && row < src.rows) ? src.ptr<uint8_t>(row) + col0 : (const uint8_t*)outside;
+            },
+            [&](int y) { return dst.ptr<uint8_t>(y) + col0; }, src.rows, k, width, h, g, simd);
+    }
+}
+
+
+/*
+ * static void forEachStripe(int items, int minItems, int flags, const std::function<void(int, int)>& body);
+ *
+ * Description:
+ * Run body over [0, items), split into stripes on OpenCV's thread pool unless there are fewer than 2 * minItems
+ * items or RECT_MORPHOLOGY_SINGLE_THREAD is set.
+ *
+ * Inputs:
+ *		int items					number of row groups / column tiles
+ *		int minItems				fewest items worth a stripe
+ *		int flags					RECT_MORPHOLOGY_* flags
+ *		body						called with [first, last) items of one stripe
+ *
+ * Outputs:
+ *		N/A
+ */
+static void forEachStripe(int items, int minItems, int flags, const std::function<void(int, int)>& body)
+{
+    int stripes = std::min(cv::getNumThreads(), items / minItems);
+    if ((flags & RECT_MORPHOLOGY_SINGLE_THREAD) || stripes <= 1)
+    {
+        body(0, items);
+        return;
+    }
+
+    cv::parallel_for_(cv::Range(0, items), [&](const cv::Range& range) { body(range.start, range.end); }, stripes);
+}
+
+
+/*
+ * template<class Op> static void rectFilter(const cv::Mat& src, cv::Mat& dst, cv::Size ksize, cv::Point anchor, cv::Mat& tmp, int flags);
+ *
+ * Description:
+ * Erode or dilate with a ksize rectangle: the row pass into tmp, then the column pass into dst (a pass whose
+ * window is 1 pixel long is skipped).
+ *
+ * Inputs:
+ *		const cv::Mat& src			8 bit single channel image
+ *		cv::Size ksize				rectangle size
+ *		cv::Point anchor			anchor within the rectangle
+ *		cv::Mat& tmp				scratch image (not src or dst)
+ *		int flags					RECT_MORPHOLOGY_* flags
+ *
+ * Outputs:
+ *		cv::Mat& dst				filtered image (may be src)
+ */
+template<class Op>
+static void rectFilter(const cv::Mat& src, cv::Mat& dst, cv::Size ksize, cv::Point anchor, cv::Mat& tmp, int flags)
+{
+    bool simd = false;
+#ifdef RECT_MORPHOLOGY_SIMD
+    simd = !(flags & RECT_MORPHOLOGY_SCALAR);
+#endif
+    dst.create(src.size(), CV_8UC1);
+
+    // Row pass, straight into dst when there is no column pass (it can run in place)
+    const cv::Mat* rowsDone = &src;
+    if (ksize.width > 1)
+    {
+        cv::Mat& rowOut = (ksize.height > 1) ? tmp : dst;
+        rowOut.create(src.size(), CV_8UC1);
+        const int groups = (src.rows + LANES - 1) / LANES;
+        forEachStripe(groups, MIN_STRIPE_ROWS / LANES, flags, [&](int first, int last) {
+            rowPass<Op>(src, rowOut, ksize.width, anchor.x, first, last, simd);
+        });
+        rowsDone = &rowOut;
+    }
+
+    if (ksize.height == 1)
+    {
+        if (rowsDone->data != dst.data)
+            rowsDone->copyTo(dst);
+        return;
+    }
+
+    // The column pass can't run in place
+    if (rowsDone->data == dst.data)
+    {
+        rowsDone->copyTo(tmp);
+        rowsDone = &tmp;
+    }
+
+    const int tiles = (src.cols + TILE_COLS - 1) / TILE_COLS;
+    forEachStripe(tiles, 1, flags, [&](int first, int last) {
+        colPass<Op>(*rowsDone, dst, ksize.height, anchor.y, first, last, simd);
+    });
+}
+
+
+/*
+ * bool isRectStrel(const cv::Mat& strel);
+ *
+ * Description:
+ * Whether a structuring element is a solid rectangle (every element set), i.e. rectMorphology() can run it.
+ *
+ * Inputs:
+ *		const cv::Mat& strel		structuring element
+ *
+ * Outputs:
+ *		bool (return val)			true if rectangular
+ */
+bool isRectStrel(const cv::Mat& strel)
+{
+    return !strel.empty() && strel.type() == CV_8UC1 && cv::countNonZero(strel) == (int)strel.total();
+}
+
+
+/*
+ * void rectMorphology(const cv::Mat& src, cv::Mat& dst, int op, cv::Size ksize, cv::Point anchor = cv::Point(-1, -1), int flags = 0);
+ *
+ * Description:
+ * Same as cv::morphologyEx(src, dst, op, getStructuringElement(MORPH_RECT, ksize), anchor). src may be dst.
+ *
+ * Inputs:
+ *		const cv::Mat& src			8 bit single channel image
+ *		int op						MORPH_ERODE, MORPH_DILATE, MORPH_OPEN or MORPH_CLOSE
+ *		cv::Size ksize				rectangle size
+ *		cv::Point anchor			anchor within the rectangle, (-1, -1) = center
+ *		int flags					RECT_MORPHOLOGY_* flags
+ *
+ * Outputs:
+ *		cv::Mat& dst				filtered image, same size as src
+ */
+void rectMorphology(const cv::Mat& src, cv::Mat& dst, int op, cv::Size ksize, cv::Point anchor, int flags)
+{
+    CV_Assert(src.type() == CV_8UC1 && ksize.width > 0 && ksize.height > 0);
+    if (anchor.x < 0)
+        anchor.x = ksize.width / 2;
+    if (anchor.y < 0)
+        anchor.y = ksize.height / 2;
+    CV_Assert(anchor.x < ksize.width && anchor.y < ksize.height);
+
+    // Scratch kept between calls (MotionTracker filters every frame at the same size)
+    thread_local cv::Mat tmp, mid;
+
+    switch (op)
+    {
+    case cv::MORPH_ERODE:
+        rectFilter<erodeOp>(src, dst, ksize, anchor, tmp, flags);
+        break;
+    case cv::MORPH_DILATE:
+        rectFilter<dilateOp>(src, dst, ksize, anchor, tmp, flags);
+        break;
+    case cv::MORPH_OPEN:
+        rectFilter<erodeOp>(src, mid, ksize, anchor, tmp, flags);
+        rectFilter<dilateOp>(mid, dst, ksize, anchor, tmp, flags);
+        break;
+    case cv::MORPH_CLOSE:
+        rectFilter<dilateOp>(src, mid, ksize, anchor, tmp, flags);
+        rectFilter<erodeOp>(mid, dst, ksize, anchor, tmp, flags);
+        break;
+    default:
+        CV_Error(cv::Error::StsBadArg, "rectMorphology: op must be MORPH_ERODE, MORPH_DILATE, MORPH_OPEN or MORPH_CLOSE");
+    }
+}
+
+
+/*
+ * const char* rectMorphologyKernel(void);
+ *
+ * Description:
+ * Name of the kernel the filters run on this machine ("sse2", "neon" or "scalar").
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		const char* (return val)	kernel name
+ */
+const char* rectMorphologyKernel(void)
+{
+#if defined(RECT_MORPHOLOGY_NEON)
+    return "neon";
+#elif defined(RECT_MORPHOLOGY_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,79 @@
+/*
+ * Author:  Jordan Leiker
+ * Class: ECE6122
+ * Last Date Modified: 10/16/2026
+ *
+ * Description:
+ * This is the header file for the morphology MotionTracker runs on the foreground mask when its structuring
+ * elements are solid rectangles (getStructuringElement(MORPH_RECT, ...)), in place of cv::morphologyEx.
+ *
+ * A rectangle is separable, so an erode (dilate) is a min (max) over each row's window followed by one over each
+ * column's window. Each 1D pass uses the van Herk/Gil-Werman algorithm: the line is cut into blocks of the window
+ * length k, a running min/max is taken forwards and backwards within each block, and every window is then the
+ * min/max of one backward value and one forward value. That is 3 operations per pixel whatever k is, where the
+ * direct filter takes k.
+ *
+ * The column pass works on whole rows at a time, so it runs 16 pixels at a time with SIMD (SSE2 on x86, NEON on
+ * ARM). For the row pass, 16 rows are transposed into columns first (and back after) so it runs the same way.
+ * The row pass is split into stripes of rows and the column pass into stripes of columns, on OpenCV's thread
+ * pool. The output is bit for bit what cv::morphologyEx gives with the same rectangle and anchor and the default
+ * border (pixels outside the image are ignored), for any 8 bit mask, not just 0/255.
+ *
+ */
+
+#pragma once
+#include <opencv2/opencv.hpp>
+
+// flags for rectMorphology()
+#define RECT_MORPHOLOGY_SCALAR 0x1			// skip the SIMD kernels (reference output)
+#define RECT_MORPHOLOGY_SINGLE_THREAD 0x2	// filter the whole image on the calling thread
+
+
+/*
+ * bool isRectStrel(const cv::Mat& strel);
+ *
+ * Description:
+ * Whether a structuring element is a solid rectangle (every element set), i.e. rectMorphology() can run it.
+ *
+ * Inputs:
+ *		const cv::Mat& strel		structuring element
+ *
+ * Outputs:
+ *		bool (return val)			true if rectangular
+ */
+bool isRectStrel(const cv::Mat& strel);
+
+
+/*
+ * void rectMorphology(const cv::Mat& src, cv::Mat& dst, int op, cv::Size ksize, cv::Point anchor = cv::Point(-1, -1), int flags = 0);
+ *
+ * Description:
+ * Same as cv::morphologyEx(src, dst, op, getStructuringElement(MORPH_RECT, ksize), anchor). src may be dst.
+ *
+ * Inputs:
+ *		const cv::Mat& src			8 bit single channel image
+ *		int op						MORPH_ERODE, MORPH_DILATE, MORPH_OPEN or MORPH_CLOSE
+ *		cv::Size ksize				rectangle size
+ *		cv::Point anchor			anchor within the rectangle, (-1, -1) = center
+ *		int flags					RECT_MORPHOLOGY_* flags
+ *
+ * Outputs:
+ *		cv::Mat& dst				filtered image, same size as src
+ */
+void rectMorphology(const cv::Mat& src, cv::Mat& dst, int op, cv::Size ksize, cv::Point anchor = cv::Point(-1, -1),
+                    int flags = 0);
+
+
+/*
+ * const char* rectMorphologyKernel(void);
+ *
+ * Description:
+ * Name of the kernel the filters run on this machine ("sse2", "neon" or "scalar").
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		const char* (return val)	kernel name
+ */
+const char* rectMorphologyKernel(void);
@@ -0,0 +1,227 @@
+/*
+ * Author:  Jordan Leiker
+ * Class: ECE6122
+ * Last Date Modified: 10/16/2026
+ *
+ * Description:
+ * This is the header for the TrackStore class, the table of tracks MotionTracker maintains.
+ *
+ * Tracks are stored as structure of arrays: one contiguous column per field (id, position, size, age, visibility
+ * counters) and the Kalman filters' states and covariances in a KalmanFilterBatch. Predicting every track, building
+ * the list of positions to gate detections against, and checking which tracks are lost are each a straight loop
+ * over one or two columns. Deleting a track moves the last track into its row (swap and pop), so it is O(1) and
+ * the rows stay dense; the only thing that changes is the row of the moved track, its id stays the same.
+ *
+ */
+
+#pragma once
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "FixedKalmanFilter.h"
+
+// Tracker state: x, y, vx, vy, ax, ay, measuring x, y
+typedef FixedKalmanFilter<6, 2> TrackFilter;
+
+
+/*
+ * class TrackStore
+ *
+ * The TrackStore class holds every track's id, position (predicted, or the last detection when it had one), size,
+ * age, visibility counters and Kalman filter, one column each, indexed by row 0 .. size()-1.
+ *
+ */
+class TrackStore
+{
+	/********** Private Members **********/
+	std::vector<unsigned long> ids;
+	std::vector<cv::Point2f> positions;
+	std::vector<float> sizes; // diameter of the last detection (KeyPoint::size)
+	std::vector<unsigned long> ages;
+	std::vector<unsigned long> totalVisibleCounts;
+	std::vector<unsigned long> consecutiveInvisibleCounts;
+	KalmanFilterBatch<6, 2> filters;
+
+
+public:
+	/********** Public Members **********/
+
+	/*
+	 * TrackStore(const TrackFilter& filterModel)
+	 *
+	 * Description:
+	 * Constructor. Every track's filter uses filterModel's transition, measurement and noise matrices.
+	 *
+	 * Inputs:
+	 *		const TrackFilter& filterModel	Kalman filter model
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	explicit TrackStore(const TrackFilter& filterModel) :
+		filters(filterModel)
+	{
+	}
+
+
+	/*
+	 * size_t size(void) const
+	 *
+	 * Description:
+	 * Number of tracks.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		size_t (return val)			number of tracks
+	 */
+	size_t size(void) const
+	{
+		return ids.size();
+	}
+
+
+	/*
+	 * size_t add(unsigned long id, const TrackFilter& filter, const cv::KeyPoint& centroid)
+	 *
+	 * Description:
+	 * Add a new track (age 1, visible once) at the end of the table.
+	 *
+	 * Inputs:
+	 *		unsigned long id			track id
+	 *		const TrackFilter& filter	filter with the track's starting state and error covariance
+	 *		const cv::KeyPoint& centroid	detection that started the track
+	 *
+	 * Outputs:
+	 *		size_t (return val)			row of the new track
+	 */
+	size_t add(unsigned long id, const TrackFilter& filter, const cv::KeyPoint& centroid)
+	{
+		ids.push_back(id);
+		positions.push_back(centroid.pt);
+		sizes.push_back(centroid.size);
+		ages.push_back(1);
+		totalVisibleCounts.push_back(1);
+		consecutiveInvisibleCounts.push_back(0);
+		return filters.add(filter);
+	}
+
+
+	/*
+	 * void remove(size_t row)
+	 *
+	 * Description:
+	 * Delete a track in O(1). The last track moves to row, so when deleting while looping over the rows, check
+	 * the same row again instead of moving on.
+	 *
+	 * Inputs:
+	 *		size_t row					track to delete
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void remove(size_t row)
+	{
+		size_t last = ids.size() - 1;
+		ids[row] = ids[last];
+		positions[row] = positions[last];
+		sizes[row] = sizes[last];
+		ages[row] = ages[last];
+		totalVisibleCounts[row] = totalVisibleCounts[last];
+		consecutiveInvisibleCounts[row] = consecutiveInvisibleCounts[last];
+
+		ids.pop_back();
+		positions.pop_back();
+		sizes.pop_back();
+		ages.pop_back();
+		totalVisibleCounts.pop_back();
+		consecutiveInvisibleCounts.pop_back();
+		filters.remove(row);
+	}
+
+
+	/*
+	 * void predictAll(void)
+	 *
+	 * Description:
+	 * Step every track's Kalman filter forward and move each track to its predicted position.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void predictAll(void)
+	{
+		filters.predictAll();
+
+		const float* x = filters.stateArray(0);
+		const float* y = filters.stateArray(1);
+		for (size_t row = 0; row < positions.size(); row++)
+			positions[row] = cv::Point2f(x[row], y[row]);
+	}
+
+
+	/*
+	 * void detected(size_t row, const cv::KeyPoint& centroid) / void missed(size_t row)
+	 *
+	 * Description:
+	 * Update a track that was assigned a detection this frame (correct its filter, move it to the detection, count
+	 * it visible) / that wasn't (count it invisible). Both age the track by one frame.
+	 *
+	 * Inputs:
+	 *		size_t row					track
+	 *		const cv::KeyPoint& centroid	detection assigned to it
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void detected(size_t row, const cv::KeyPoint& centroid)
+	{
+		const float measurement[2] = { centroid.pt.x, centroid.pt.y };
+		filters.correct(row, measurement);
+		positions[row] = centroid.pt;
+		sizes[row] = centroid.size;
+		ages[row]++;
+		totalVisibleCounts[row]++;
+		consecutiveInvisibleCounts[row] = 0;
+	}
+
+	void missed(size_t row)
+	{
+		ages[row]++;
+		consecutiveInvisibleCounts[row]++;
+	}
+
+
+	/*
+	 * Columns, one entry per row.
+	 */
+	const std::vector<unsigned long>& getIds(void) const { return ids; }
+	const std::vector<cv::Point2f>& getPositions(void) const { return positions; }
+	const std::vector<unsigned long>& getAges(void) const { return ages; }
+	const std::vector<unsigned long>& getTotalVisibleCounts(void) const { return totalVisibleCounts; }
+	const std::vector<unsigned long>& getConsecutiveInvisibleCounts(void) const { return consecutiveInvisibleCounts; }
+
+
+	/*
+	 * void getCentroids(std::vector<cv::KeyPoint>& centroids) const
+	 *
+	 * Description:
+	 * Position and size of every track as KeyPoints (class_id = track id).
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		std::vector<cv::KeyPoint>& centroids	one KeyPoint per track, in row order
+	 */
+	void getCentroids(std::vector<cv::KeyPoint>& centroids) const
+	{
+		centroids.clear();
+		centroids.reserve(ids.size());
+		for (size_t row = 0; row < ids.size(); row++)
+			centroids.push_back(cv::KeyPoint(positions[row], sizes[row], -1, 0, 0, int(ids[row])));
+	}
+};
@@ -10,10 +10,61 @@
  * class begins reading frames and then stops - the network socket will be closed by the server. This
  * is by design - and for simplicity.
  *
+ * The socket code builds against Winsock on Windows and POSIX sockets everywhere else. The few differences
+ * are hidden behind the helpers below.
+ *
  */
 
 #include "VideoCapturePi.h"
 
+#ifdef _WIN32
+static int lastSocketError(void) { return WSAGetLastError(); }
+static bool socketWouldBlock(int err) { return err == WSAEWOULDBLOCK; }
+static bool socketInterrupted(int err) { return err == WSAEINTR; }
+static int pollSocket(struct pollfd* pfd, int timeoutMs) { return WSAPoll(pfd, 1, timeoutMs); }
+static void socketCleanup(void) { WSACleanup(); }
+#define MSG_NOSIGNAL    0   // Winsock never raises SIGPIPE
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <cerrno>
+
+#define INVALID_SOCKET  (-1)
+#define SOCKET_ERROR    (-1)
+#define closesocket     close
+
+static int lastSocketError(void) { return errno; }
+static bool socketWouldBlock(int err) { return err == EAGAIN || err == EWOULDBLOCK; }
+static bool socketInterrupted(int err) { return err == EINTR; }
+static int pollSocket(struct pollfd* pfd, int timeoutMs) { return poll(pfd, 1, timeoutMs); }
+static void socketCleanup(void) {}
+#endif
+
+
+/*
+ * static bool setNonBlocking(int fd);
+ *
+ * Description:
+ * Put a socket in non-blocking mode.
+ *
+ * Inputs:
+ *		int fd			socket
+ *
+ * Outputs:
+ *		bool			false if the mode could not be changed
+ */
+static bool setNonBlocking(int fd)
+{
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(fd, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+#endif
+}
+
 
  /*
   * int connectTcpSocket(void);
@@ -35,21 +86,28 @@ int VideoCapturePi::connectTcpSocket(void)
     const char* ipAddr = ip.c_str();
 
 
+#ifdef _WIN32
     // Initialize Winsock
     sts = WSAStartup(MAKEWORD(2, 2), &wsaData);
     if (sts != NO_ERROR) {
         std::cerr << "WSAStartup failed: " << sts << std::endl;
         return 1;
     }
+#endif
 
-    socketFd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    socketFd = (int)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
     if (socketFd == INVALID_SOCKET)
     {
-        std::cerr << "Error at socket(): " << WSAGetLastError() << std::endl;
-        WSACleanup();
+        std::cerr << "Error at socket(): " << lastSocketError() << std::endl;
+        socketCleanup();
         return 1;
     }
 
+    // Room for a couple of raw frames in the kernel so a short stall on our side does not throttle the stream
+    // (raw VGA at 30 fps is ~27 MB/s). Must be set before connect() for the TCP window to use it.
+    int rcvBufSize = 2 * camSettings.width * camSettings.height * 3;
+    setsockopt(socketFd, SOL_SOCKET, SO_RCVBUF, (const char*)&rcvBufSize, sizeof(rcvBufSize));
+
     serverAddr.sin_family = AF_INET;
     inet_pton(AF_INET, ipAddr, &(serverAddr.sin_addr));
     serverAddr.sin_port = htons(port);
@@ -58,9 +116,8 @@ int VideoCapturePi::connectTcpSocket(void)
     sts = connect(socketFd, (struct sockaddr*)&serverAddr, sizeof(serverAddr));
     if (sts == SOCKET_ERROR)
     {
-        closesocket(sts);
-        std::cerr << "Unable to connect to server: " << WSAGetLastError() << std::endl;
-        WSACleanup();
+        std::cerr << "Unable to connect to server: " << lastSocketError() << std::endl;
+        release();
         return 1;
     }
 
@@ -88,9 +145,8 @@ int VideoCapturePi::setupCamera(void)
     sts = send(socketFd, (char *)&camSettings, sizeof(camSettings), 0);
     if (sts == SOCKET_ERROR) 
     {
-        std::cerr << "Camera Setup Failed: " << WSAGetLastError() << std::endl;
-        closesocket(socketFd);
-        WSACleanup();
+        std::cerr << "Camera Setup Failed: " << lastSocketError() << std::endl;
+        release();
         return 1;
     }
 
@@ -115,6 +171,7 @@ int VideoCapturePi::initialize(void)
 {
     int sts;
 
+    connectStart = std::chrono::steady_clock::now();
     sts = connectTcpSocket();
     if (sts)
     {
@@ -127,6 +184,14 @@ int VideoCapturePi::initialize(void)
         return 1;
     }
 
+    // From here on frames are received with receive(), which never blocks (read() waits with poll() instead)
+    if (!setNonBlocking(socketFd))
+    {
+        std::cerr << "Could not make socket non-blocking: " << lastSocketError() << std::endl;
+        release();
+        return 1;
+    }
+
     return 0;
 }
 
@@ -234,97 +299,454 @@ bool VideoCapturePi::open(const std::string inIpAddr, const unsigned int inPort)
 
 
 /*
- * bool read(cv::Mat& image);
+ * int recvSome(char* buffer, unsigned int length);
+ *
+ * Description:
+ * (Private member function)
+ * Receive whatever is available, up to length bytes, without blocking.
+ *
+ * Inputs:
+ *		unsigned int length		most bytes to receive
+ *
+ * Outputs:
+ *		char* buffer			received bytes
+ *		int						bytes received, 0 if nothing is available yet, -1 if the link failed/closed
+ */
+int VideoCapturePi::recvSome(char* buffer, unsigned int length)
+{
+    int iResult, err;
+
+    for (;;)
+    {
+        iResult = recv(socketFd, buffer, length, 0);
+        if (iResult > 0)
+            return iResult;
+
+        if (iResult == 0)
+        {
+            std::cerr << "Connection closed" << std::endl;
+            linkStatus = false;
+            return -1;
+        }
+
+        err = lastSocketError();
+        if (socketWouldBlock(err))
+            return 0;
+        if (!socketInterrupted(err))
+        {
+            std::cerr << "Recv failed: " << err << std::endl;
+            linkStatus = false;
+            return -1;
+        }
+    }
+}
+
+
+/*
+ * bool acceptFrameHeader(const frameHeader& hdr, unsigned int maxLength);
+ *
+ * Description:
+ * (Private member function)
+ * Check the header of the next frame, and update the stream statistics.
+ *
+ * Inputs:
+ *		const frameHeader& hdr	received header
+ *		unsigned int maxLength	largest payload we can accept
+ *
+ * Outputs:
+ *		bool					false if the header is invalid
+ */
+bool VideoCapturePi::acceptFrameHeader(const frameHeader& hdr, unsigned int maxLength)
+{
+    // A bad header means we lost our place in the stream, there is no way to resync so the link is done
+    if (!checkFrameHeader(hdr, maxLength))
+    {
+        std::cerr << "Invalid frame header (stream out of sync or server version mismatch)" << std::endl;
+        linkStatus = false;
+        return false;
+    }
+
+    // TCP does not lose data, so a gap in the sequence is frames the server dropped before sending
+    if (streamStats.framesReceived > 0 && hdr.sequence != nextSequence)
+        streamStats.framesLost += (uint32_t)(hdr.sequence - nextSequence);
+    nextSequence = hdr.sequence + 1;
+
+    streamStats.framesReceived++;
+    streamStats.lastLatencyMs = (streamTimestampUs() - hdr.captureUs) / 1000.0;
+    latencySumMs += streamStats.lastLatencyMs;
+    streamStats.avgLatencyMs = latencySumMs / streamStats.framesReceived;
+
+    if (hdr.flags & STREAM_FLAG_KEY)
+        keyframePending = false;
+
+    lastHeader = hdr;
+    return true;
+}
+
+
+/*
+ * bool waitReadable(int timeoutMs);
+ *
+ * Description:
+ * (Private member function)
+ * Sleep until the socket has data (or the timeout expires).
+ *
+ * Inputs:
+ *		int timeoutMs			maximum time to wait, -1 = forever
+ *
+ * Outputs:
+ *		bool					false if waiting failed
+ */
+bool VideoCapturePi::waitReadable(int timeoutMs)
+{
+    struct pollfd pfd;
+    pfd.fd = socketFd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    // A hang up or error also wakes us, the next recv() then reports it
+    if (pollSocket(&pfd, timeoutMs) < 0 && !socketInterrupted(lastSocketError()))
+    {
+        std::cerr << "Poll failed: " << lastSocketError() << std::endl;
+        linkStatus = false;
+        return false;
+    }
+
+    return true;
+}
+
+
+/*
+ * int receive(cv::Mat& image);
  *
  * Description:
  * (Public member function)
- * Grabs, decodes and returns the next video frame. If H264 is enabled the incoming packet over TCP is sent to the CODEC 
- * for decoding into a video frame.
- * 
- * Note: Once this function is called it is assumed that it will be called repeatedly (or fast enough) to 
- * main a stream over the socket. If it falls behind or is only called once, for example, the server software on the 
- * Raspberry Pi will assume the client closed the socket and it will return to a listening state.
+ * Non-blocking version of read(). Takes whatever data the socket has and returns as soon as it would have to wait.
+ * A partly received header/payload is kept in the member receive state and picked up again on the next call, so
+ * the caller only has to call again (with the same image) once the socket is readable.
+ *
+ * Every frame arrives as a frameHeader + payload (see StreamProtocol.h), so exactly one encoded packet (or raw image)
+ * is received at a time and handed to the decoder whole - no parsing of the byte stream is needed.
  *
  * Inputs:
- *		cv::OutputArray image			image the video frame is returned here. If no frames has been grabbed the image will be empty.
+ *		N/A
  *
  * Outputs:
- *		bool							false if no frames has been grabbed
+ *		cv::Mat& image					the video frame, when one is complete
+ *		int								1 = image holds a new frame, 0 = need more data, -1 = link failed/closed
  */
-bool VideoCapturePi::read(cv::Mat& image)
+int VideoCapturePi::receive(cv::Mat& image)
 {
     unsigned int imgSize = camSettings.height * camSettings.width * 3;
-    int iResult = 0;   
+    int64_t frameCaptureUs = 0;
+    int n;
 
-    if (codecName != "none")
-    {  
-        bool validFrame = false;
-        // It may take several TCP packets to collect a full frame. So loop here receiving until 
-        // we get one.
-        do
+    if (!linkStatus)
+        return -1;
+
+    // The decoder may hold back the first packet(s) before it outputs a picture, so keep going
+    // until we get one (or run out of data).
+    for (;;)
+    {
+        while (rxHeaderBytes < sizeof(rxHeader))
         {
-            // Try to receive the raw image size since we know thats more than enough to get a packet
-            // Note: Only get more info if the vidDecoder is free. Packets may contains multiple frames, 
-            // so we do not need to read more data over the network until we've gotten all the frames 
-            // from our last packet
-            if (vidDecoder->isFree)
-                iResult = recv(socketFd, socketBuffer, imgSize, 0);
-
-            // Decode if we return info over socket or if vidDecoder is still mid decode from last socket packet
-            if (iResult > 0 || !vidDecoder->isFree) {       
-                av_packet_from_data(rcvPkt, (uint8_t*)socketBuffer, iResult);
-                validFrame = vidDecoder->decode(rcvPkt, image); //rcvPkt is unused if !vidDecoder->isFree
-            }
-            else if (iResult == 0)
+            n = recvSome((char*)&rxHeader + rxHeaderBytes, sizeof(rxHeader) - rxHeaderBytes);
+            if (n <= 0)
+                return n;
+            rxHeaderBytes += n;
+            if (rxHeaderBytes < sizeof(rxHeader))
+                continue;
+
+            // Header complete, work out where the payload goes
+            if (!acceptFrameHeader(rxHeader, imgSize))
+                return -1;
+            rxPayloadBytes = 0;
+
+            if (codecName != "none")
             {
-                std::cerr << "Connection closed" << std::endl;
-                exit(1);
+                rxTarget = socketBuffer;
             }
+
+            // If not using compression the payload is an entire raw image (height x width x 3 x 8 bits), already in
+            // OpenCV's [B G R B G R ...] row-major order, so receive it straight into the Mat.
             else
             {
-                std::cerr << "Recv failed: " << WSAGetLastError() << std::endl;
-                return false;
+                if (rxHeader.length != imgSize)
+                {
+                    std::cerr << "Raw frame is " << rxHeader.length << " bytes, expected " << imgSize << std::endl;
+                    linkStatus = false;
+                    return -1;
+                }
+
+                // Reuse the caller's buffer if it is a continuous frame of the right size that nobody else holds (an
+                // earlier frame may still be queued), otherwise allocate one. rxImage holds on to it until the frame
+                // is complete. Grayscale output is converted from a BGR frame we keep (for retrieveColor()) instead.
+                cv::Mat& rxBuffer = outputGray ? rawColor : image;
+                if (!rxBuffer.isContinuous())
+                    rxBuffer.release();
+                releaseIfShared(rxBuffer);
+                rxBuffer.create(camSettings.height, camSettings.width, CV_8UC3);
+                rxImage = rxBuffer;
+                rxTarget = (char*)rxImage.data;
             }
-        } while (!validFrame);
-    }
+        }
 
-    // If not using compression then we need to recieve an entire raw image (height x width x 3 x 8 bits)
-    // Then we need to convert from the planar [B G R B G R...] format to the 2D format
-    else
-    {
-        // Receive a raw image - we will need to get multiple packets containing all the bytes
-        for (unsigned int i = 0; i < imgSize; i += iResult)
+        while (rxPayloadBytes < rxHeader.length)
         {
-            // Initially this asks to receive the full image size number of bytes, each time a receive happens
-            // we subtract the number of bytes received and request to receive the remaining number of bytes.
-            iResult = recv(socketFd, socketBuffer + i, imgSize - i, 0);
-            if (iResult > 0) {
-                // bytes received, all good
-            }
-            else if (iResult == 0)
+            n = recvSome(rxTarget + rxPayloadBytes, rxHeader.length - rxPayloadBytes);
+            if (n <= 0)
+                return n;
+            rxPayloadBytes += n;
+        }
+
+        // Frame complete, the next call starts on a new header
+        rxHeaderBytes = 0;
+
+        if (codecName == "none")
+        {
+            if (outputGray)
             {
-                std::cerr << "Connection closed" << std::endl;
-                exit(1);
+                releaseIfShared(image);
+                cv::cvtColor(rxImage, image, cv::COLOR_BGR2GRAY);
             }
             else
-            {
-                std::cerr << "Recv failed: " << WSAGetLastError() << std::endl;
-                return false;
-            }
+                image = rxImage;
+            rxImage.release();
+            frameCaptureUs = rxHeader.captureUs;
+            break;
         }
 
-        // Received data is in 1D buffer [ B G R  B G R  B G R ... ]
-        // So cycle through height/width of image casting each pixel location to a 3D array of B G R.
-        // The output of this look is a Height x Width x 3 image array.
-        int ptr = 0;
-        for (int i = 0; i < camSettings.height; i++) {
-            for (int j = 0; j < camSettings.width; j++) {
-                image.at<cv::Vec3b>(i, j) = cv::Vec3b(socketBuffer[ptr + 0], socketBuffer[ptr + 1], socketBuffer[ptr + 2]);
-                ptr = ptr + 3;
-            }
+        // The decoder reads a little past the end of the packet, that padding must be zero
+        memset(socketBuffer + rxHeader.length, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+        rcvPkt->data = (uint8_t*)socketBuffer;
+        rcvPkt->size = rxHeader.length;
+        rcvPkt->pts = rxHeader.captureUs; // comes back out with the frame, whatever order the decoder outputs in
+        unsigned long errorsBefore = vidDecoder->getErrorCount();
+        bool validFrame = vidDecoder->decodeFramed(rcvPkt, image);
+
+        // The picture stays broken until the next keyframe, so ask for one now rather than waiting out the GOP
+        if (vidDecoder->getErrorCount() != errorsBefore)
+            requestKeyframe();
+        if (validFrame)
+        {
+            frameCaptureUs = vidDecoder->getLastPts();
+            if (frameCaptureUs == AV_NOPTS_VALUE)
+                frameCaptureUs = rxHeader.captureUs;
+            break;
         }
     }
 
+    if (streamStats.firstFrameMs == 0.0)
+        streamStats.firstFrameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - connectStart).count();
+
+    streamStats.framesOutput++;
+    streamStats.lastFrameLatencyMs = (streamTimestampUs() - frameCaptureUs) / 1000.0;
+    frameLatencySumMs += streamStats.lastFrameLatencyMs;
+    streamStats.avgFrameLatencyMs = frameLatencySumMs / streamStats.framesOutput;
+
+    return 1;
+}
+
+
+/*
+ * bool read(cv::Mat& image);
+ *
+ * Description:
+ * (Public member function)
+ * Grabs, decodes and returns the next video frame. If a codec is enabled the incoming packet over TCP is sent to the CODEC 
+ * for decoding into a video frame. Blocks until a frame is available: this is receive() plus a poll() on the socket.
+ * The frame never shares a buffer with a later one, so it can be queued without a copy (see VideoCapturePi.h).
+ * 
+ * Note: Once this function is called it is assumed that it will be called repeatedly (or fast enough) to 
+ * main a stream over the socket. If it falls behind or is only called once, for example, the server software on the 
+ * Raspberry Pi will assume the client closed the socket and it will return to a listening state.
+ *
+ * Inputs:
+ *		cv::OutputArray image			image the video frame is returned here. If no frames has been grabbed the image will be empty.
+ *
+ * Outputs:
+ *		bool							false if no frames has been grabbed (link failed/closed)
+ */
+bool VideoCapturePi::read(cv::Mat& image)
+{
+    int sts;
+
+    while ((sts = receive(image)) == 0)
+    {
+        if (!waitReadable(-1))
+            return false;
+    }
+
+    return sts == 1;
+}
+
+
+/*
+ * void setOutputGray(bool gray);
+ *
+ * Description:
+ * (Public member function)
+ * Make read()/receive() hand back 8 bit grayscale (CV_8UC1) frames instead of BGR. With a codec this is the
+ * decoder's luma plane as-is (no color conversion, no copy) and the BGR conversion only happens if
+ * retrieveColor() is called. In raw mode the received BGR frame is converted.
+ *
+ * Inputs:
+ *		bool gray						true for grayscale frames, false for BGR (default)
+ *
+ * Outputs:
+ *		N/A
+ */
+void VideoCapturePi::setOutputGray(bool gray)
+{
+    outputGray = gray;
+    if (codecName != "none")
+        vidDecoder->setOutput(gray ? DECODER_OUTPUT_LUMA : DECODER_OUTPUT_BGR);
+}
+
+
+/*
+ * bool retrieveColor(cv::Mat& image);
+ *
+ * Description:
+ * (Public member function)
+ * Get the last frame read as BGR, for display/recording when the output is grayscale (see setOutputGray()).
+ * An encoded frame is converted into image's own buffer (see Decoder::retrieveBGR()), so pass in a pool buffer
+ * to convert into. A raw frame is handed back by reference, and the next read()/receive() receives into a new
+ * buffer while it is still held. Either way the frame stays valid after the next read() and can be kept or
+ * queued without a copy.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		cv::Mat& image					BGR video frame
+ *		bool							false if there is no frame
+ */
+bool VideoCapturePi::retrieveColor(cv::Mat& image)
+{
+    if (codecName != "none")
+        return vidDecoder->retrieveBGR(image);
+
+    if (!outputGray || rawColor.empty())
+        return false; // BGR output, read() already returned the color frame
+
+    image = rawColor;
+    return true;
+}
+
+
+/*
+ * VideoStreamStats getStreamStats(void) const;
+ *
+ * Description:
+ * (Public member function)
+ * Get the frame count, lost frames and capture -> receive latency of the stream so far.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		VideoStreamStats				stream statistics
+ */
+VideoStreamStats VideoCapturePi::getStreamStats(void) const
+{
+    return streamStats;
+}
+
+
+/*
+ * bool getDecoderThreadStats(CodecThreadStats& stats) const;
+ *
+ * Description:
+ * (Public member function)
+ * Get the decoder's threading statistics (threads in use, delay, time per frame), see VideoCodec::getThreadStats().
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		CodecThreadStats& stats			decoder threading statistics
+ *		bool							false if there is no decoder (raw frames)
+ */
+bool VideoCapturePi::getDecoderThreadStats(CodecThreadStats& stats) const
+{
+    if (codecName == "none")
+        return false;
+
+    stats = vidDecoder->getThreadStats();
+    return true;
+}
+
+
+/*
+ * const frameHeader& getFrameHeader(void) const;
+ *
+ * Description:
+ * (Public member function)
+ * Get the header (sequence number, capture timestamp, keyframe flag, codec) of the last frame received.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		const frameHeader&				last frame header
+ */
+const frameHeader& VideoCapturePi::getFrameHeader(void) const
+{
+    return lastHeader;
+}
+
+
+/*
+ * int getSocket(void) const;
+ *
+ * Description:
+ * (Public member function)
+ * The socket the frames arrive on, for waiting on several cameras at once (select/poll/epoll).
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		int								socket descriptor
+ */
+int VideoCapturePi::getSocket(void) const
+{
+    return socketFd;
+}
+
+
+/*
+ * bool requestKeyframe(void);
+ *
+ * Description:
+ * (Public member function)
+ * Ask the server for a keyframe (encoded streams). Called automatically when the decoder reports an error.
+ * Repeat requests are not sent until the keyframe has arrived.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		bool							false if the request could not be sent
+ */
+bool VideoCapturePi::requestKeyframe(void)
+{
+    if (codecName == "none" || !linkStatus)
+        return false;
+    if (keyframePending)
+        return true;
+
+    // 8 bytes always fit in an idle send buffer, so the non-blocking send either takes all of it or nothing
+    controlMessage msg;
+    initControlMessage(msg, CONTROL_KEYFRAME_REQUEST);
+    if (send(socketFd, (const char*)&msg, sizeof(msg), MSG_NOSIGNAL) != (int)sizeof(msg))
+    {
+        std::cerr << "Keyframe request failed: " << lastSocketError() << std::endl;
+        return false;
+    }
+
+    keyframePending = true;
     return true;
 }
 
@@ -364,6 +786,146 @@ VideoCapturePi& VideoCapturePi::operator>> (cv::Mat& image)
  */
 void VideoCapturePi::release(void)
 {
+    // Safe to call more than once (the destructor calls it too)
+    if (socketFd == INVALID_SOCKET)
+        return;
+
     closesocket(socketFd);
-    WSACleanup();
-}
\ No newline at end of file
+    socketFd = INVALID_SOCKET;
+    linkStatus = false;
+    socketCleanup();
+}
+
+
+
+#ifdef __linux__
+/*
+ * VideoCapturePoller(void) :
+ *
+ * Description:
+ * Constructor. Creates the epoll instance.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		N/A
+ */
+VideoCapturePoller::VideoCapturePoller(void) :
+    epollFd(epoll_create1(EPOLL_CLOEXEC)),
+    events(16)
+{
+    if (epollFd < 0)
+    {
+        std::cerr << "Could not create epoll instance: " << errno << std::endl;
+        exit(1);
+    }
+}
+
+
+/*
+ * ~VideoCapturePoller(void) :
+ *
+ * Description:
+ * Destructor. Closes the epoll instance (the cameras are left alone).
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		N/A
+ */
+VideoCapturePoller::~VideoCapturePoller(void)
+{
+    close(epollFd);
+}
+
+
+/*
+ * bool add(VideoCapturePi* cam);
+ *
+ * Description:
+ * Start watching a camera stream. Level triggered, so a stream with data left over after receive() returned a frame
+ * is reported again by the next wait().
+ *
+ * Inputs:
+ *		VideoCapturePi* cam				opened camera stream
+ *
+ * Outputs:
+ *		bool							false if the stream could not be added
+ */
+bool VideoCapturePoller::add(VideoCapturePi* cam)
+{
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = cam;
+
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, cam->getSocket(), &ev) < 0)
+    {
+        std::cerr << "Could not add camera to poller: " << errno << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+/*
+ * void remove(VideoCapturePi* cam);
+ *
+ * Description:
+ * Stop watching a camera stream.
+ *
+ * Inputs:
+ *		VideoCapturePi* cam				camera stream to remove
+ *
+ * Outputs:
+ *		N/A
+ */
+void VideoCapturePoller::remove(VideoCapturePi* cam)
+{
+    // Fails harmlessly if the socket was already closed (closing it removes it from the epoll set)
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, cam->getSocket(), nullptr);
+}
+
+
+/*
+ * int wait(std::vector<VideoCapturePi*>& ready, int timeoutMs);
+ *
+ * Description:
+ * Sleep until at least one stream has data (or the timeout expires).
+ *
+ * Inputs:
+ *		int timeoutMs					maximum time to wait, -1 = forever
+ *
+ * Outputs:
+ *		std::vector<VideoCapturePi*>& ready   streams to call receive() on
+ *		int								number of ready streams, -1 on error
+ */
+int VideoCapturePoller::wait(std::vector<VideoCapturePi*>& ready, int timeoutMs)
+{
+    int n;
+
+    ready.clear();
+    do
+    {
+        n = epoll_wait(epollFd, events.data(), (int)events.size(), timeoutMs);
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0)
+    {
+        std::cerr << "epoll_wait failed: " << errno << std::endl;
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++)
+        ready.push_back((VideoCapturePi*)events[i].data.ptr);
+
+    // Full event list - there may be more ready streams than fit. They are still ready (level triggered) so they
+    // come back on the next call, just make room for them.
+    if (n == (int)events.size())
+        events.resize(events.size() * 2);
+
+    return n;
+}
+#endif
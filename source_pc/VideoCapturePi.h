@@ -9,20 +9,40 @@
  * VideoCapture class, but is really only designed for use as a streaming object. In fact if this
  * class begins reading frames and then stops - the network socket will be closed by the server. This 
  * is by design - and for simplicity.
+ *
+ * Builds against Winsock on Windows and POSIX sockets elsewhere. The socket is non-blocking once streaming, so
+ * on Linux one thread can service many cameras with a VideoCapturePoller (epoll) and receive(); read() keeps the
+ * usual blocking behaviour on top of that.
  * 
  */
 
 #pragma once
 #include <iostream>
 #include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#ifdef _WIN32
 #include <winsock2.h>
 #include <Ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#endif
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
 #include <opencv2/opencv.hpp>
 #include "VideoCodec.h"
+#include "StreamProtocol.h"
 
 
+#ifdef _WIN32
  // Link with ws2_32.lib
 #pragma comment(lib, "Ws2_32.lib")
+#endif
 
 
 // A useful data struct to send/receive camera setup params
@@ -31,6 +51,22 @@ struct cameraSettings {
 	unsigned int width;
 	unsigned int fps;
 	char codec[20];
+	char profile[12];	// encoder profile name (see EncoderProfile in VideoCodec.h), "" = server default
+	char threads[12];	// encoder threading policy (see CodecThreading in VideoCodec.h), "" = server default (auto)
+};
+
+
+// Per-stream statistics gathered from the frame headers (see StreamProtocol.h)
+struct VideoStreamStats {
+	unsigned long long framesReceived;	// frames received from the server
+	unsigned long long framesLost;		// gaps in the sequence numbers (frames the server never sent us)
+	double lastLatencyMs;				// capture -> received latency of the last frame (needs synced clocks)
+	double avgLatencyMs;				// average capture -> received latency
+	double firstFrameMs;				// connect -> first frame ready (time to first frame), 0 until then
+	unsigned long long framesOutput;	// frames handed to the caller
+	double lastFrameLatencyMs;			// capture -> frame ready (decoded) latency of the last frame, i.e. glass to glass
+										// minus display (needs synced clocks)
+	double avgFrameLatencyMs;			// average capture -> frame ready latency
 };
 
 
@@ -52,7 +88,9 @@ class VideoCapturePi
 	std::string ip;
 	unsigned int port;
 	int socketFd, sts;
+#ifdef _WIN32
 	WSADATA wsaData;
+#endif
 	struct sockaddr_in serverAddr;
 	struct hostent* server;
 
@@ -65,6 +103,27 @@ class VideoCapturePi
 	cameraSettings camSettings;
 	char* socketBuffer;
 
+	// Stream Variables
+	frameHeader lastHeader;
+	uint32_t nextSequence;
+	VideoStreamStats streamStats;
+	double latencySumMs;
+	double frameLatencySumMs;
+	std::chrono::steady_clock::time_point connectStart;	// for the time to first frame
+
+	// Receive state. The socket is non-blocking, so a frame may arrive over several receive() calls.
+	frameHeader rxHeader;
+	unsigned int rxHeaderBytes;		// header bytes received so far
+	unsigned int rxPayloadBytes;	// payload bytes received so far
+	char* rxTarget;					// where the payload goes (socketBuffer, or rxImage's data in raw mode)
+	cv::Mat rxImage;				// raw mode: frame being received into (keeps its buffer alive until complete)
+
+	bool keyframePending;			// a keyframe was requested and has not arrived yet
+
+	// Output format
+	bool outputGray;				// hand back CV_8UC1 luma instead of BGR (see setOutputGray())
+	cv::Mat rawColor;				// raw mode + gray output: the BGR frame the luma came from (for retrieveColor())
+
 	// Misc
 	bool linkStatus;
 
@@ -114,6 +173,53 @@ class VideoCapturePi
 	int initialize(void);
 
 
+	/*
+	 * int recvSome(char* buffer, unsigned int length);
+	 *
+	 * Description:
+	 * Receive whatever is available, up to length bytes, without blocking.
+	 *
+	 * Inputs:
+	 *		unsigned int length		most bytes to receive
+	 *
+	 * Outputs:
+	 *		char* buffer			received bytes
+	 *		int						bytes received, 0 if nothing is available yet, -1 if the link failed/closed
+	 */
+	int recvSome(char* buffer, unsigned int length);
+
+
+	/*
+	 * bool acceptFrameHeader(const frameHeader& hdr, unsigned int maxLength);
+	 *
+	 * Description:
+	 * Check the header of the next frame and update the stream statistics.
+	 *
+	 * Inputs:
+	 *		const frameHeader& hdr	received header
+	 *		unsigned int maxLength	largest payload we can accept
+	 *
+	 * Outputs:
+	 *		bool					false if the header is invalid
+	 */
+	bool acceptFrameHeader(const frameHeader& hdr, unsigned int maxLength);
+
+
+	/*
+	 * bool waitReadable(int timeoutMs);
+	 *
+	 * Description:
+	 * Sleep until the socket has data (or the timeout expires).
+	 *
+	 * Inputs:
+	 *		int timeoutMs			maximum time to wait, -1 = forever
+	 *
+	 * Outputs:
+	 *		bool					false if waiting failed
+	 */
+	bool waitReadable(int timeoutMs);
+
+
 
 public:	
 	/********** Public Members **********/
@@ -145,16 +251,29 @@ public:
 	VideoCapturePi(const std::string inIpAddr, const unsigned int inPort, const unsigned int inWidth, const unsigned int inHeight, const unsigned int inFps) :
 		ip(inIpAddr),
 		port(inPort),
-		codecName("none")
+		codecName("none"),
+		lastHeader(),
+		nextSequence(0),
+		streamStats(),
+		latencySumMs(0.0),
+		frameLatencySumMs(0.0),
+		rxHeader(),
+		rxHeaderBytes(0),
+		rxPayloadBytes(0),
+		rxTarget(nullptr),
+		keyframePending(false),
+		outputGray(false)
 	{		
 		camSettings.height = inHeight;
 		camSettings.width = inWidth;
 		camSettings.fps = inFps;
 		memset(camSettings.codec, 0, sizeof(camSettings.codec));
 		memcpy(camSettings.codec, codecName.c_str(), codecName.length());
+		memset(camSettings.profile, 0, sizeof(camSettings.profile));
+		memset(camSettings.threads, 0, sizeof(camSettings.threads));
 
-		// Setup frame buffer just once and reuse
-		socketBuffer = new char[camSettings.width * camSettings.height * 3 + AV_INPUT_BUFFER_PADDING_SIZE]; //every pixel is RGB (3 bytes)
+		// Raw frames are received straight into the caller's cv::Mat, no socket buffer needed
+		socketBuffer = nullptr;
 		linkStatus = (bool)(!initialize());
 	}
 
@@ -172,27 +291,50 @@ public:
 	 *		const unsigned int inWidth			camera frame width
 	 *		const unsigned int inHeight			camera frame height
 	 *		const unsigned int inFps			camera frame fps
-	 *	    const bool inEnaH264				enable H264 compression over the tcp socket
+	 *	    std::string codec					codec used over the tcp socket ("none" for raw frames)
+	 *	    std::string profile					encoder profile, "latency", "balanced" or "archive"
+	 *	    std::string encoderThreads			server's encoder threading policy, "auto", "frame[:N]" or "slice[:N]"
+	 *	    std::string decoderThreads			our decoder's threading policy, "auto", "frame[:N]" or "slice[:N]"
 	 *
 	 * Outputs:
 	 *		N/A
 	 */
-	VideoCapturePi(const std::string inIpAddr, const unsigned int inPort, const unsigned int inWidth, const unsigned int inHeight, const unsigned int inFps, std::string codec) :
+	VideoCapturePi(const std::string inIpAddr, const unsigned int inPort, const unsigned int inWidth, const unsigned int inHeight, const unsigned int inFps, std::string codec,
+		std::string profile = "balanced", std::string encoderThreads = "auto", std::string decoderThreads = "auto") :
 		ip(inIpAddr),
 		port(inPort),
-		codecName(codec)
+		codecName(codec),
+		lastHeader(),
+		nextSequence(0),
+		streamStats(),
+		latencySumMs(0.0),
+		frameLatencySumMs(0.0),
+		rxHeader(),
+		rxHeaderBytes(0),
+		rxPayloadBytes(0),
+		rxTarget(nullptr),
+		keyframePending(false),
+		outputGray(false)
 	{
 		camSettings.height = inHeight;
 		camSettings.width = inWidth;
 		camSettings.fps = inFps;
 		memset(camSettings.codec, 0, sizeof(camSettings.codec));
 		memcpy(camSettings.codec, codecName.c_str(), codecName.length());
+		memset(camSettings.profile, 0, sizeof(camSettings.profile));
+		memcpy(camSettings.profile, profile.c_str(), std::min(profile.length(), sizeof(camSettings.profile) - 1));
+		memset(camSettings.threads, 0, sizeof(camSettings.threads));
+		memcpy(camSettings.threads, encoderThreads.c_str(), std::min(encoderThreads.length(), sizeof(camSettings.threads) - 1));
 
 		if (codecName != "none")
 		{
 			// I don't want to construct the decoder object unless we're actually using it. So my solution was to have a pointer to a Decoder object
 			// as a member variable, construct a new one when needed, then set the pointer to the class member Decoder.
-			vidDecoder = new Decoder(camSettings.codec, AV_PIX_FMT_BGR24, AV_PIX_FMT_YUV420P, camSettings.width, camSettings.height, camSettings.fps);
+			CodecThreading threading;
+			if (!codecThreadingFromName(decoderThreads, threading))
+				std::cerr << "Unknown decoder threading \"" << decoderThreads << "\", using auto" << std::endl;
+			vidDecoder = new Decoder(camSettings.codec, AV_PIX_FMT_BGR24, AV_PIX_FMT_YUV420P, camSettings.width, camSettings.height, camSettings.fps,
+				threading);
 
 			// Allocate packet to be used to get data from decoder
 			rcvPkt = av_packet_alloc();
@@ -205,8 +347,8 @@ public:
 		}
 		else
 		{
-			// Setup frame buffer just once and reuse
-			socketBuffer = new char[camSettings.width * camSettings.height * 3 + AV_INPUT_BUFFER_PADDING_SIZE]; //every pixel is RGB (3 bytes)
+			// Raw frames are received straight into the caller's cv::Mat, no socket buffer needed
+			socketBuffer = nullptr;
 		}
 
 		linkStatus = (bool)(!initialize());
@@ -233,11 +375,7 @@ public:
 		{
 			delete vidDecoder;
 			av_packet_free(&rcvPkt);
-			//av_freep(socketBuffer);
-		}
-		else
-		{
-			delete[] socketBuffer;
+			av_freep(&socketBuffer);
 		}
  	}
 
@@ -322,7 +460,11 @@ public:
 	 * bool read(cv::Mat& image);
 	 *
 	 * Description:
-	 * Grabs, decodes and returns the next video frame.
+	 * Grabs, decodes and returns the next video frame. BGR frames (decoded, or received in raw mode) are written
+	 * directly into image's buffer if it is a continuous frame of the right size/type that image alone holds (e.g.
+	 * one just acquired from a FramePool), otherwise into a new buffer. Grayscale frames from the decoder reference
+	 * its frame (see setOutputGray()). Either way the frame never shares a buffer with a later one, so it can be
+	 * queued without a copy.
 	 *
 	 * Inputs:
 	 *		cv::Mat image					image the video frame is returned here. If no frames has been grabbed the image will be empty.
@@ -333,6 +475,138 @@ public:
 	bool read(cv::Mat& image);
 
 
+	/*
+	 * void setOutputGray(bool gray);
+	 *
+	 * Description:
+	 * Make read()/receive() hand back 8 bit grayscale (CV_8UC1) frames instead of BGR. With a codec this is the
+	 * decoder's luma plane as-is (no color conversion, no copy) and the BGR conversion only happens if
+	 * retrieveColor() is called. In raw mode the received BGR frame is converted.
+	 *
+	 * Inputs:
+	 *		bool gray						true for grayscale frames, false for BGR (default)
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void setOutputGray(bool gray);
+
+
+	/*
+	 * bool retrieveColor(cv::Mat& image);
+	 *
+	 * Description:
+	 * Get the last frame read as BGR, for display/recording when the output is grayscale (see setOutputGray()).
+	 * An encoded frame is converted into image's own buffer (see Decoder::retrieveBGR()), so pass in a pool buffer
+	 * to convert into. A raw frame is handed back by reference, and the next read()/receive() receives into a new
+	 * buffer while it is still held. Either way the frame stays valid after the next read() and can be kept or
+	 * queued without a copy.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		cv::Mat& image					BGR video frame
+	 *		bool							false if there is no frame
+	 */
+	bool retrieveColor(cv::Mat& image);
+
+
+	/*
+	 * VideoStreamStats getStreamStats(void) const;
+	 *
+	 * Description:
+	 * Get the frame count, lost frames and capture -> receive latency of the stream so far.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		VideoStreamStats				stream statistics
+	 */
+	VideoStreamStats getStreamStats(void) const;
+
+
+	/*
+	 * bool getDecoderThreadStats(CodecThreadStats& stats) const;
+	 *
+	 * Description:
+	 * Get the decoder's threading statistics (threads in use, delay, time per frame), see VideoCodec::getThreadStats().
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		CodecThreadStats& stats			decoder threading statistics
+	 *		bool							false if there is no decoder (raw frames)
+	 */
+	bool getDecoderThreadStats(CodecThreadStats& stats) const;
+
+
+	/*
+	 * const frameHeader& getFrameHeader(void) const;
+	 *
+	 * Description:
+	 * Get the header (sequence number, capture timestamp, keyframe flag, codec) of the last frame received.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		const frameHeader&				last frame header
+	 */
+	const frameHeader& getFrameHeader(void) const;
+
+
+	/*
+	 * int receive(cv::Mat& image);
+	 *
+	 * Description:
+	 * Non-blocking version of read(). Takes whatever data the socket has and returns as soon as it would have to
+	 * wait. Call again when the socket is readable (see getSocket()/VideoCapturePoller) with the same image until
+	 * a frame comes out.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		cv::Mat& image					the video frame, when one is complete
+	 *		int								1 = image holds a new frame, 0 = need more data, -1 = link failed/closed
+	 */
+	int receive(cv::Mat& image);
+
+
+	/*
+	 * int getSocket(void) const;
+	 *
+	 * Description:
+	 * The socket the frames arrive on, for waiting on several cameras at once (select/poll/epoll).
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		int								socket descriptor
+	 */
+	int getSocket(void) const;
+
+
+	/*
+	 * bool requestKeyframe(void);
+	 *
+	 * Description:
+	 * Ask the server for a keyframe (encoded streams). Called automatically when the decoder reports an error.
+	 * Repeat requests are not sent until the keyframe has arrived.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		bool							false if the request could not be sent
+	 */
+	bool requestKeyframe(void);
+
+
 	/*
 	 * VideoCapturePi& operator>> (cv::Mat& image);
 	 *
@@ -361,4 +635,116 @@ public:
 	 *		N/A
 	 */
 	void release(void);
-};
\ No newline at end of file
+};
+
+
+#ifdef __linux__
+/*
+ * class VideoCapturePoller
+ *
+ * Waits on any number of VideoCapturePi streams at once with epoll, so a single thread can service many cameras:
+ *
+ *     VideoCapturePoller poller;
+ *     poller.add(&camA);
+ *     poller.add(&camB);
+ *     while (...)
+ *     {
+ *         poller.wait(ready, -1);
+ *         for (VideoCapturePi* cam : ready)
+ *             if (cam->receive(frames[cam]) == 1)
+ *                 process(frames[cam]);
+ *     }
+ *
+ * The poller does not own the cameras, remove() them (or destroy the poller) before they are destroyed.
+ *
+ */
+class VideoCapturePoller
+{
+	/********** Private Members **********/
+	int epollFd;
+	std::vector<struct epoll_event> events;
+
+
+public:
+	/********** Public Members **********/
+
+	/*
+	 * VideoCapturePoller(void) :
+	 *
+	 * Description:
+	 * Constructor. Creates the epoll instance.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	VideoCapturePoller(void);
+
+
+	/*
+	 * ~VideoCapturePoller(void) :
+	 *
+	 * Description:
+	 * Destructor. Closes the epoll instance (the cameras are left alone).
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	~VideoCapturePoller(void);
+
+	// Owns an epoll descriptor, so no copies
+	VideoCapturePoller(const VideoCapturePoller&) = delete;
+	VideoCapturePoller& operator=(const VideoCapturePoller&) = delete;
+
+
+	/*
+	 * bool add(VideoCapturePi* cam);
+	 *
+	 * Description:
+	 * Start watching a camera stream.
+	 *
+	 * Inputs:
+	 *		VideoCapturePi* cam				opened camera stream
+	 *
+	 * Outputs:
+	 *		bool							false if the stream could not be added
+	 */
+	bool add(VideoCapturePi* cam);
+
+
+	/*
+	 * void remove(VideoCapturePi* cam);
+	 *
+	 * Description:
+	 * Stop watching a camera stream.
+	 *
+	 * Inputs:
+	 *		VideoCapturePi* cam				camera stream to remove
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void remove(VideoCapturePi* cam);
+
+
+	/*
+	 * int wait(std::vector<VideoCapturePi*>& ready, int timeoutMs);
+	 *
+	 * Description:
+	 * Sleep until at least one stream has data (or the timeout expires).
+	 *
+	 * Inputs:
+	 *		int timeoutMs					maximum time to wait, -1 = forever
+	 *
+	 * Outputs:
+	 *		std::vector<VideoCapturePi*>& ready   streams to call receive() on
+	 *		int								number of ready streams, -1 on error
+	 */
+	int wait(std::vector<VideoCapturePi*>& ready, int timeoutMs);
+};
+#endif
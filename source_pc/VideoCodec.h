@@ -15,7 +15,10 @@
 #pragma once
 #include <string>
 #include <iostream>
+#include <atomic>
+#include <chrono>
 #include <opencv2/opencv.hpp>
+#include "ColorConvert.h"
 
 // FFMPEG is in native so, so need the extern "C" to compile
 extern "C"
@@ -27,6 +30,101 @@ extern "C"
 }
 
 
+/*
+ * enum CodecThreadType / struct CodecThreading
+ *
+ * Description:
+ * How many threads libavcodec may use for one encoder/decoder, and how it splits the work between them (see
+ * codecThreadingFromName()). Frame threading works on several frames at once: the most throughput for any stream,
+ * but every extra thread is one more frame of delay. Slice threading splits each frame: no added delay, but it only
+ * helps if the encoder made several slices per frame (libx264 does with slice threading or the latency profile).
+ *
+ *	"auto"		one thread per core, libavcodec picks frame threading if the codec has it, slices otherwise
+ *	"frame[:N]"	N frame threads (one per core if N is left out)
+ *	"slice[:N]"	N slice threads (one per core if N is left out). "slice:1" is single threaded.
+ *
+ */
+enum CodecThreadType
+{
+	CODEC_THREADS_AUTO,
+	CODEC_THREADS_FRAME,
+	CODEC_THREADS_SLICE
+};
+
+struct CodecThreading
+{
+	CodecThreadType type = CODEC_THREADS_AUTO;
+	int count = 0;		// threads, 0 = one per core
+};
+
+
+/*
+ * bool codecThreadingFromName(const std::string& name, CodecThreading& threading)
+ *
+ * Description:
+ * Look up a threading policy by name ("auto", "frame", "frame:N", "slice", "slice:N"). An empty name is "auto".
+ *
+ * Inputs:
+ *		const std::string& name		policy name
+ *
+ * Outputs:
+ *		CodecThreading& threading	the policy (unchanged if the name is not valid)
+ *		bool (return type)			false if the name is not valid
+ */
+bool codecThreadingFromName(const std::string& name, CodecThreading& threading);
+
+
+/*
+ * std::string codecThreadingName(const CodecThreading& threading)
+ *
+ * Description:
+ * Name of a threading policy, the inverse of codecThreadingFromName().
+ *
+ * Inputs:
+ *		const CodecThreading& threading	the policy
+ *
+ * Outputs:
+ *		std::string (return type)	policy name
+ */
+std::string codecThreadingName(const CodecThreading& threading);
+
+
+/*
+ * struct CodecThreadStats
+ *
+ * Description:
+ * What a threading policy actually turned into, and what it costs (see VideoCodec::getThreadStats()).
+ *
+ */
+struct CodecThreadStats {
+	const char* threadType;		// threading libavcodec is using: "frame", "slice" or "none"
+	int threadCount;			// threads libavcodec is using, 0 = left to the codec library (e.g. libx264 "auto")
+	int reportedDelay;			// frames of delay the codec reports (AVCodecContext::delay)
+	double avgDelay;			// measured frames between a frame going in and the same frame coming out
+	int maxDelay;				// largest measured delay (frames)
+	unsigned long long frames;	// frames that came out of the codec
+	double usPerFrame;			// wall time spent in libavcodec calls per frame, i.e. at most 1e6/usPerFrame fps
+};
+
+/*
+ * void printThreadStats(const std::string& name, const CodecThreadStats& stats)
+ *
+ * Description:
+ * Print a one line summary of a codec's threading statistics to stdout, e.g. when a session ends.
+ *
+ * Inputs:
+ *		const std::string& name		which codec ("Encoder", "Decoder")
+ *		const CodecThreadStats& stats	statistics from VideoCodec::getThreadStats()
+ *
+ * Outputs:
+ *		N/A
+ */
+void printThreadStats(const std::string& name, const CodecThreadStats& stats);
+
+// Frames the delay measurement looks back over (see VideoCodec::codecOutput())
+#define CODEC_PTS_HISTORY 32
+
+
 /*
  * class VideoCodec
  *
@@ -56,10 +154,55 @@ protected:
 	int fps;
 
 	struct SwsContext* swsCtx; // for convering between OpenCV Mat and FFMPEG AVFrame
+	bool colorKernels; // BGR24 <-> YUV420P at an even size goes through ColorConvert instead of swsCtx
 
 	AVPacket* pkt; // compressed information packet
 	AVFrame* frame; // frame for OpenCV/FFMPEG conversions
 
+	CodecThreading threading; // applied to ctx by applyThreading() before it is opened
+
+	// Threading statistics (see getThreadStats())
+	int64_t ptsHistory[CODEC_PTS_HISTORY]; // pts of the last frames/packets that went in, newest at framesIn - 1
+	unsigned long long framesIn; // frames/packets sent to the codec
+	unsigned long long framesOut; // packets/frames received from the codec
+	unsigned long long delaySamples; // outputs whose delay could be measured
+	unsigned long long delaySum;
+	int maxDelay;
+	int64_t codecNs; // wall time in libavcodec send/receive calls
+
+
+	/*
+	 * void applyThreading(void)
+	 *
+	 * Description:
+	 * Set ctx's thread count/type from the threading policy. Must be called before ctx is opened.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void applyThreading(void);
+
+
+	/*
+	 * void codecInput(int64_t pts) / void codecOutput(int64_t pts)
+	 *
+	 * Description:
+	 * Record a frame/packet going in to / coming out of the codec, for the delay statistics. The delay of an output
+	 * is the number of inputs that went in after the one with the same pts (outputs whose pts is not among the
+	 * last CODEC_PTS_HISTORY inputs are only counted).
+	 *
+	 * Inputs:
+	 *		int64_t pts					pts of the frame/packet
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void codecInput(int64_t pts);
+	void codecOutput(int64_t pts);
+
 
 
 public:
@@ -85,13 +228,23 @@ public:
 	 *		N/A
 	 */
 	VideoCodec(const char* strCodecName, const AVPixelFormat pixFrameFormat, const AVPixelFormat pixCodecFormat,
-			   const unsigned int uintWidth, const unsigned int uintHeight, const unsigned int uintFps) :
+			   const unsigned int uintWidth, const unsigned int uintHeight, const unsigned int uintFps,
+			   const CodecThreading codecThreading) :
 		frameFormat(pixFrameFormat),
 		codecFormat(pixCodecFormat), // AV_PIX_FMT_NV12; //AV_PIX_FMT_YUV420
 		codecName(strCodecName),
 		width(uintWidth),
 		height(uintHeight),
 		fps(uintFps),
+		colorKernels(pixFrameFormat == AV_PIX_FMT_BGR24 && pixCodecFormat == AV_PIX_FMT_YUV420P &&
+					 uintWidth % 2 == 0 && uintHeight % 2 == 0),
+		threading(codecThreading),
+		framesIn(0),
+		framesOut(0),
+		delaySamples(0),
+		delaySum(0),
+		maxDelay(0),
+		codecNs(0),
 		isFree(true)
 		 
 	{
@@ -146,9 +299,84 @@ public:
 		av_packet_free(&pkt);
 		sws_freeContext(swsCtx);
 	}
+
+
+	/*
+	 * AVCodecID getCodecId(void) const;
+	 *
+	 * Description:
+	 * Get the FFMPEG id of the codec in use (e.g. for labelling packets on the wire).
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		AVCodecID (return val)		codec id
+	 */
+	AVCodecID getCodecId(void) const
+	{
+		return codec->id;
+	}
+
+
+	/*
+	 * CodecThreadStats getThreadStats(void) const;
+	 *
+	 * Description:
+	 * Threads the codec is really using (libavcodec may use fewer than asked for, or fall back to the other
+	 * threading type), the delay that costs and how long the codec takes per frame, so threading policies can be
+	 * compared on the machine they will run on.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		CodecThreadStats (return val)	threading statistics so far
+	 */
+	CodecThreadStats getThreadStats(void) const;
+};
+
+
+/*
+ * enum EncoderProfile
+ *
+ * Description:
+ * Encoder tuning, picked by name in the client's cameraSettings (see encoderProfileFromName()). B-frames cost at
+ * least one frame of reorder delay and periodic I-frames cause bitrate spikes that can stall the TCP link, so they
+ * are only used where latency does not matter. New/recovering clients get a keyframe on request either way.
+ *
+ *	"latency"	no B-frames. libx264: keyframes (almost) only on request, ultrafast preset, zerolatency tune and
+ *				periodic intra refresh instead of I-frames. Other encoders: a keyframe every second, which is also
+ *				how long a new bit rate can wait (see Encoder::setBitRate()).
+ *	"balanced"	no B-frames, a keyframe every 2 s. libx264: veryfast preset. (default)
+ *	"archive"	2 B-frames, a keyframe every 5 s. libx264: slow preset. Best quality per bit, most delay.
+ *
+ */
+enum EncoderProfile
+{
+	ENCODER_PROFILE_LATENCY,
+	ENCODER_PROFILE_BALANCED,
+	ENCODER_PROFILE_ARCHIVE
 };
 
 
+/*
+ * bool encoderProfileFromName(const std::string& name, EncoderProfile& profile)
+ *
+ * Description:
+ * Look up an encoder profile by name ("latency", "balanced", "archive"). An empty name is "balanced".
+ *
+ * Inputs:
+ *		const std::string& name		profile name
+ *
+ * Outputs:
+ *		EncoderProfile& profile		the profile (unchanged if the name is unknown)
+ *		bool (return type)			false if the name is unknown
+ */
+bool encoderProfileFromName(const std::string& name, EncoderProfile& profile);
+
+
+
 /*
  * class Encoder
  * (derived from VideoCodec)
@@ -161,6 +389,27 @@ class Encoder : public VideoCodec
 {	
 	/********** Private Members **********/
 	unsigned long frameIdx;
+	std::atomic<bool> keyframeRequested; // set by requestKeyframe() (any thread), cleared when the next frame goes in
+	EncoderProfile encProfile;
+	std::atomic<int64_t> bitRate; // current target bit rate (bits/s)
+	std::atomic<int64_t> bitRateRequested; // set by setBitRate() (any thread), applied when the encoder can take it. 0 = none
+	int framesInGop; // frames sent in since the last keyframe went in (finds the GOP boundary for a reopen)
+	AVCodecContext* drainCtx; // context replaced by a bit rate reopen, flushed and emptied by receivePacket()
+
+
+	/*
+	 * void openContext(int64_t targetBitRate)
+	 *
+	 * Description:
+	 * Allocate, fill out (from the codec, size, fps and profile) and open the encoder context.
+	 *
+	 * Inputs:
+	 *		int64_t targetBitRate		bit rate (bits/s)
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void openContext(int64_t targetBitRate);
 
 
 public:
@@ -174,22 +423,38 @@ public:
 
 
 	/*
-	  * Encoder() :
-	  *
-	  * Description:
-	  * TODO.
-	  *
-	  * Inputs:
-	  *		N/A
-	  *
-	  * Outputs:
-	  *		N/A
-	  */
+	 * Encoder() :
+	 *
+	 * Description:
+	 * Find the encoder by name and open it at a starting bit rate of 2.4 bits per pixel per second (width x height x
+	 * fps x 2.4, see setBitRate() to change it), with the GOP and B-frames of the given profile. Also sets up the
+	 * conversion from the frames encode() is given to the format the encoder takes (the ColorConvert kernels for
+	 * BGR24 -> YUV420P at an even size, sws_scale for anything else). Exits if the encoder can't be found or opened.
+	 *
+	 * Inputs:
+	 *		const char* strCodecName				encoder name, e.g. "libx264", "mpeg2video", "mpeg4", "h264_omx"
+	 *		const AVPixelFormat pixFrameFormat		format of the frames passed to encode() (AV_PIX_FMT_BGR24 for OpenCV)
+	 *		const AVPixelFormat pixCodecFormat		format the encoder is fed (AV_PIX_FMT_YUV420P)
+	 *		const unsigned int uintWidth			frame width (pixels)
+	 *		const unsigned int uintHeight			frame height (pixels)
+	 *		const unsigned int uintFps				frame rate, sets the time base, GOP length and bit rate
+	 *		const EncoderProfile profile			latency/balanced/archive trade off (see EncoderProfile)
+	 *		const CodecThreading codecThreading		threads libavcodec may use and how (see CodecThreading)
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
 	Encoder(const char* strCodecName, const AVPixelFormat pixFrameFormat, const AVPixelFormat pixCodecFormat,
-		    const unsigned int uintWidth, const unsigned int uintHeight, const unsigned int uintFps) : 
-		VideoCodec(strCodecName, pixFrameFormat, pixCodecFormat, uintWidth, uintHeight, uintFps)
+		    const unsigned int uintWidth, const unsigned int uintHeight, const unsigned int uintFps,
+		    const EncoderProfile profile = ENCODER_PROFILE_BALANCED, const CodecThreading codecThreading = CodecThreading()) : 
+		VideoCodec(strCodecName, pixFrameFormat, pixCodecFormat, uintWidth, uintHeight, uintFps, codecThreading),
+		encProfile(profile)
 	{
 		frameIdx = 0;
+		keyframeRequested = false;
+		bitRateRequested = 0;
+		framesInGop = 0;
+		drainCtx = NULL;
 		
 		//// ENCODER 
 		//// Setup Codec Context. 
@@ -197,6 +462,7 @@ public:
 		// (2) allocate context
 		// (3) fill out context with codec info.
 		// (4) open codec
+		// (2)-(4) are in openContext() since a bit rate change may need a fresh context
 		codec = avcodec_find_encoder_by_name(codecName);
 		if (!codec)
 		{
@@ -204,38 +470,8 @@ public:
 			exit(1);
 		}
 
-		ctx = avcodec_alloc_context3(codec);
-		if (!ctx) 
-		{
-			std::cerr << "ERR - Could not allocate video codec context" << std::endl;
-			exit(1);
-		}
-
-		ctx->bit_rate = int(float(width * height * fps * 24.0) / 10.0); // TODO figure out a better method for picking bit rate
-		ctx->width = width;
-		ctx->height = height;
-		ctx->time_base = AVRational({ 1, fps });
-		ctx->framerate = AVRational({ fps, 1 });
-		/* emit one intra frame every ten frames
-		 * check frame pict_type before passing frame
-		 * to encoder, if frame->pict_type is AV_PICTURE_TYPE_I
-		 * then gop_size is ignored and the output of encoder
-		 * will always be I frame irrespective to gop_size
-		 */
-		ctx->gop_size = 10;
-		ctx->max_b_frames = 1;
-		ctx->pix_fmt = codecFormat;
-
-		if (codec->id == AV_CODEC_ID_H264) 
-		{
-			av_opt_set(ctx->priv_data, "preset", "slow", 0);
-		}
-		int ret = avcodec_open2(ctx, codec, NULL);
-		if (ret < 0) 
-		{
-			std::cerr << "ERR - Could not open codec" << std::endl;
-			exit(1);
-		}
+		bitRate = int64_t(width) * height * fps * 24 / 10; // starting bit rate, the server's rate control adjusts it from there
+		openContext(bitRate);
 
 		//// Setup Software Rescaler. This is used to convert from OpenCV mat's in BGR24 format 
 		//	 to whatever format our encoder is using
@@ -272,6 +508,7 @@ public:
 	~Encoder(void)
 	{
 		int ret = avcodec_send_frame(ctx, NULL); // flush encoder
+		avcodec_free_context(&drainCtx);
 	}
 
 
@@ -306,11 +543,30 @@ public:
 	bool encodeFrame(AVFrame* frameAV, AVPacket* pktAV);
 
 
+	/*
+	 * bool receivePacket(AVPacket* pktAV)
+	 *
+	 * Description:
+	 * Get another packet that is ready, without sending a frame in. encode() only returns one packet, but after a bit
+	 * rate reopen (see setBitRate()) the old context's delayed frames come out too, so call this after every encode()
+	 * until it returns false. Packets come out in order: the old context's first, then the new one's.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		AVPacket* pktAV				Encoded FFMPEG Video packet
+	 *		bool (return type)			indicates pktAV is valid (false once there is nothing left to get)
+	 */
+	bool receivePacket(AVPacket* pktAV);
+
+
 	/*
 	 * bool encode(cv::Mat& frameCV, AVPacket* pktAV)
 	 *
 	 * Description:
-	 * Encode an OpenCV Mat to an FFMPEG packet using the encoder context defined in constructor.
+	 * Encode an OpenCV Mat to an FFMPEG packet using the encoder context defined in constructor. There may be more
+	 * packets ready than the one returned, see receivePacket().
 	 *
 	 * Inputs:
 	 *		cv::Mat& frameCV				OpencV Video Frame
@@ -321,6 +577,164 @@ public:
 	 */
 	bool encode(cv::Mat& frameCV, AVPacket* pktAV);
 
+
+	/*
+	 * void requestKeyframe(void)
+	 *
+	 * Description:
+	 * Make the next frame passed to encode() an intra (key) frame, instead of waiting for the next one in the GOP.
+	 * Safe to call from any thread.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void requestKeyframe(void);
+
+
+	/*
+	 * void setBitRate(int64_t targetBitRate)
+	 *
+	 * Description:
+	 * Change the target bit rate. libx264 picks the new rate up on the fly, from the next frame passed to encode().
+	 * Other encoders only read it when they are opened, so their context is reopened, and a new context starts on a
+	 * keyframe. So that this never adds a keyframe, the reopen waits for the next one the stream has anyway (the GOP
+	 * boundary, or a requestKeyframe()). Calls in between only replace the rate it will reopen with, so there is at
+	 * most one reopen per GOP. The old context is flushed rather than thrown away, so frames it was still holding
+	 * (B-frames) are not lost: their packets come out of receivePacket() ahead of the new context's. Safe to call from
+	 * any thread.
+	 *
+	 * Inputs:
+	 *		int64_t targetBitRate		bit rate (bits/s)
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void setBitRate(int64_t targetBitRate);
+
+
+	/*
+	 * int64_t getBitRate(void) const
+	 *
+	 * Description:
+	 * The target bit rate (the last one set, it may not have reached the encoder yet).
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		int64_t (return type)		bit rate (bits/s)
+	 */
+	int64_t getBitRate(void) const
+	{
+		return bitRate;
+	}
+
+
+	/*
+	 * bool bitRateIsLive(void) const
+	 *
+	 * Description:
+	 * Whether setBitRate() takes effect on the next frame (libx264), rather than at the next keyframe.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		bool (return type)			true if the encoder changes its bit rate on the fly
+	 */
+	bool bitRateIsLive(void) const;
+
+};
+
+
+
+/*
+ * class AVFrameAllocator
+ *
+ * A cv::MatAllocator for Mats that point straight into a decoded AVFrame's buffer. Each such Mat holds its own
+ * reference to the frame (av_frame_ref()), so the decoder can't reuse the buffer while the Mat or any copy of it is
+ * alive, and the buffer goes back to FFMPEG when the last copy is released. Mats made this way can be queued and
+ * passed between threads like any other Mat. See avFrameToMat().
+ *
+ */
+class AVFrameAllocator : public cv::MatAllocator
+{
+public:
+	/*
+	 * cv::MatAllocator interface, not for users of the allocator. Only deallocate() is reached, when the last Mat
+	 * sharing the buffer descriptor is released. Nothing is ever allocated here: a create() on one of these Mats
+	 * goes to OpenCV's default allocator and gets an ordinary heap buffer.
+	 */
+	cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+						   cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override;
+	bool allocate(cv::UMatData* data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override;
+	void deallocate(cv::UMatData* data) const override;
+};
+
+
+/*
+ * bool avFrameToMat(const AVFrame* frameAV, int plane, int rows, int cols, int type, cv::Mat& frameCV)
+ *
+ * Description:
+ * Point frameCV at one plane of frameAV without copying. frameCV takes its own reference to the frame (see
+ * AVFrameAllocator), so it stays valid after frameAV is unreferenced or reused.
+ *
+ * Inputs:
+ *		const AVFrame* frameAV		reference counted FFMPEG frame (e.g. from avcodec_receive_frame())
+ *		int plane					plane to wrap (0 = luma for planar YUV)
+ *		int rows					plane height
+ *		int cols					plane width (pixels)
+ *		int type					OpenCV type of the plane's pixels (e.g. CV_8UC1)
+ *
+ * Outputs:
+ *		cv::Mat& frameCV			Mat viewing the plane
+ *		bool (return type)			false if the frame could not be referenced (frameCV is left alone)
+ */
+bool avFrameToMat(const AVFrame* frameAV, int plane, int rows, int cols, int type, cv::Mat& frameCV);
+
+
+/*
+ * void releaseIfShared(cv::Mat& image)
+ *
+ * Description:
+ * Let go of image's buffer unless image is its only owner, so whatever is written into image next can't change a
+ * frame someone else still holds (e.g. one sitting in a queue). A Mat pointing at memory it does not own is let go
+ * of too. An unshared buffer (e.g. just acquired from a FramePool) is kept, and create() will reuse it.
+ *
+ * Inputs:
+ *		cv::Mat& image				Mat about to be written into
+ *
+ * Outputs:
+ *		cv::Mat& image				image, or an empty Mat
+ */
+inline void releaseIfShared(cv::Mat& image)
+{
+	if (!image.u || image.u->refcount > 1)
+		image.release();
+}
+
+
+
+/*
+ * enum DecoderOutput
+ *
+ * Description:
+ * What the Decoder hands back for each frame (see Decoder::setOutput()).
+ *
+ *	DECODER_OUTPUT_BGR		CV_8UC3 BGR24, converted from the decoder's YUV with sws_scale. (default)
+ *	DECODER_OUTPUT_LUMA		CV_8UC1, the decoded frame's Y plane itself (no conversion, no copy, the Mat holds a
+ *							reference to the decoder's frame, see AVFrameAllocator). Enough for
+ *							anything that only looks at intensity, e.g. background subtraction. The BGR picture
+ *							can still be had for the same frame with Decoder::retrieveBGR().
+ *
+ */
+enum DecoderOutput
+{
+	DECODER_OUTPUT_BGR,
+	DECODER_OUTPUT_LUMA
 };
 
 
@@ -337,10 +751,31 @@ class Decoder : public VideoCodec
 {
 	/********** Private Members **********/
 	AVCodecParserContext* parser; // gathers incoming packets until it can form a frame
-	AVFrame* tmpFrame; // frame to assist with AV->CV conversion
 
 	AVPacket* pktParse; // A packet to keep track of where we are while parsing
 
+	unsigned long errorCount; // packets that failed to decode / frames that came out damaged (decodeFramed)
+	int64_t lastPts; // pts of the last frame decodeFramed() output (the pts of the packet it came from)
+	DecoderOutput outputMode;
+	bool frameReady; // 'frame' holds the last frame decode()/decodeFramed() output (for retrieveBGR())
+
+
+	/*
+	 * void scaleToBGR(AVFrame* frameAV, cv::Mat& frameCV)
+	 *
+	 * Description:
+	 * Convert a decoded frame to BGR24 straight into frameCV, with the ColorConvert kernels for limited range
+	 * YUV420P and sws_scale for anything else. frameCV's buffer is reused if it is the right size and frameCV is its
+	 * only owner, otherwise frameCV gets a new one (see releaseIfShared()).
+	 *
+	 * Inputs:
+	 *		AVFrame* frameAV			decoded FFMPEG Video Frame (codecFormat)
+	 *
+	 * Outputs:
+	 *		cv::Mat& frameCV			BGR24 video frame
+	 */
+	void scaleToBGR(AVFrame* frameAV, cv::Mat& frameCV);
+
 public:
 	/********** Public Members **********/
 
@@ -355,17 +790,32 @@ public:
 	 * Decoder() :
 	 *
 	 * Description:
-	 * TODO.
+	 * Find the decoder (by decoder name, or by the name of the encoder that made the stream), open it, and set up
+	 * the bitstream parser and the conversion from the decoder's output to the frames decode() hands back (the
+	 * ColorConvert kernels for YUV420P -> BGR24 at an even size, sws_scale for anything else). The stream's size
+	 * and format come from the packets themselves, the ones given here are what the conversion is set up for.
+	 * Exits if the decoder or its parser can't be found or opened.
 	 *
 	 * Inputs:
-	 *		N/A
+	 *		const char* strCodecName				decoder name (e.g. "h264", "h264_cuvid") or encoder name (e.g. "libx264")
+	 *		const AVPixelFormat pixFrameFormat		format of the frames decode() returns (AV_PIX_FMT_BGR24 for OpenCV)
+	 *		const AVPixelFormat pixCodecFormat		format the decoder outputs (AV_PIX_FMT_YUV420P)
+	 *		const unsigned int uintWidth			frame width (pixels)
+	 *		const unsigned int uintHeight			frame height (pixels)
+	 *		const unsigned int uintFps				frame rate of the stream
+	 *		const CodecThreading codecThreading		threads libavcodec may use and how (see CodecThreading)
 	 *
 	 * Outputs:
 	 *		N/A
 	 */
 	Decoder(const char* strCodecName, const AVPixelFormat pixFrameFormat, const AVPixelFormat pixCodecFormat,
-		    const unsigned int uintWidth, const unsigned int uintHeight, const unsigned int uintFps) :
-		VideoCodec(strCodecName, pixFrameFormat, pixCodecFormat, uintWidth, uintHeight, uintFps)
+		    const unsigned int uintWidth, const unsigned int uintHeight, const unsigned int uintFps,
+		    const CodecThreading codecThreading = CodecThreading()) :
+		VideoCodec(strCodecName, pixFrameFormat, pixCodecFormat, uintWidth, uintHeight, uintFps, codecThreading),
+		errorCount(0),
+		lastPts(AV_NOPTS_VALUE),
+		outputMode(DECODER_OUTPUT_BGR),
+		frameReady(false)
 	{
 		//// DECODER 
 		//// Setup Codec Context. 
@@ -373,7 +823,15 @@ public:
 		// (2) allocate context
 		// ( ) No need to fill out contex, this is all derived from incoming packets in the FFMPEG code
 		// (4) open codec
+		// The clients name the stream by the server's encoder (e.g. libx264), which is often not a decoder's name
+		// too, so fall back to the decoder for that encoder's bitstream
 		codec = avcodec_find_decoder_by_name(codecName);
+		if (!codec)
+		{
+			const AVCodec* encoder = avcodec_find_encoder_by_name(codecName);
+			if (encoder)
+				codec = avcodec_find_decoder(encoder->id);
+		}
 		if (!codec) 
 		{
 			std::cerr << "ERR - Codec not found" << std::endl;
@@ -391,6 +849,7 @@ public:
 		{
 			av_opt_set(ctx->priv_data, "preset", "slow", 0);
 		}
+		applyThreading();
 
 		int ret = avcodec_open2(ctx, codec, NULL);
 		if (ret < 0) 
@@ -431,22 +890,8 @@ public:
 		if (!pktParse)
 			exit(1);
 
-		// Tmp frame to hold FFMPEG frame (codec format) -> temp FFMPEG (frame format) -> OpenCV Mat (frame format)
-		tmpFrame = av_frame_alloc();
-		if (!tmpFrame)
-		{
-			std::cerr << "ERR - Could not allocate conversion video frame" << std::endl;
-			exit(1);
-		}
-		tmpFrame->format = frameFormat;
-		tmpFrame->width = width;
-		tmpFrame->height = height;
-		ret = av_frame_get_buffer(tmpFrame, 0);
-		if (ret < 0)
-		{
-			std::cerr << "ERR - Could not allocate the conversion video frame data" << std::endl;
-			exit(1);
-		}
+		// Note: there is no conversion scratch frame. Frames are converted straight into the caller's Mat
+		// (see convertFrame_AV2CV()), so a decoded frame never shares a buffer with the next one.
 	}
 
 
@@ -466,7 +911,6 @@ public:
 	{
 		int ret = avcodec_send_packet(ctx, NULL); //flush decoder
 		av_packet_free(&pktParse);
-		av_frame_free(&tmpFrame);
 		av_parser_close(parser);
 	}
 
@@ -475,7 +919,10 @@ public:
 	 * void convertFrame_AV2CV(AVFrame* frameAV, const cv::Mat& frameCV);
 	 *
 	 * Description:
-	 * Converts an FFMPEG AVFrame to an OpenCV Mat.
+	 * Converts an FFMPEG AVFrame to an OpenCV Mat. BGR output is written into frameCV's own buffer if it is the right
+	 * size and frameCV is its only owner (e.g. a buffer just acquired from a FramePool), otherwise into a new one.
+	 * Luma output references the AVFrame (see AVFrameAllocator). Either way the result can be queued as-is, the
+	 * next frame never overwrites it.
 	 *
 	 * Inputs:
 	 *      AVFrame* frameAV			FFMPEG Video Frame
@@ -517,4 +964,97 @@ public:
 	 *		bool (return type)			indicates pktAV is valid (i.e. there was info to compress and we get a packet)
 	 */
 	bool decode(AVPacket* pktAV, cv::Mat& frameCV);
+
+
+	/*
+	 * bool decodeFramed(AVPacket* pktAV, cv::Mat& frameCV)
+	 *
+	 * Description:
+	 * Decode one complete encoded packet (e.g. one frame from the framed stream, see StreamProtocol.h) and get an
+	 * OpenCV Mat. Unlike decode() this skips the parser, the caller already knows where the packet ends.
+	 * A packet may not produce a frame right away (codec delay), false is returned until one comes out.
+	 *
+	 * Inputs:
+	 *      AVPacket* pktAV				One complete encoded FFMPEG Video packet
+	 *
+	 * Outputs:
+	 *		cv::Mat& frameCV			OpencV Video Frame
+	 *		bool (return type)			indicates frameCV is valid
+	 */
+	bool decodeFramed(AVPacket* pktAV, cv::Mat& frameCV);
+
+
+	/*
+	 * unsigned long getErrorCount(void) const
+	 *
+	 * Description:
+	 * Number of packets decodeFramed() could not decode, plus frames it output that the decoder flagged as damaged
+	 * (e.g. their reference frames were never received). A change means the picture is broken until the next keyframe.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		unsigned long (return type)	decode errors so far
+	 */
+	unsigned long getErrorCount(void) const
+	{
+		return errorCount;
+	}
+
+
+	/*
+	 * int64_t getLastPts(void) const
+	 *
+	 * Description:
+	 * The pts of the last frame decodeFramed() output, i.e. the pts the caller set on the packet it was decoded from
+	 * (B-frames come out in a different order than their packets went in). AV_NOPTS_VALUE if unknown.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		int64_t (return type)		pts of the last frame
+	 */
+	int64_t getLastPts(void) const
+	{
+		return lastPts;
+	}
+
+
+	/*
+	 * void setOutput(DecoderOutput mode)
+	 *
+	 * Description:
+	 * Pick what decode()/decodeFramed() hand back from the next frame on (see DecoderOutput).
+	 *
+	 * Inputs:
+	 *		DecoderOutput mode			DECODER_OUTPUT_BGR or DECODER_OUTPUT_LUMA
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void setOutput(DecoderOutput mode)
+	{
+		outputMode = mode;
+	}
+
+
+	/*
+	 * bool retrieveBGR(cv::Mat& frameCV)
+	 *
+	 * Description:
+	 * Convert the last decoded frame to BGR24, for the consumers that need color (display, recording) when the
+	 * decoder is outputting luma. The frame is converted into frameCV's own buffer (reused if frameCV is its only
+	 * owner, e.g. a buffer just taken from a FramePool, see releaseIfShared()), so it stays valid after the next
+	 * decode and can be kept or queued without a copy.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		cv::Mat& frameCV			BGR24 video frame
+	 *		bool (return type)			false if no frame has been decoded yet
+	 */
+	bool retrieveBGR(cv::Mat& frameCV);
 };
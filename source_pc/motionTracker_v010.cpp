@@ -16,37 +16,63 @@
  * used is from a Matlab example program from the Computer Vision toolbox, but ported to C++ and
  * OpenCV.
  *
+ * Motion detection only needs intensity, so frames are received as 8 bit luma (straight from the decoder, no color
+ * conversion). The color picture is only produced when it is shown (--color).
+ *
  * Note for myself: RPi ETH0 =	192.168.0.112
  *					port =		20006
  *
  */
 
 #include <thread>
-#include <mutex>
+#include <atomic>
+#include <chrono>
 #include "VideoCapturePi.h"
 #include "MotionTracker.h"
 #include "CircularFrameBuf.h"
+#include "FramePool.h"
+#include "FrameRotate.h"
+
+
+
+// How long a thread sleeps on an empty/full queue before re-checking whether the program is exiting
+#define QUEUE_TIMEOUT std::chrono::milliseconds(100)
+
+// Number of preallocated frame buffers shared by the receive and video processing threads.
+// Running out falls back to the heap (and is reported at exit).
+#define FRAME_POOL_SIZE 16
 
 
 
  /******************** Function Definitions ********************/
-cv::Mat flipMat(const cv::Mat& inImage);
 void processVideo(cv::Mat frameIn);
 
 
 
 /******************** Global Variables ********************/
-// Circular buffers / mutexes for video frames going to video processing thread, and frames coming out
-std::mutex qFrameRaw_mutex;
-QueueMat qFrameRaw(64);
-std::mutex qFrameProc_mutex;
-QueueMat qFrameProc(64);
+// Pools of frame buffers (luma for the tracker, BGR for display if enabled). Frames move through the queues by handle
+// and return here when processed. Declared before the queues so they outlive any frame they hold.
+FramePool framePool;
+FramePool colorPool;
+
+// A frame on its way to the video processing thread: the luma the tracker works on, and the same frame in color
+// when it is displayed in color (empty otherwise)
+struct trackerFrame
+{
+    cv::Mat gray;
+    cv::Mat color;
+};
+
+// Circular buffers for video frames going to video processing thread, and frames coming out.
+// Each queue has exactly one producer and one consumer thread, so no locking is needed.
+RingBuffer<trackerFrame, 64> qFrameRaw;
+RingBuffer<cv::Mat, 64> qFrameProc;
 
 // Motion tracking object pointer (is initialized in main());
 MotionTracker* mTracker;
 
-// Allow program to exit when user hits ESC
-bool exitProgram = false;
+// Allow program to exit when user hits ESC (set by the processing thread) or the stream is lost (set by main)
+std::atomic<bool> exitProgram(false);
 
 
 
@@ -61,6 +87,14 @@ int main(int argc, char* argv[])
         "{ip             | 192.168.0.112 | ip address of RPI                                              }"
         "{port           | 20006         | port of RPI socket                                             }"
         "{codec          | mpeg4         | Compression? ('none' for no, 'mpeg2video', 'mpeg4', etc for yes}"
+        "{profile        | latency       | encoder profile ('latency', 'balanced', 'archive')             }"
+        "{encthreads     | slice         | server encoder threading ('auto', 'frame[:N]', 'slice[:N]')     }"
+        "{decthreads     | slice         | decoder threading ('auto', 'frame[:N]', 'slice[:N]')            }"
+        "{queue          | latest        | frame queue overflow ('block', 'dropnewest', 'dropoldest', 'latest')}"
+        "{maxage         | 0             | drop frames older than this many ms before processing (0 = never)}"
+        "{flip           | true          | rotate frames 180 degrees (camera mounted upside down)          }"
+        "{color          | false         | show the video in color (costs a color conversion per frame)    }"
+        "{detector       | cc            | blob detection ('cc' connected components, 'simple' SimpleBlobDetector)}"
         ;
 
     cv::CommandLineParser parser(argc, argv, keys);
@@ -77,6 +111,14 @@ int main(int argc, char* argv[])
     std::string ip = parser.get<std::string>("ip");
     unsigned int port = parser.get<unsigned int>("port");
     std::string codec = parser.get<std::string>("codec");
+    std::string profile = parser.get<std::string>("profile");
+    std::string encThreads = parser.get<std::string>("encthreads");
+    std::string decThreads = parser.get<std::string>("decthreads");
+    std::string queuePolicy = parser.get<std::string>("queue");
+    unsigned int maxAge = parser.get<unsigned int>("maxage");
+    bool flip = parser.get<bool>("flip");
+    bool color = parser.get<bool>("color");
+    std::string detector = parser.get<std::string>("detector");
 
 
     if (!parser.check())
@@ -85,12 +127,37 @@ int main(int argc, char* argv[])
         return 1;
     }
 
+    OverflowPolicy policy;
+    if (queuePolicy == "block")
+        policy = OVERFLOW_BLOCK;
+    else if (queuePolicy == "dropnewest")
+        policy = OVERFLOW_DROP_NEWEST;
+    else if (queuePolicy == "dropoldest")
+        policy = OVERFLOW_DROP_OLDEST;
+    else if (queuePolicy == "latest")
+        policy = OVERFLOW_LATEST_ONLY;
+    else
+    {
+        std::cerr << "Unknown queue policy '" << queuePolicy << "'" << std::endl;
+        return 1;
+    }
+
+    if (detector != "cc" && detector != "simple")
+    {
+        std::cerr << "Unknown blob detector '" << detector << "'" << std::endl;
+        return 1;
+    }
+
+    // A backlog of frames is only latency for a live tracker, so by default processing always gets the newest frame
+    qFrameRaw.setOverflowPolicy(policy, std::chrono::milliseconds(maxAge));
+
 
 
     /******************** Camera Setup ********************/
     // Note: This constructor overload will open socket and set up camera so 
     // we are ready to stream after.
-    VideoCapturePi vidCam(ip, port, width, height, fps, codec);
+    // Slice threading by default: frame threads add a frame of delay per thread on both ends
+    VideoCapturePi vidCam(ip, port, width, height, fps, codec, profile, encThreads, decThreads);
 
     if (!vidCam.isOpened())
     {
@@ -105,40 +172,53 @@ int main(int argc, char* argv[])
     pBackSub->setNMixtures(3); // set to match Matlab
 
 
-    SimpleBlobDetector::Params blobParams;
-    blobParams.minThreshold = 0;
-    blobParams.maxThreshold = 254;
-    blobParams.thresholdStep = 253;
-    blobParams.minDistBetweenBlobs = 50;
-    blobParams.filterByArea = true;
-    blobParams.minArea = 400;
-    blobParams.maxArea = (height * width) / 10; // allow blobs as large as 1/10th the screen to be detected
-    blobParams.filterByColor = false;
-    blobParams.filterByCircularity = false;
-    blobParams.filterByConvexity = false;
-    blobParams.filterByInertia = false;
-    Ptr<SimpleBlobDetector> pBlobDetector = SimpleBlobDetector::create(blobParams);
-
-
     Mat openStrel = getStructuringElement(cv::MORPH_RECT, Size(10, 10));
     Mat closeStrel = getStructuringElement(cv::MORPH_RECT, Size(20, 20));
 
 
-    mTracker = new MotionTracker(pBackSub, pBlobDetector, openStrel, closeStrel, fps);
-    Mat frame = cv::Mat::zeros(height, width, CV_8UC3), flipImg;// , detectFrame, mask;
-    //std::vector<KeyPoint> detectedCentroids, trackedCentroids;
-
-    // For some reason the CODEC needs a few seconds to gather itself before streaming, maybe to flush
-    // after it initializes?
-    if (codec != "none")
+    if (detector == "simple")
     {
-        std::cout << "Flushing CODEC..." << std::endl;
-        Sleep(3000);
+        SimpleBlobDetector::Params blobParams;
+        blobParams.minThreshold = 0;
+        blobParams.maxThreshold = 254;
+        blobParams.thresholdStep = 253;
+        blobParams.minDistBetweenBlobs = 50;
+        blobParams.filterByArea = true;
+        blobParams.minArea = 400;
+        blobParams.maxArea = (height * width) / 10; // allow blobs as large as 1/10th the screen to be detected
+        blobParams.filterByColor = false;
+        blobParams.filterByCircularity = false;
+        blobParams.filterByConvexity = false;
+        blobParams.filterByInertia = false;
+        Ptr<SimpleBlobDetector> pBlobDetector = SimpleBlobDetector::create(blobParams);
+
+        mTracker = new MotionTracker(pBackSub, pBlobDetector, openStrel, closeStrel, fps);
     }
+    else
+    {
+        // Same limits as the SimpleBlobDetector settings, but the distance is between boxes rather than centers
+        BlobParams blobParams;
+        blobParams.minDistBetweenBlobs = 50;
+        blobParams.minArea = 400;
+        blobParams.maxArea = (height * width) / 10; // allow blobs as large as 1/10th the screen to be detected
+
+        mTracker = new MotionTracker(pBackSub, blobParams, openStrel, closeStrel, fps);
+    }
+    // The tracker runs on luma, the BGR conversion is only paid for if the frames are shown in color
+    vidCam.setOutputGray(true);
+    Mat frame = cv::Mat::zeros(height, width, CV_8UC1), colorFrame;// , detectFrame, mask;
+    trackerFrame item;
+    framePool.configure(height, width, CV_8UC1, FRAME_POOL_SIZE);
+    if (color)
+        colorPool.configure(height, width, CV_8UC3, FRAME_POOL_SIZE);
+    //std::vector<KeyPoint> detectedCentroids, trackedCentroids;
+
+    // No need to wait for the CODEC to settle: the server starts every client on a keyframe, so the first
+    // packet we get decodes straight away.
 
 
     /******************** Video Processor Thread Setup ********************/
-    cv::Mat frameVid(height, width, CV_8UC3);
+    cv::Mat frameVid(height, width, CV_8UC1);
     std::thread vidProc_Thread;
     vidProc_Thread = std::thread(processVideo, frameVid);
 
@@ -146,19 +226,68 @@ int main(int argc, char* argv[])
 
     /******************** Primary Application Loop ********************/
     // Loop forever getting video frames, putting them in the circular buffer.
-    bool success = false;
+    bool success = false, firstFrame = true;
     while (!exitProgram)
     {
-        vidCam >> frame;
-        frame = flipMat(frame);
+        // A failed read means the server closed the stream (or it broke), so shut down cleanly
+        if (!vidCam.read(frame))
+        {
+            std::cerr << "Lost video stream, exiting" << std::endl;
+            exitProgram = true;
+            qFrameRaw.shutdown(); // wake the processing thread if it is waiting for a frame
+            break;
+        }
+        if (firstFrame)
+        {
+            std::cout << "First frame after " << vidCam.getStreamStats().firstFrameMs << " ms" << std::endl;
+            firstFrame = false;
+        }
 
-        // Loop until we can get a lock to put frame into queue
+        // The frame never shares a buffer with the next one (see VideoCapturePi::read()), so it goes in the queue as
+        // it is. An upside down camera costs one pass over the frame: rotated into a pool buffer rather than in place,
+        // since the luma frame is the decoder's own (reference) picture.
+        if (flip)
+        {
+            framePool.acquire(item.gray);
+            rotate180(frame, item.gray);
+        }
+        else
+        {
+            item.gray = frame;
+        }
+
+        // The color frame is only fetched now that we know it is wanted. An encoded frame is converted straight into
+        // a pool buffer that is ours to rotate in place. A raw frame is the capture's own buffer (see
+        // VideoCapturePi::retrieveColor()), so it is only read, and rotated into a pool buffer if it needs to be.
+        item.color.release();
+        if (color)
+        {
+            if (codec != "none")
+                colorPool.acquire(colorFrame);
+            else
+                colorFrame.release();
+
+            if (vidCam.retrieveColor(colorFrame))
+            {
+                if (flip && codec == "none")
+                {
+                    colorPool.acquire(item.color);
+                    rotate180(colorFrame, item.color);
+                }
+                else
+                {
+                    if (flip)
+                        rotate180(colorFrame, colorFrame);
+                    item.color = colorFrame;
+                }
+            }
+        }
+
+        // Put the frame in the queue. Only the 'block' policy ever has to sleep here until there is room,
+        // the others make room (or drop the frame) according to the policy.
 		do
 		{
-			qFrameRaw_mutex.lock();
-			success = qFrameRaw.enQueue(frame);
-            qFrameRaw_mutex.unlock(); 
-
+			success = qFrameRaw.push(item, QUEUE_TIMEOUT);
 		} while (!success && !exitProgram);
 
 
@@ -177,38 +306,29 @@ int main(int argc, char* argv[])
 
     }
 
-    delete mTracker;
+    // The processing thread may still be part way through a frame with the tracker, so wait for it to finish first
     vidProc_Thread.join();
-}
-
-
-/*
- * cv::Mat flipMat(const cv::Mat& inImage)
- *
- * Description:
- * This functions horizontall and vertically flips an OpenCv matrix. It's convienient for when a camera
- * is upside down.
- * 
- *
- * Inputs:
- *		cv::Mat& inFrame			    input matrix to flip
- * 
- * Outputs:
- *		cv::Mat (return type)           flipped matrix
- */
-cv::Mat flipMat(const cv::Mat& inImage)
-{
-    cv::Mat outImage = cv::Mat::zeros(inImage.rows, inImage.cols, CV_8UC3);
-
-    for (int row = 0; row < inImage.rows; row++)
-    {
-        for (int col = 0; col < inImage.cols; col++)
-        {
-            outImage.at<cv::Vec3b>((inImage.rows - 1) - row, (inImage.cols - 1) - col) = inImage.at<cv::Vec3b>(row, col);
-        }
-    }
+    delete mTracker;
 
-    return outImage;
+    FramePoolStats poolStats = framePool.getStats();
+    std::cout << "Frame pool (luma): " << poolStats.acquired << " frames, peak " << poolStats.peakInUse << "/" << poolStats.numBuffers
+        << " buffers in use, " << poolStats.exhausted << " exhausted, " << poolStats.oversize << " oversize" << std::endl;
+
+    VideoStreamStats streamStats = vidCam.getStreamStats();
+    std::cout << "Stream: " << streamStats.framesReceived << " frames, " << streamStats.framesLost << " lost, latency "
+        << streamStats.avgLatencyMs << " ms avg / " << streamStats.lastLatencyMs << " ms last, first frame after "
+        << streamStats.firstFrameMs << " ms" << std::endl;
+    std::cout << "Capture -> frame ready: " << streamStats.avgFrameLatencyMs << " ms avg / " << streamStats.lastFrameLatencyMs
+        << " ms last over " << streamStats.framesOutput << " frames" << std::endl;
+
+    CodecThreadStats threadStats;
+    if (vidCam.getDecoderThreadStats(threadStats))
+        printThreadStats("Decoder", threadStats);
+
+    RingBufferStats queueStats = qFrameRaw.getStats();
+    std::cout << "Frame queue (" << queuePolicy << "): " << queueStats.enqueued << " queued, " << queueStats.dequeued << " processed, dropped "
+        << queueStats.droppedNewest << " newest / " << queueStats.droppedOldest << " oldest / " << queueStats.superseded << " superseded / "
+        << queueStats.expired << " expired" << std::endl;
 }
 
 
@@ -228,28 +348,28 @@ cv::Mat flipMat(const cv::Mat& inImage)
  */
 void processVideo(cv::Mat frameIn)
 {
-    bool success = false;
     cv::Mat mask, detectFrame;
+    std::vector<blob> detectedBlobs;
     std::vector<KeyPoint> detectedCentroids, trackedCentroids;
+    trackerFrame item;
 
     while (!exitProgram)
     {
-        // Loop until we can get a lock to put frame into queue
-        do
-        {
-            qFrameRaw_mutex.lock();
-            success = qFrameRaw.deQueue(frameIn);
-            qFrameRaw_mutex.unlock();
-        } while (!success);
+        // Sleep until a frame is available in the queue
+        if (!qFrameRaw.pop(item, QUEUE_TIMEOUT))
+            continue;
+        frameIn = item.gray;
 
-        mTracker->detect(frameIn, mask, detectedCentroids);
+        mTracker->detect(frameIn, mask, detectedBlobs);
+        blobsToKeyPoints(detectedBlobs, detectedCentroids);
         mTracker->predictNewLocationsOfTracks();
         mTracker->getCentroids(trackedCentroids);
         mTracker->assignDetectionsToTracks(detectedCentroids, 200.0);
         mTracker->deleteLostTracks();
 
-        drawKeypoints(frameIn, trackedCentroids, detectFrame, Scalar(0, 0, 255), DrawMatchesFlags::DRAW_RICH_KEYPOINTS);
-        drawKeypoints(detectFrame, detectedCentroids, detectFrame, Scalar(0, 255, 255), DrawMatchesFlags::DRAW_RICH_KEYPOINTS);
+        drawKeypoints(item.color.empty() ? frameIn : item.color, trackedCentroids, detectFrame, Scalar(0, 0, 255), DrawMatchesFlags::DRAW_RICH_KEYPOINTS);
+        for (auto& detected : detectedBlobs)
+            rectangle(detectFrame, detected.bbox, Scalar(0, 255, 255));
         imshow("blobs", detectFrame);
 
         drawKeypoints(mask, trackedCentroids, detectFrame, Scalar(0, 0, 255), DrawMatchesFlags::DRAW_RICH_KEYPOINTS);
@@ -260,6 +380,7 @@ void processVideo(cv::Mat frameIn)
         if (c == 27)
         {
             exitProgram = true;
+            qFrameRaw.shutdown(); // wake the main loop if it is waiting for room in the queue
         }
     }
 }
@@ -0,0 +1,205 @@
+/*
+ * Author:  Jordan Leiker
+ * Class: ECE6122
+ * Last Date Modified: 10/16/2026
+ *
+ * Description:
+ * This is the header file for the FramePool class. FramePool is a fixed size pool of preallocated, 64 byte
+ * aligned frame buffers that hands out ordinary reference counted cv::Mat's.
+ *
+ * FramePool plugs in to OpenCV as a cv::MatAllocator. A Mat acquired from the pool behaves exactly like any
+ * other Mat (copies share the buffer and bump the reference count), but when the last reference goes away the
+ * buffer is returned to the pool instead of being freed. This lets the capture, encode and tracking threads
+ * pass frames through the queues by handle - one buffer per frame, no clone()/copyTo() per hop.
+ *
+ */
+
+#pragma once
+#include <mutex>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// Alignment of every pooled buffer (cache line size, and enough for any SIMD load/store)
+#define FRAME_POOL_ALIGN 64
+
+
+/*
+ * struct FramePoolStats
+ *
+ * Description:
+ * Usage counters for a FramePool. "exhausted" counts allocations that found the pool empty, "oversize" counts
+ * allocations larger than a pool buffer. Both fall back to the heap, so non-zero values mean the pool is too small.
+ *
+ */
+struct FramePoolStats
+{
+	size_t numBuffers;				// buffers owned by the pool
+	size_t inUse;					// buffers currently handed out
+	size_t peakInUse;				// most buffers ever handed out at once
+	unsigned long long acquired;	// total allocations served from the pool
+	unsigned long long exhausted;	// allocations that found the pool empty (heap fallback)
+	unsigned long long oversize;	// allocations too large for a pool buffer (heap fallback)
+};
+
+
+/*
+ * class FramePool
+ *
+ * The FramePool class owns a fixed number of equally sized frame buffers and hands them out as cv::Mat's.
+ * Buffers go back to the pool automatically when the last Mat referencing them is released, so they can
+ * be freely moved between threads/queues.
+ *
+ * Note: The pool must outlive every Mat acquired from it.
+ *
+ */
+class FramePool : public cv::MatAllocator
+{
+	/********** Private Members **********/
+	struct poolBuffer
+	{
+		uchar* data;		// 64 byte aligned start of the buffer
+		uchar* origData;	// pointer returned by the heap (what gets freed)
+	};
+
+	int rows;
+	int cols;
+	int type;
+	size_t bufferSize;
+	size_t generation; // bumped by configure() so buffers from an older configuration are not pooled again
+
+	// The cv::MatAllocator interface is const, so all bookkeeping is mutable
+	mutable std::mutex poolMutex;
+	mutable std::vector<poolBuffer> freeList;
+	mutable size_t numBuffers;
+	mutable size_t inUse;
+	mutable size_t peakInUse;
+	mutable unsigned long long acquired;
+	mutable unsigned long long exhausted;
+	mutable unsigned long long oversize;
+
+
+	/*
+	 * void freeBuffers(void);
+	 *
+	 * Description:
+	 * Free every buffer sitting in the free list. Buffers still handed out are freed when they come back.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void freeBuffers(void);
+
+
+
+public:
+	/********** Public Members **********/
+
+	/*
+	 * FramePool(void) :
+	 *
+	 * Description:
+	 * Default constructor. The pool is empty (every allocation falls back to the heap) until configure() is called.
+	 * This allows a global pool to be declared before the frame size is known.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	FramePool(void);
+
+
+	/*
+	 * FramePool(int inRows, int inCols, int inType, size_t inNumBuffers) :
+	 *
+	 * Description:
+	 * Constructor that immediately preallocates the pool. See configure().
+	 *
+	 * Inputs:
+	 *		int inRows					frame height
+	 *		int inCols					frame width
+	 *		int inType					OpenCV frame type (e.g. CV_8UC3)
+	 *		size_t inNumBuffers			number of buffers to preallocate
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	FramePool(int inRows, int inCols, int inType, size_t inNumBuffers);
+
+
+	/*
+	 * ~FramePool(void) :
+	 *
+	 * Description:
+	 * Destructor for FramePool class. Frees the pooled buffers.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	~FramePool(void);
+
+
+	/*
+	 * void configure(int inRows, int inCols, int inType, size_t inNumBuffers);
+	 *
+	 * Description:
+	 * (Re)allocate the pool for frames of the given size/type. Buffers of a previous configuration that are still
+	 * handed out stay valid and are freed (not pooled) when they are released.
+	 *
+	 * Inputs:
+	 *		int inRows					frame height
+	 *		int inCols					frame width
+	 *		int inType					OpenCV frame type (e.g. CV_8UC3)
+	 *		size_t inNumBuffers			number of buffers to preallocate
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void configure(int inRows, int inCols, int inType, size_t inNumBuffers);
+
+
+	/*
+	 * void acquire(cv::Mat& frame);
+	 *
+	 * Description:
+	 * Drop whatever frame was holding and point it at a free pool buffer of the configured size/type.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		cv::Mat& frame				Mat backed by a pool buffer (heap buffer if the pool is exhausted)
+	 */
+	void acquire(cv::Mat& frame);
+
+
+	/*
+	 * FramePoolStats getStats(void) const;
+	 *
+	 * Description:
+	 * Get a snapshot of the pool usage counters.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		FramePoolStats (return val)	pool usage counters
+	 */
+	FramePoolStats getStats(void) const;
+
+
+	/*
+	 * cv::MatAllocator interface. These are called by cv::Mat::create()/release(), not by users of the pool.
+	 */
+	cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+						   cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override;
+	bool allocate(cv::UMatData* data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override;
+	void deallocate(cv::UMatData* data) const override;
+};
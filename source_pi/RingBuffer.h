@@ -0,0 +1,742 @@
+/*
+ * Author:  Jordan Leiker
+ * Class: ECE6122
+ * Last Date Modified: 10/16/2026
+ *
+ * Description:
+ * This is the header for a generic, lock-free, single-producer/single-consumer (SPSC) circular buffer. It
+ * replaces the QueueMat/QueuePkt pair that used to be wrapped in a std::mutex at every call site.
+ *
+ * Exactly one thread may add items (enQueue) and exactly one thread may remove items (deQueue). The two threads
+ * only communicate through the head/tail indices and per-slot sequence numbers, which are published with
+ * acquire/release atomics, so neither side ever blocks the other. Head and tail sit on their own cache lines so
+ * the producer and consumer cores do not fight over the same line (false sharing).
+ *
+ * On top of the non-blocking enQueue/deQueue there are blocking push/pop calls (with a timeout) that put the
+ * calling thread to sleep on a condition variable instead of spinning, and a shutdown() that wakes every sleeper.
+ * The condition variable is only touched when a thread is actually asleep, so the fast path stays lock-free.
+ * The sleep/wake logic lives in QueueWaiter so other queues can reuse it.
+ *
+ * For live video a full queue is often the wrong thing to wait on, so each queue has an overflow policy
+ * (block, drop the newest item, drop the oldest item, keep only the latest item) and an optional maximum age
+ * after which items are discarded instead of being handed to the consumer. Every drop is counted.
+ *
+ */
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <thread>
+
+// Size of a cache line on every target we run on (x86-64 PC and the Pi's Cortex-A53)
+#define RING_BUFFER_CACHE_LINE 64
+
+
+/*
+ * class QueueWaiter
+ *
+ * Description:
+ * Lets the threads on either end of a lock-free queue sleep until the queue state changes. The queue calls
+ * wake() after every state change and the sleeping side calls waitFor(). waiters counts sleeping threads, so
+ * wake() only takes the mutex to notify when someone is actually waiting.
+ *
+ */
+class QueueWaiter
+{
+	/********** Private Members **********/
+	std::mutex waitMutex;
+	std::condition_variable waitCond;
+	std::atomic<int> waiters;
+	std::atomic<bool> closed;
+
+
+public:
+	/********** Public Members **********/
+
+	/*
+	 * QueueWaiter(void)
+	 *
+	 * Description:
+	 * Constructor. Nobody is waiting and the queue is open.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	QueueWaiter(void) :
+		waiters(0),
+		closed(false)
+	{
+	}
+
+
+	/*
+	 * void wake(void);
+	 *
+	 * Description:
+	 * Wake any thread sleeping in waitFor() after the queue state changed. The fence pairs with the one
+	 * in waitFor() so either the waker sees the sleeper's count, or the sleeper sees the new queue state.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void wake(void)
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (waiters.load(std::memory_order_relaxed) > 0)
+		{
+			std::lock_guard<std::mutex> lock(waitMutex);
+			waitCond.notify_all();
+		}
+	}
+
+
+	/*
+	 * template <typename Pred> bool waitFor(Pred ready, std::chrono::milliseconds timeout);
+	 *
+	 * Description:
+	 * Sleep until ready() is true, shutdown() is called, or the timeout expires.
+	 *
+	 * Inputs:
+	 *		Pred ready                          condition to wait for
+	 *		std::chrono::milliseconds timeout   maximum time to sleep
+	 *
+	 * Outputs:
+	 *		bool (return val)                   true if ready() is true and the queue is not shut down
+	 */
+	template <typename Pred>
+	bool waitFor(Pred ready, std::chrono::milliseconds timeout)
+	{
+		std::unique_lock<std::mutex> lock(waitMutex);
+		waiters.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		bool sts = waitCond.wait_for(lock, timeout, [&]() { return closed.load(std::memory_order_relaxed) || ready(); });
+
+		waiters.fetch_sub(1, std::memory_order_relaxed);
+		return sts && !closed.load(std::memory_order_relaxed);
+	}
+
+
+	/*
+	 * void shutdown(void);
+	 *
+	 * Description:
+	 * Wake every sleeping thread and make isShutdown() true until reopen().
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void shutdown(void)
+	{
+		std::lock_guard<std::mutex> lock(waitMutex);
+		closed.store(true, std::memory_order_relaxed);
+		waitCond.notify_all();
+	}
+
+
+	/*
+	 * bool isShutdown(void) const;
+	 *
+	 * Description:
+	 * Check if shutdown() has been called since construction or the last reopen().
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		bool (return val)    true if shut down
+	 */
+	bool isShutdown(void) const
+	{
+		return closed.load(std::memory_order_relaxed);
+	}
+
+
+	/*
+	 * void reopen(void);
+	 *
+	 * Description:
+	 * Clear the shutdown flag.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void reopen(void)
+	{
+		std::lock_guard<std::mutex> lock(waitMutex);
+		closed.store(false, std::memory_order_relaxed);
+	}
+};
+
+
+/*
+ * enum OverflowPolicy
+ *
+ * Description:
+ * What enQueue()/push() do when the queue is full.
+ *
+ */
+enum OverflowPolicy
+{
+	OVERFLOW_BLOCK,			// refuse the new item (push() sleeps until there is room). The default.
+	OVERFLOW_DROP_NEWEST,	// discard the new item
+	OVERFLOW_DROP_OLDEST,	// discard the oldest queued item to make room
+	OVERFLOW_LATEST_ONLY	// discard everything queued, the consumer only ever sees the newest item
+};
+
+
+/*
+ * struct RingBufferStats
+ *
+ * Description:
+ * Counters for a RingBuffer. Each drop counter belongs to one overflow policy (or to the max age check),
+ * so the counters show what the policy cost in items.
+ *
+ */
+struct RingBufferStats
+{
+	unsigned long long enqueued;		// items placed in the queue
+	unsigned long long dequeued;		// items handed to the consumer
+	unsigned long long droppedNewest;	// new items discarded (OVERFLOW_DROP_NEWEST)
+	unsigned long long droppedOldest;	// queued items discarded to make room (OVERFLOW_DROP_OLDEST)
+	unsigned long long superseded;		// queued items discarded for a newer one (OVERFLOW_LATEST_ONLY)
+	unsigned long long expired;			// items older than the max age, discarded at dequeue
+};
+
+
+/*
+ * struct RingBufferTraits
+ *
+ * Description:
+ * Describes how an item is moved in to and out of a ring buffer slot, and how a discarded item is released.
+ * The default is a move, so handle types (e.g. cv::Mat) pass through the queue without copying their data and
+ * the slot does not keep the item alive after it is removed. Note that after a successful enQueue the producer's
+ * item is left empty. Discarded items are released in place (the default assigns a default constructed T), so
+ * dropping one never moves it anywhere. Types that need something else (e.g. a deep copy, or a release that
+ * doesn't construct a new T) specialize this struct next to the type definition.
+ *
+ */
+template <typename T>
+struct RingBufferTraits
+{
+	static void enQueue(T& item, T& slot) { slot = std::move(item); }
+	static void deQueue(T& slot, T& item) { item = std::move(slot); }
+	static void release(T& item) { item = T(); }
+};
+
+
+/*
+ * class RingBuffer
+ *
+ * Description:
+ * Lock-free circular queue holding up to Capacity items, for one producer thread and one consumer thread.
+ * Capacity must be a power of two so the monotonically increasing head/tail counters can be mapped to a slot
+ * with a mask instead of a modulo.
+ *
+ * Every slot carries a sequence number (the position it was last written/released for). The consumer claims
+ * the oldest item by advancing head with a compare-and-swap and releases the slot by bumping its sequence, so
+ * the producer may also claim from the head end - that is how it discards the oldest items under
+ * OVERFLOW_DROP_OLDEST/OVERFLOW_LATEST_ONLY without locking out the consumer.
+ *
+ * Initialization Ex.:
+ * RingBuffer<cv::Mat, 64> qFrame;
+ * qFrame.setOverflowPolicy(OVERFLOW_LATEST_ONLY, std::chrono::milliseconds(200));
+ *
+ */
+template <typename T, size_t Capacity>
+class RingBuffer
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "RingBuffer Capacity must be a power of two");
+
+	/********** Private Members **********/
+	struct ringSlot
+	{
+		std::atomic<size_t> seq;						// == position: free for the producer, == position + 1: holds an item
+		T item;
+		std::chrono::steady_clock::time_point stamp;	// when the item was queued (for the max age check)
+	};
+
+	// Consumer end. head = position of the oldest item. Also advanced by the producer when it drops items.
+	alignas(RING_BUFFER_CACHE_LINE) std::atomic<size_t> head;
+
+	// Producer owned line. tail = position of the next free slot.
+	alignas(RING_BUFFER_CACHE_LINE) std::atomic<size_t> tail;
+
+	// Queue storage
+	alignas(RING_BUFFER_CACHE_LINE) std::array<ringSlot, Capacity> buffer;
+
+	// Overflow handling. Set before the producer/consumer threads start.
+	OverflowPolicy policy;
+	std::chrono::steady_clock::duration maxAge; // zero = items never expire
+
+	// Statistics. Each counter has a single writer (producer or consumer).
+	std::atomic<unsigned long long> enqueued;
+	std::atomic<unsigned long long> dequeued;
+	std::atomic<unsigned long long> droppedNewest;
+	std::atomic<unsigned long long> droppedOldest;
+	std::atomic<unsigned long long> superseded;
+	std::atomic<unsigned long long> expired;
+
+	// Sleep/wake support for the blocking push()/pop()
+	QueueWaiter waiter;
+
+
+	/*
+	 * bool claim(T* item, std::chrono::steady_clock::time_point& stamp);
+	 *
+	 * Description:
+	 * Take the oldest item out of the queue. Called by the consumer, and by the producer to discard items.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		T* item                                   removed item, or nullptr to release it in its slot
+	 *		std::chrono::steady_clock::time_point& stamp   when the item was queued
+	 *		bool (return val)                         false if the queue is empty
+	 */
+	bool claim(T* item, std::chrono::steady_clock::time_point& stamp)
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+
+		for (;;)
+		{
+			ringSlot& slot = buffer[h & (Capacity - 1)];
+			const size_t seq = slot.seq.load(std::memory_order_acquire);
+			const ptrdiff_t diff = (ptrdiff_t)(seq - (h + 1));
+
+			if (diff == 0)
+			{
+				// Slot holds the oldest item, try to take it (h is refreshed if the other side beat us to it)
+				if (head.compare_exchange_weak(h, h + 1, std::memory_order_relaxed))
+				{
+					if (item)
+						RingBufferTraits<T>::deQueue(slot.item, *item);
+					else
+						RingBufferTraits<T>::release(slot.item);
+					stamp = slot.stamp;
+					slot.seq.store(h + Capacity, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false; // nothing written here yet, queue is empty
+			}
+			else
+			{
+				h = head.load(std::memory_order_relaxed); // already taken, look again from the new head
+			}
+		}
+	}
+
+
+	/*
+	 * bool dropOldest(void);
+	 *
+	 * Description:
+	 * Discard the oldest queued item (the item is released immediately). Only call from the producer thread.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		bool (return val)    false if the queue was empty
+	 */
+	bool dropOldest(void)
+	{
+		std::chrono::steady_clock::time_point stamp;
+		return claim(nullptr, stamp);
+	}
+
+
+public:
+	/********** Public Members **********/
+
+	/*
+	 * RingBuffer(void)
+	 *
+	 * Description:
+	 * Constructor for queue. All slots are default constructed up front and reused. The queue starts with the
+	 * OVERFLOW_BLOCK policy and no max age.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	RingBuffer(void) :
+		head(0),
+		tail(0),
+		policy(OVERFLOW_BLOCK),
+		maxAge(std::chrono::steady_clock::duration::zero()),
+		enqueued(0),
+		dequeued(0),
+		droppedNewest(0),
+		droppedOldest(0),
+		superseded(0),
+		expired(0)
+	{
+		for (size_t i = 0; i < Capacity; i++)
+			buffer[i].seq.store(i, std::memory_order_relaxed);
+	}
+
+	// The queue is shared between threads by reference, never copied
+	RingBuffer(const RingBuffer&) = delete;
+	RingBuffer& operator=(const RingBuffer&) = delete;
+
+
+	/*
+	 * void setOverflowPolicy(OverflowPolicy newPolicy, std::chrono::milliseconds newMaxAge);
+	 *
+	 * Description:
+	 * Choose what happens when the queue is full, and optionally how old an item may get before the consumer
+	 * no longer wants it. Call before the producer/consumer threads start using the queue.
+	 *
+	 * Inputs:
+	 *		OverflowPolicy newPolicy                overflow policy (see OverflowPolicy)
+	 *		std::chrono::milliseconds newMaxAge     items older than this are discarded at dequeue (0 = never)
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void setOverflowPolicy(OverflowPolicy newPolicy, std::chrono::milliseconds newMaxAge = std::chrono::milliseconds(0))
+	{
+		policy = newPolicy;
+		maxAge = newMaxAge;
+	}
+
+
+	/*
+	 * bool enQueue(T& item);
+	 *
+	 * Description:
+	 * Add an item to the queue. Only call from the producer thread. What happens when the queue is full
+	 * depends on the overflow policy: only OVERFLOW_BLOCK ever returns false, every other policy makes room
+	 * or discards the new item.
+	 *
+	 * Inputs:
+	 *		T& item              item to place into queue (left empty when true is returned)
+	 *
+	 * Outputs:
+	 *		bool (return val)    true if the queue took the item (queued, or discarded by OVERFLOW_DROP_NEWEST),
+	 *		                     false = queue full (OVERFLOW_BLOCK)
+	 */
+	bool enQueue(T& item)
+	{
+		const size_t t = tail.load(std::memory_order_relaxed);
+		ringSlot& slot = buffer[t & (Capacity - 1)];
+
+		// Latest only: everything still queued is stale now
+		if (policy == OVERFLOW_LATEST_ONLY)
+		{
+			while (dropOldest())
+				superseded.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		// The slot is free once the item Capacity positions back has been claimed and released
+		while (slot.seq.load(std::memory_order_acquire) != t)
+		{
+			switch (policy)
+			{
+			case OVERFLOW_BLOCK:
+				return false;
+
+			case OVERFLOW_DROP_NEWEST:
+				RingBufferTraits<T>::release(item);
+				droppedNewest.fetch_add(1, std::memory_order_relaxed);
+				return true;
+
+			case OVERFLOW_DROP_OLDEST:
+			case OVERFLOW_LATEST_ONLY:
+				// If the item in our slot was already claimed the consumer is part way through taking it and is
+				// about to free the slot, so wait for that instead of dropping a newer item
+				if (head.load(std::memory_order_acquire) + Capacity > t)
+					std::this_thread::yield();
+				else if (dropOldest())
+					(policy == OVERFLOW_DROP_OLDEST ? droppedOldest : superseded).fetch_add(1, std::memory_order_relaxed);
+				break;
+			}
+		}
+
+		RingBufferTraits<T>::enQueue(item, slot.item);
+		if (maxAge != std::chrono::steady_clock::duration::zero())
+			slot.stamp = std::chrono::steady_clock::now();
+		slot.seq.store(t + 1, std::memory_order_release);
+		tail.store(t + 1, std::memory_order_release);
+		enqueued.fetch_add(1, std::memory_order_relaxed);
+		waiter.wake();
+
+		return true;
+	}
+
+
+	/*
+	 * bool deQueue(T& item);
+	 *
+	 * Description:
+	 * Remove the oldest item from the queue. Only call from the consumer thread. If a max age is set,
+	 * items that waited longer than that are discarded and the next one is tried.
+	 *
+	 * Inputs:
+	 *		T& item              item to store removed queue item
+	 *
+	 * Outputs:
+	 *		bool (return val)    indicates success of removing from queue (false = queue empty)
+	 */
+	bool deQueue(T& item)
+	{
+		std::chrono::steady_clock::time_point stamp;
+		bool found = false;
+
+		while (!found && claim(&item, stamp))
+		{
+			if (maxAge != std::chrono::steady_clock::duration::zero() &&
+				std::chrono::steady_clock::now() - stamp > maxAge)
+			{
+				RingBufferTraits<T>::release(item); // release the stale item right away
+				expired.fetch_add(1, std::memory_order_relaxed);
+			}
+			else
+			{
+				found = true;
+			}
+		}
+
+		if (found)
+		{
+			dequeued.fetch_add(1, std::memory_order_relaxed);
+			waiter.wake();
+		}
+		return found;
+	}
+
+
+	/*
+	 * bool push(T& item, std::chrono::milliseconds timeout);
+	 *
+	 * Description:
+	 * Blocking version of enQueue. If the queue is full (OVERFLOW_BLOCK only) the producer sleeps until the
+	 * consumer frees a slot, the timeout expires, or the queue is shut down. Only call from the producer thread.
+	 *
+	 * Inputs:
+	 *		T& item                             item to place into queue
+	 *		std::chrono::milliseconds timeout   maximum time to wait for a free slot
+	 *
+	 * Outputs:
+	 *		bool (return val)                   indicates success of placing into queue (false = timeout or shut down)
+	 */
+	bool push(T& item, std::chrono::milliseconds timeout)
+	{
+		if (waiter.isShutdown())
+			return false;
+
+		if (enQueue(item))
+			return true;
+
+		if (!waiter.waitFor([this]() { return size() < Capacity; }, timeout))
+			return false;
+
+		return enQueue(item);
+	}
+
+
+	/*
+	 * bool pop(T& item, std::chrono::milliseconds timeout);
+	 *
+	 * Description:
+	 * Blocking version of deQueue. If the queue is empty the consumer sleeps until the producer adds
+	 * an item, the timeout expires, or the queue is shut down. Only call from the consumer thread.
+	 *
+	 * Inputs:
+	 *		T& item                             item to store removed queue item
+	 *		std::chrono::milliseconds timeout   maximum time to wait for an item
+	 *
+	 * Outputs:
+	 *		bool (return val)                   indicates success of removing from queue (false = timeout or shut down)
+	 */
+	bool pop(T& item, std::chrono::milliseconds timeout)
+	{
+		if (waiter.isShutdown())
+			return false;
+
+		if (deQueue(item))
+			return true;
+
+		if (!waiter.waitFor([this]() { return size() > 0; }, timeout))
+			return false;
+
+		return deQueue(item);
+	}
+
+
+	/*
+	 * void shutdown(void);
+	 *
+	 * Description:
+	 * Wake every thread sleeping in push()/pop() and make all further push()/pop() calls return false
+	 * immediately. Safe to call from any thread.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void shutdown(void)
+	{
+		waiter.shutdown();
+	}
+
+
+	/*
+	 * bool isShutdown(void) const;
+	 *
+	 * Description:
+	 * Check if shutdown() has been called since construction or the last reset().
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		bool (return val)    true if the queue is shut down
+	 */
+	bool isShutdown(void) const
+	{
+		return waiter.isShutdown();
+	}
+
+
+	/*
+	 * void reset(void);
+	 *
+	 * Description:
+	 * Discard (and release) everything in the queue, zero the statistics and clear the shutdown flag so it can
+	 * be used again. The overflow policy is kept. Only call when neither the producer nor the consumer thread
+	 * is using the queue (e.g. after joining them).
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		N/A
+	 */
+	void reset(void)
+	{
+		for (size_t i = 0; i < Capacity; i++)
+		{
+			RingBufferTraits<T>::release(buffer[i].item);
+			buffer[i].seq.store(i, std::memory_order_relaxed);
+		}
+		head.store(0, std::memory_order_relaxed);
+		tail.store(0, std::memory_order_relaxed);
+
+		enqueued.store(0, std::memory_order_relaxed);
+		dequeued.store(0, std::memory_order_relaxed);
+		droppedNewest.store(0, std::memory_order_relaxed);
+		droppedOldest.store(0, std::memory_order_relaxed);
+		superseded.store(0, std::memory_order_relaxed);
+		expired.store(0, std::memory_order_relaxed);
+
+		waiter.reopen();
+	}
+
+
+	/*
+	 * RingBufferStats getStats(void) const;
+	 *
+	 * Description:
+	 * Get a snapshot of the queue counters.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		RingBufferStats (return val)   queue counters
+	 */
+	RingBufferStats getStats(void) const
+	{
+		RingBufferStats stats;
+		stats.enqueued = enqueued.load(std::memory_order_relaxed);
+		stats.dequeued = dequeued.load(std::memory_order_relaxed);
+		stats.droppedNewest = droppedNewest.load(std::memory_order_relaxed);
+		stats.droppedOldest = droppedOldest.load(std::memory_order_relaxed);
+		stats.superseded = superseded.load(std::memory_order_relaxed);
+		stats.expired = expired.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+
+	/*
+	 * size_t size(void) const;
+	 *
+	 * Description:
+	 * Number of items currently in the queue. Only a snapshot when the other thread is active.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		size_t (return val)  items in queue
+	 */
+	size_t size(void) const
+	{
+		const size_t h = head.load(std::memory_order_acquire);
+		const size_t t = tail.load(std::memory_order_acquire);
+		return (t > h) ? t - h : 0; // head can briefly run past a stale tail read
+	}
+
+
+	/*
+	 * bool empty(void) const;
+	 *
+	 * Description:
+	 * Check if the queue is empty. Only a snapshot when the other thread is active.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		bool (return val)    true if there is nothing to remove
+	 */
+	bool empty(void) const
+	{
+		return size() == 0;
+	}
+
+
+	/*
+	 * static constexpr size_t capacity(void);
+	 *
+	 * Description:
+	 * Maximum number of items the queue can hold.
+	 *
+	 * Inputs:
+	 *		N/A
+	 *
+	 * Outputs:
+	 *		size_t (return val)  queue capacity
+	 */
+	static constexpr size_t capacity(void)
+	{
+		return Capacity;
+	}
+};
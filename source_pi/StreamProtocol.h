@@ -0,0 +1,173 @@
+/*
+ * Author:  Jordan Leiker
+ * Class: ECE6122
+ * Last Date Modified: 10/16/2026
+ *
+ * Description:
+ * This is the header for the framing used on the video stream between cameraServer (Raspberry Pi) and
+ * VideoCapturePi (client). After the client sends its cameraSettings, every frame the server sends is a
+ * frameHeader followed by exactly header.length bytes of payload (one encoded packet, or one raw BGR frame).
+ * In the other direction the client may send a controlMessage at any time after its cameraSettings, e.g. to ask
+ * for a keyframe when its decoder lost track of the stream.
+ *
+ * The receiver always knows how much to read, so it can hand whole packets to the decoder without a parser,
+ * notice dropped frames from gaps in the sequence number and measure latency from the capture timestamp.
+ *
+ * Both ends are little endian (x86-64 PC, ARM Pi), so the header is sent as-is, the same as cameraSettings.
+ *
+ */
+
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+#define STREAM_MAGIC 0x46495052u	// "RPIF"
+#define STREAM_VERSION 1
+
+// frameHeader flags
+#define STREAM_FLAG_KEY 0x00000001u	// payload is a keyframe (raw frames are always keyframes)
+
+#define CONTROL_MAGIC 0x4C525443u	// "CTRL"
+
+// controlMessage types
+#define CONTROL_KEYFRAME_REQUEST 1	// decoder error (missing reference frames), please send a keyframe
+
+
+/*
+ * struct frameHeader
+ *
+ * Description:
+ * Fixed size (32 byte) header sent in front of every frame.
+ *
+ */
+struct frameHeader
+{
+    uint32_t magic;			// STREAM_MAGIC, lets the receiver detect a stream that is out of sync
+    uint16_t version;		// STREAM_VERSION
+    uint16_t headerSize;	// sizeof(frameHeader)
+    uint32_t length;		// payload bytes following the header
+    uint32_t sequence;		// frame number, +1 per frame published; gaps are frames this client did not receive
+    int64_t captureUs;		// when the camera captured the frame (sender's system clock, us since epoch)
+    uint32_t codecId;		// AVCodecID of the payload (AV_CODEC_ID_RAWVIDEO for raw BGR24 frames)
+    uint32_t flags;			// STREAM_FLAG_* bits
+};
+static_assert(sizeof(frameHeader) == 32, "frameHeader must match the wire format");
+
+
+/*
+ * int64_t streamTimestampUs(void);
+ *
+ * Description:
+ * Wall clock time used for captureUs. Latency measured across two machines is only as good as their clock sync (NTP).
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		int64_t (return val)		microseconds since the epoch
+ */
+inline int64_t streamTimestampUs(void)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+
+/*
+ * void initFrameHeader(frameHeader& hdr, uint32_t length, uint32_t sequence, int64_t captureUs, uint32_t codecId, uint32_t flags);
+ *
+ * Description:
+ * Fill out a header for sending.
+ *
+ * Inputs:
+ *		uint32_t length				payload bytes
+ *		uint32_t sequence			frame number
+ *		int64_t captureUs			capture timestamp (see streamTimestampUs())
+ *		uint32_t codecId			AVCodecID of the payload
+ *		uint32_t flags				STREAM_FLAG_* bits
+ *
+ * Outputs:
+ *		frameHeader& hdr			header ready to send
+ */
+inline void initFrameHeader(frameHeader& hdr, uint32_t length, uint32_t sequence, int64_t captureUs, uint32_t codecId, uint32_t flags)
+{
+    hdr.magic = STREAM_MAGIC;
+    hdr.version = STREAM_VERSION;
+    hdr.headerSize = sizeof(frameHeader);
+    hdr.length = length;
+    hdr.sequence = sequence;
+    hdr.captureUs = captureUs;
+    hdr.codecId = codecId;
+    hdr.flags = flags;
+}
+
+
+/*
+ * bool checkFrameHeader(const frameHeader& hdr, uint32_t maxLength);
+ *
+ * Description:
+ * Sanity check a received header before trusting its length.
+ *
+ * Inputs:
+ *		const frameHeader& hdr		received header
+ *		uint32_t maxLength			largest payload the receiver accepts
+ *
+ * Outputs:
+ *		bool (return val)			true if the header is valid
+ */
+inline bool checkFrameHeader(const frameHeader& hdr, uint32_t maxLength)
+{
+    return hdr.magic == STREAM_MAGIC && hdr.version == STREAM_VERSION && hdr.headerSize == sizeof(frameHeader) &&
+        hdr.length <= maxLength;
+}
+
+
+/*
+ * struct controlMessage
+ *
+ * Description:
+ * Fixed size (8 byte) message from the client to the server.
+ *
+ */
+struct controlMessage
+{
+    uint32_t magic;			// CONTROL_MAGIC
+    uint32_t type;			// CONTROL_* message type
+};
+static_assert(sizeof(controlMessage) == 8, "controlMessage must match the wire format");
+
+
+/*
+ * void initControlMessage(controlMessage& msg, uint32_t type);
+ *
+ * Description:
+ * Fill out a control message for sending.
+ *
+ * Inputs:
+ *		uint32_t type				CONTROL_* message type
+ *
+ * Outputs:
+ *		controlMessage& msg			message ready to send
+ */
+inline void initControlMessage(controlMessage& msg, uint32_t type)
+{
+    msg.magic = CONTROL_MAGIC;
+    msg.type = type;
+}
+
+
+/*
+ * bool checkControlMessage(const controlMessage& msg);
+ *
+ * Description:
+ * Sanity check a received control message.
+ *
+ * Inputs:
+ *		const controlMessage& msg	received message
+ *
+ * Outputs:
+ *		bool (return val)			true if the message is valid
+ */
+inline bool checkControlMessage(const controlMessage& msg)
+{
+    return msg.magic == CONTROL_MAGIC;
+}
@@ -15,6 +15,338 @@
 #include "VideoCodec.h"
 
 
+/*
+ * bool encoderProfileFromName(const std::string& name, EncoderProfile& profile)
+ *
+ * Description:
+ * Look up an encoder profile by name ("latency", "balanced", "archive"). An empty name is "balanced".
+ *
+ * Inputs:
+ *		const std::string& name		profile name
+ *
+ * Outputs:
+ *		EncoderProfile& profile		the profile (unchanged if the name is unknown)
+ *		bool (return type)			false if the name is unknown
+ */
+bool encoderProfileFromName(const std::string& name, EncoderProfile& profile)
+{
+    if (name == "latency")
+        profile = ENCODER_PROFILE_LATENCY;
+    else if (name == "balanced" || name.empty())
+        profile = ENCODER_PROFILE_BALANCED;
+    else if (name == "archive")
+        profile = ENCODER_PROFILE_ARCHIVE;
+    else
+        return false;
+
+    return true;
+}
+
+
+/*
+ * bool codecThreadingFromName(const std::string& name, CodecThreading& threading)
+ *
+ * Description:
+ * Look up a threading policy by name ("auto", "frame", "frame:N", "slice", "slice:N"). An empty name is "auto".
+ *
+ * Inputs:
+ *		const std::string& name		policy name
+ *
+ * Outputs:
+ *		CodecThreading& threading	the policy (unchanged if the name is not valid)
+ *		bool (return type)			false if the name is not valid
+ */
+bool codecThreadingFromName(const std::string& name, CodecThreading& threading)
+{
+    if (name == "auto" || name.empty())
+    {
+        threading.type = CODEC_THREADS_AUTO;
+        threading.count = 0;
+        return true;
+    }
+
+    CodecThreading parsed;
+    std::string type = name.substr(0, name.find(':'));
+    if (type == "frame")
+        parsed.type = CODEC_THREADS_FRAME;
+    else if (type == "slice")
+        parsed.type = CODEC_THREADS_SLICE;
+    else
+        return false;
+
+    if (type.length() < name.length())
+    {
+        const char* count = name.c_str() + type.length() + 1;
+        char* end;
+        long n = strtol(count, &end, 10);
+        if (end == count || *end != '\0' || n < 1 || n > 64)
+            return false;
+        parsed.count = (int)n;
+    }
+
+    threading = parsed;
+    return true;
+}
+
+
+/*
+ * std::string codecThreadingName(const CodecThreading& threading)
+ *
+ * Description:
+ * Name of a threading policy, the inverse of codecThreadingFromName().
+ *
+ * Inputs:
+ *		const CodecThreading& threading	the policy
+ *
+ * Outputs:
+ *		std::string (return type)	policy name
+ */
+std::string codecThreadingName(const CodecThreading& threading)
+{
+    if (threading.type == CODEC_THREADS_AUTO)
+        return "auto";
+
+    std::string name = (threading.type == CODEC_THREADS_FRAME) ? "frame" : "slice";
+    if (threading.count > 0)
+        name += ":" + std::to_string(threading.count);
+    return name;
+}
+
+
+/*
+ * void printThreadStats(const std::string& name, const CodecThreadStats& stats)
+ *
+ * Description:
+ * Print a one line summary of a codec's threading statistics to stdout, e.g. when a session ends.
+ *
+ * Inputs:
+ *		const std::string& name		which codec ("Encoder", "Decoder")
+ *		const CodecThreadStats& stats	statistics from VideoCodec::getThreadStats()
+ *
+ * Outputs:
+ *		N/A
+ */
+void printThreadStats(const std::string& name, const CodecThreadStats& stats)
+{
+    if (!stats.frames)
+        return;
+
+    std::cout << name << " threads: " << stats.threadType << " x";
+    if (stats.threadCount)
+        std::cout << stats.threadCount;
+    else
+        std::cout << "auto";
+    std::cout << ", delay " << stats.avgDelay << " frames avg / " << stats.maxDelay << " max (codec reports "
+        << stats.reportedDelay << "), " << stats.usPerFrame << " us/frame in the codec";
+    if (stats.usPerFrame > 0)
+        std::cout << " (" << int(1e6 / stats.usPerFrame) << " fps max)";
+    std::cout << std::endl;
+}
+
+
+/*
+ * void applyThreading(void)
+ *
+ * Description:
+ * Set ctx's thread count/type from the threading policy. Must be called before ctx is opened.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		N/A
+ */
+void VideoCodec::applyThreading(void)
+{
+    // libavcodec falls back to the other type (or one thread) if the codec can't do the one asked for. libx264
+    // threads itself: a thread_type of exactly FF_THREAD_SLICE gives it sliced threads, anything else frame threads.
+    switch (threading.type)
+    {
+    case CODEC_THREADS_FRAME:
+        ctx->thread_type = FF_THREAD_FRAME;
+        break;
+    case CODEC_THREADS_SLICE:
+        ctx->thread_type = FF_THREAD_SLICE;
+        break;
+    case CODEC_THREADS_AUTO:
+    default:
+        ctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+        break;
+    }
+    ctx->thread_count = threading.count;
+}
+
+
+/*
+ * void codecInput(int64_t pts)
+ *
+ * Description:
+ * Record a frame/packet going in to the codec, for the delay statistics.
+ *
+ * Inputs:
+ *		int64_t pts					pts of the frame/packet
+ *
+ * Outputs:
+ *		N/A
+ */
+void VideoCodec::codecInput(int64_t pts)
+{
+    ptsHistory[framesIn % CODEC_PTS_HISTORY] = pts;
+    framesIn++;
+}
+
+
+/*
+ * void codecOutput(int64_t pts)
+ *
+ * Description:
+ * Record a packet/frame coming out of the codec. Its delay is the number of inputs that went in after the one
+ * with the same pts. Outputs without a pts, or whose input is older than the last CODEC_PTS_HISTORY, are only
+ * counted.
+ *
+ * Inputs:
+ *		int64_t pts					pts of the packet/frame
+ *
+ * Outputs:
+ *		N/A
+ */
+void VideoCodec::codecOutput(int64_t pts)
+{
+    framesOut++;
+    if (pts == AV_NOPTS_VALUE)
+        return;
+
+    unsigned long long history = std::min<unsigned long long>(framesIn, CODEC_PTS_HISTORY);
+    for (unsigned long long back = 0; back < history; back++)
+    {
+        if (ptsHistory[(framesIn - 1 - back) % CODEC_PTS_HISTORY] == pts)
+        {
+            delaySamples++;
+            delaySum += back;
+            maxDelay = std::max(maxDelay, (int)back);
+            return;
+        }
+    }
+}
+
+
+/*
+ * CodecThreadStats getThreadStats(void) const;
+ *
+ * Description:
+ * (Public member function)
+ * Threads the codec is really using (libavcodec may use fewer than asked for, or fall back to the other
+ * threading type), the delay that costs and how long the codec takes per frame, so threading policies can be
+ * compared on the machine they will run on.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		CodecThreadStats (return val)	threading statistics so far
+ */
+CodecThreadStats VideoCodec::getThreadStats(void) const
+{
+    CodecThreadStats stats;
+
+    // Codecs that thread themselves (libx264) leave active_thread_type at 0, see applyThreading() for what they do
+    if (ctx->active_thread_type & FF_THREAD_FRAME)
+        stats.threadType = "frame";
+    else if (ctx->active_thread_type & FF_THREAD_SLICE)
+        stats.threadType = "slice";
+    else if ((codec->capabilities & AV_CODEC_CAP_AUTO_THREADS) && ctx->thread_count != 1)
+        stats.threadType = (ctx->thread_type == FF_THREAD_SLICE) ? "slice" : "frame";
+    else
+        stats.threadType = "none";
+
+    stats.threadCount = ctx->thread_count;
+    stats.reportedDelay = ctx->delay;
+    stats.avgDelay = delaySamples ? double(delaySum) / delaySamples : 0.0;
+    stats.maxDelay = maxDelay;
+    stats.frames = framesOut;
+    stats.usPerFrame = framesOut ? codecNs / 1000.0 / framesOut : 0.0;
+    return stats;
+}
+
+
+/*
+ * void openContext(int64_t targetBitRate)
+ *
+ * Description:
+ * Allocate, fill out (from the codec, size, fps and profile) and open the encoder context.
+ *
+ * Inputs:
+ *		int64_t targetBitRate		bit rate (bits/s)
+ *
+ * Outputs:
+ *		N/A
+ */
+void Encoder::openContext(int64_t targetBitRate)
+{
+    ctx = avcodec_alloc_context3(codec);
+    if (!ctx) 
+    {
+        std::cerr << "ERR - Could not allocate video codec context" << std::endl;
+        exit(1);
+    }
+
+    ctx->bit_rate = targetBitRate;
+    ctx->width = width;
+    ctx->height = height;
+    ctx->time_base = AVRational({ 1, fps });
+    ctx->framerate = AVRational({ fps, 1 });
+    /* GOP and B-frames come from the profile (see EncoderProfile).
+     * If frame->pict_type is AV_PICTURE_TYPE_I (requestKeyframe())
+     * then gop_size is ignored and the output of encoder
+     * will always be I frame irrespective to gop_size
+     */
+    const char* preset;
+    switch (encProfile)
+    {
+    case ENCODER_PROFILE_LATENCY:
+        // libx264 refreshes with intra-refresh and changes bit rate on the fly, so its GOP is only a backstop and
+        // keyframes come from requestKeyframe(). The other encoders only change bit rate on a keyframe (see
+        // setBitRate()), so keep their GOP short enough for the rate control.
+        ctx->gop_size = bitRateIsLive() ? 10 * fps : fps;
+        ctx->max_b_frames = 0;
+        preset = "ultrafast";
+        break;
+    case ENCODER_PROFILE_ARCHIVE:
+        ctx->gop_size = 5 * fps;
+        ctx->max_b_frames = 2;
+        preset = "slow";
+        break;
+    case ENCODER_PROFILE_BALANCED:
+    default:
+        ctx->gop_size = 2 * fps;
+        ctx->max_b_frames = 0;
+        preset = "veryfast";
+        break;
+    }
+    ctx->pix_fmt = codecFormat;
+    applyThreading();
+
+    if (codec->id == AV_CODEC_ID_H264) 
+    {
+        av_opt_set(ctx->priv_data, "preset", preset, 0);
+        if (encProfile == ENCODER_PROFILE_LATENCY)
+        {
+            // No lookahead/frame threading delay, and refresh the picture a column at a time instead of with
+            // I-frames so the bitrate stays flat
+            av_opt_set(ctx->priv_data, "tune", "zerolatency", 0);
+            av_opt_set(ctx->priv_data, "intra-refresh", "1", 0);
+        }
+        av_opt_set(ctx->priv_data, "forced-idr", "1", 0); // requested keyframes must be IDR so a new client can start on them
+    }
+    int ret = avcodec_open2(ctx, codec, NULL);
+    if (ret < 0) 
+    {
+        std::cerr << "ERR - Could not open codec" << std::endl;
+        exit(1);
+    }
+}
+
+
 /*
  * void convertFrame_CV2AV(cv::Mat& frameCV, AVFrame* frameAV)
  *
@@ -37,6 +369,19 @@ void Encoder::convertFrame_CV2AV(cv::Mat& frameCV, AVFrame* frameAV)
 
     frameAV->pts = frameIdx++;
 
+    // Force an intra frame if one was requested, otherwise let the encoder follow its GOP. Either way, count the
+    // frames going in to the GOP: with B-frames the packets coming out lag behind by the reorder delay.
+    frameAV->pict_type = keyframeRequested.exchange(false) ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+    if (frameAV->pict_type == AV_PICTURE_TYPE_I || framesInGop >= ctx->gop_size)
+        framesInGop = 0;
+    framesInGop++;
+
+    if (colorKernels && frameCV.type() == CV_8UC3)
+    {
+        bgr24ToYuv420p(frameCV.data, frameCV.step[0], frameAV->data, frameAV->linesize, frameCV.rows, frameCV.cols);
+        return;
+    }
+
     const int stride[] = { static_cast<int>(frameCV.step[0]) };
     sws_scale(swsCtx, &frameCV.data, stride, 0, frameCV.rows, frameAV->data, frameAV->linesize);
 }
@@ -57,6 +402,8 @@ void Encoder::convertFrame_CV2AV(cv::Mat& frameCV, AVFrame* frameAV)
  */
 bool Encoder::encodeFrame(AVFrame* frameAV, AVPacket* pktAV)
 {   
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
     // Send frame to encoder
     int ret = avcodec_send_frame(ctx, frameAV);
     if (ret < 0) 
@@ -64,21 +411,65 @@ bool Encoder::encodeFrame(AVFrame* frameAV, AVPacket* pktAV)
         std::cerr << "Error sending a frame for encoding" << std::endl;
         exit(1);
     }
+    if (frameAV)
+        codecInput(frameAV->pts);
+
+    codecNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    // Get encoded packet back from encoder. With frame threads (or B-frames) the first few frames only fill the
+    // pipeline and don't give a packet yet.
+    return receivePacket(pktAV);
+}
+
 
-    // Get encoded packet back from encoder
-    while (ret >= 0) 
+/*
+ * bool receivePacket(AVPacket* pktAV)
+ *
+ * Description:
+ * Get another packet that is ready, without sending a frame in. The context a bit rate reopen replaced (drainCtx)
+ * is emptied first and freed once it is done, then packets come from the current context.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		AVPacket* pktAV				Encoded FFMPEG Video packet
+ *		bool (return type)			indicates pktAV is valid (false once there is nothing left to get)
+ */
+bool Encoder::receivePacket(AVPacket* pktAV)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    int ret = AVERROR(EAGAIN);
+    if (drainCtx)
     {
-        ret = avcodec_receive_packet(ctx, pktAV);
-        if (ret == 0)
-            return true; //packet received, move on
-        else if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
-            return false; // nothing to receive, move on
-        else if (ret < 0) 
+        // drainCtx has been sent the end of stream, so it gives packets until it is empty and then EOF
+        ret = avcodec_receive_packet(drainCtx, pktAV);
+        if (ret == AVERROR_EOF)
+            avcodec_free_context(&drainCtx);
+        else if (ret < 0)
         {
-            std::cerr << "Error during encoding" << std::endl;
+            std::cerr << "Error flushing the encoder" << std::endl;
             exit(1);
         }
     }
+    if (!drainCtx)
+        ret = avcodec_receive_packet(ctx, pktAV);
+
+    bool gotPacket = false;
+    if (ret == 0)
+    {
+        gotPacket = true; //packet received, move on
+        codecOutput(pktAV->pts);
+    }
+    else if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+    {
+        std::cerr << "Error during encoding" << std::endl;
+        exit(1);
+    }
+
+    codecNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    return gotPacket;
 }
 
 
@@ -98,11 +489,102 @@ bool Encoder::encodeFrame(AVFrame* frameAV, AVPacket* pktAV)
  */
 bool Encoder::encode(cv::Mat& frameCV, AVPacket* pktAV)
 {
+    int64_t newBitRate = bitRateRequested;
+    if (newBitRate > 0)
+    {
+        if (newBitRate == ctx->bit_rate)
+        {
+            bitRateRequested.compare_exchange_strong(newBitRate, 0);
+        }
+        else if (bitRateIsLive())
+        {
+            // libx264 compares the context's bit rate with its own before every frame and reconfigures itself
+            ctx->bit_rate = newBitRate;
+            bitRateRequested.compare_exchange_strong(newBitRate, 0);
+        }
+        else if (!drainCtx && (keyframeRequested || framesInGop >= ctx->gop_size))
+        {
+            // The mpeg encoders copy the bit rate in at open, so start over with a new context. It begins on a
+            // keyframe, but this frame was going to be one anyway. (A rate set meanwhile stays for the next GOP.)
+            // The old context may still hold frames (B-frames): flush it, receivePacket() hands out what is left
+            // in it before anything from the new one.
+            if (avcodec_send_frame(ctx, NULL) < 0)
+            {
+                std::cerr << "Error flushing the encoder" << std::endl;
+                exit(1);
+            }
+            drainCtx = ctx;
+            openContext(newBitRate);
+            framesInGop = 0;
+            bitRateRequested.compare_exchange_strong(newBitRate, 0);
+        }
+    }
+
     convertFrame_CV2AV(frameCV, frame);
     return encodeFrame(frame, pktAV);
 }
 
 
+/*
+ * void requestKeyframe(void)
+ *
+ * Description:
+ * Make the next frame passed to encode() an intra (key) frame, instead of waiting for the next one in the GOP.
+ * Safe to call from any thread.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		N/A
+ */
+void Encoder::requestKeyframe(void)
+{
+    keyframeRequested = true;
+}
+
+
+/*
+ * void setBitRate(int64_t targetBitRate)
+ *
+ * Description:
+ * Change the target bit rate. libx264 picks the new rate up on the fly, from the next frame passed to encode().
+ * Other encoders only read it when they are opened, so their context is reopened, and a new context starts on a
+ * keyframe. So that this never adds a keyframe, the reopen waits for the next one the stream has anyway (the GOP
+ * boundary, or a requestKeyframe()). Calls in between only replace the rate it will reopen with, so there is at
+ * most one reopen per GOP. Safe to call from any thread.
+ *
+ * Inputs:
+ *		int64_t targetBitRate		bit rate (bits/s)
+ *
+ * Outputs:
+ *		N/A
+ */
+void Encoder::setBitRate(int64_t targetBitRate)
+{
+    bitRate = targetBitRate;
+    bitRateRequested = targetBitRate;
+}
+
+
+/*
+ * bool bitRateIsLive(void) const
+ *
+ * Description:
+ * Whether setBitRate() takes effect on the next frame (libx264), rather than at the next keyframe.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		bool (return type)			true if the encoder changes its bit rate on the fly
+ */
+bool Encoder::bitRateIsLive(void) const
+{
+    return strcmp(codec->name, "libx264") == 0;
+}
+
+
 /*
  * void convertFrame_AV2CV(AVFrame* frameAV, cv::Mat& frameCV);
  *
@@ -117,10 +599,19 @@ bool Encoder::encode(cv::Mat& frameCV, AVPacket* pktAV)
  */
 void Decoder::convertFrame_AV2CV(AVFrame* frameAV, cv::Mat& frameCV)
 {
-    // Use the internal Decoder member 'frame' as an intermediary for conversion
-    sws_scale(swsCtx, frameAV->data, frameAV->linesize, 0, tmpFrame->height, tmpFrame->data, tmpFrame->linesize);
-    cv::Mat image(height, width, CV_8UC3, tmpFrame->data[0], tmpFrame->linesize[0]);
-    frameCV = image;
+    // The decoders used here output planar YUV, so plane 0 already is the 8 bit luma image. The Mat keeps its own
+    // reference to the frame, so the decoder moves on to a new buffer rather than overwrite this one.
+    if (outputMode == DECODER_OUTPUT_LUMA)
+    {
+        if (!avFrameToMat(frameAV, 0, height, width, CV_8UC1, frameCV))
+        {
+            releaseIfShared(frameCV);
+            cv::Mat(height, width, CV_8UC1, frameAV->data[0], frameAV->linesize[0]).copyTo(frameCV);
+        }
+        return;
+    }
+
+    scaleToBGR(frameAV, frameCV);
 }
 
 
@@ -163,20 +654,27 @@ bool Decoder::decodePacket(AVPacket* pktAV, AVFrame* frameAV)
         // If parsed packet is not empty, send to decoder
         if (pkt->size)
         {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
             ret = avcodec_send_packet(ctx, pkt);
             if (ret < 0)
             {
                 std::cerr << "Error sending a packet for decoding" << std::endl;
                 exit(1);
             }
+            codecInput(AV_NOPTS_VALUE); // the parser path has no pts, only counts and time are recorded
 
             av_packet_unref(pkt); // done with this packet, free it
 
             while (ret >= 0)
             {
                 ret = avcodec_receive_frame(ctx, frameAV);
+                codecNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+                start = std::chrono::steady_clock::now();
                 if (ret == 0)
+                {
+                    codecOutput(AV_NOPTS_VALUE);
                     return true; //frame received, move on
+                }
                 else if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
                     break; // no frames in parsed packet, so parse some more
                 else if (ret < 0) {
@@ -212,6 +710,7 @@ bool Decoder::decode(AVPacket* pktAV, cv::Mat& frameCV)
     if (decodePacket(pktAV, frame))
     {
         convertFrame_AV2CV(frame, frameCV);	
+        frameReady = true;
         return true;
     }
     else
@@ -219,3 +718,250 @@ bool Decoder::decode(AVPacket* pktAV, cv::Mat& frameCV)
         return false;
     }
 }
+
+
+/*
+ * bool decodeFramed(AVPacket* pktAV, cv::Mat& frameCV)
+ *
+ * Description:
+ * Decode one complete encoded packet (e.g. one frame from the framed stream, see StreamProtocol.h) and get an
+ * OpenCV Mat. Unlike decode() this skips the parser, the caller already knows where the packet ends.
+ * A packet may not produce a frame right away (codec delay), false is returned until one comes out.
+ *
+ * Inputs:
+ *      AVPacket* pktAV				One complete encoded FFMPEG Video packet
+ *
+ * Outputs:
+ *		cv::Mat& frameCV			OpencV Video Frame
+ *		bool (return type)			indicates frameCV is valid
+ */
+bool Decoder::decodeFramed(AVPacket* pktAV, cv::Mat& frameCV)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // A bad packet only costs us that frame, so report it and carry on rather than exiting
+    int ret = avcodec_send_packet(ctx, pktAV);
+    if (ret == AVERROR(EAGAIN))
+    {
+        // The decoder still has a frame from an earlier packet waiting. Take it out of the way and resend.
+        av_frame_unref(frame);
+        if (avcodec_receive_frame(ctx, frame) == 0)
+        {
+            std::cerr << "Decoder backed up, dropped a frame" << std::endl;
+            codecOutput(frame->best_effort_timestamp);
+        }
+        ret = avcodec_send_packet(ctx, pktAV);
+    }
+    if (ret < 0)
+    {
+        std::cerr << "Error sending a packet for decoding" << std::endl;
+        errorCount++;
+        return false;
+    }
+    codecInput(pktAV->pts);
+
+    // With frame threads the first few packets only fill the pipeline and don't give a frame yet
+    ret = avcodec_receive_frame(ctx, frame);
+    codecNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    if (ret == 0)
+    {
+        codecOutput(frame->best_effort_timestamp);
+        // Damaged frames still come out (concealed), but the caller should know the picture is not right
+        if (frame->decode_error_flags || (frame->flags & AV_FRAME_FLAG_CORRUPT))
+            errorCount++;
+        lastPts = frame->best_effort_timestamp;
+        convertFrame_AV2CV(frame, frameCV);
+        frameReady = true;
+        return true;
+    }
+    else if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+    {
+        std::cerr << "Error during decoding" << std::endl;
+        errorCount++;
+    }
+
+    return false;
+}
+
+
+/*
+ * bool retrieveBGR(cv::Mat& frameCV)
+ *
+ * Description:
+ * Convert the last decoded frame to BGR24, for the consumers that need color (display, recording) when the
+ * decoder is outputting luma. The frame is converted into frameCV's own buffer (reused if frameCV is its only
+ * owner, e.g. a buffer just taken from a FramePool, see releaseIfShared()), so it stays valid after the next
+ * decode and can be kept or queued without a copy.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		cv::Mat& frameCV			BGR24 video frame
+ *		bool (return type)			false if no frame has been decoded yet
+ */
+bool Decoder::retrieveBGR(cv::Mat& frameCV)
+{
+    // The rescaler was set up for codecFormat, anything else can't be converted
+    if (!frameReady || !frame->data[0] || frame->format != codecFormat)
+        return false;
+
+    scaleToBGR(frame, frameCV);
+    return true;
+}
+
+
+/*
+ * void scaleToBGR(AVFrame* frameAV, cv::Mat& frameCV)
+ *
+ * Description:
+ * Convert a decoded frame to BGR24 straight into frameCV, with the ColorConvert kernels for limited range
+ * YUV420P and sws_scale for anything else. frameCV's buffer is reused if it is the right size and frameCV is its
+ * only owner, otherwise frameCV gets a new one (see releaseIfShared()).
+ *
+ * Inputs:
+ *		AVFrame* frameAV			decoded FFMPEG Video Frame (codecFormat)
+ *
+ * Outputs:
+ *		cv::Mat& frameCV			BGR24 video frame
+ */
+void Decoder::scaleToBGR(AVFrame* frameAV, cv::Mat& frameCV)
+{
+    releaseIfShared(frameCV);
+    frameCV.create(height, width, CV_8UC3);
+
+    // A full range (JPEG) stream needs a different matrix, leave that to sws_scale
+    if (colorKernels && frameAV->format == AV_PIX_FMT_YUV420P && frameAV->color_range != AVCOL_RANGE_JPEG &&
+        frameAV->width == width && frameAV->height == height)
+    {
+        yuv420pToBgr24(frameAV->data, frameAV->linesize, frameCV.data, frameCV.step[0], height, width);
+        return;
+    }
+
+    // sws_scale looks at 4 planes even for packed output
+    uint8_t* dst[4] = { frameCV.data, NULL, NULL, NULL };
+    int dstStride[4] = { static_cast<int>(frameCV.step[0]), 0, 0, 0 };
+    sws_scale(swsCtx, frameAV->data, frameAV->linesize, 0, height, dst, dstStride);
+}
+
+
+/*
+ * cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const;
+ *
+ * Description:
+ * (cv::MatAllocator interface)
+ * Not used: avFrameToMat() only puts this allocator on the buffer descriptor, not on the Mat, so create() on an
+ * AVFrame backed Mat goes to OpenCV's default allocator. Passed on to that allocator in case it is ever called.
+ *
+ * Inputs:
+ *		int dims					number of dimensions
+ *		const int* sizes			size of each dimension
+ *		int type					OpenCV element type
+ *		void* data					user supplied memory (or NULL)
+ *		cv::AccessFlag flags		access flags
+ *		cv::UMatUsageFlags usageFlags   usage flags
+ *
+ * Outputs:
+ *		size_t* step				bytes per step of each dimension
+ *		cv::UMatData* (return val)	OpenCV buffer descriptor
+ */
+cv::UMatData* AVFrameAllocator::allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                                         cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const
+{
+    return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+}
+
+
+/*
+ * bool allocate(cv::UMatData* data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const;
+ *
+ * Description:
+ * (cv::MatAllocator interface)
+ * Only used for OpenCL UMat's, host memory is always already allocated.
+ *
+ * Inputs:
+ *		cv::UMatData* data			OpenCV buffer descriptor
+ *
+ * Outputs:
+ *		bool (return val)			true if data is valid
+ */
+bool AVFrameAllocator::allocate(cv::UMatData* data, cv::AccessFlag /*accessFlags*/, cv::UMatUsageFlags /*usageFlags*/) const
+{
+    return data != NULL;
+}
+
+
+/*
+ * void deallocate(cv::UMatData* data) const;
+ *
+ * Description:
+ * (cv::MatAllocator interface)
+ * The last Mat viewing the frame is gone, drop our reference to it (its buffer goes back to FFMPEG).
+ *
+ * Inputs:
+ *		cv::UMatData* data			OpenCV buffer descriptor
+ *
+ * Outputs:
+ *		N/A
+ */
+void AVFrameAllocator::deallocate(cv::UMatData* data) const
+{
+    if (!data)
+        return;
+
+    CV_Assert(data->urefcount == 0);
+    CV_Assert(data->refcount == 0);
+
+    AVFrame* frameAV = (AVFrame*)data->userdata;
+    av_frame_free(&frameAV);
+
+    data->data = data->origdata = 0;
+    data->userdata = 0;
+    delete data;
+}
+
+
+/*
+ * bool avFrameToMat(const AVFrame* frameAV, int plane, int rows, int cols, int type, cv::Mat& frameCV)
+ *
+ * Description:
+ * Point frameCV at one plane of frameAV without copying. frameCV takes its own reference to the frame (see
+ * AVFrameAllocator), so it stays valid after frameAV is unreferenced or reused.
+ *
+ * Inputs:
+ *		const AVFrame* frameAV		reference counted FFMPEG frame (e.g. from avcodec_receive_frame())
+ *		int plane					plane to wrap (0 = luma for planar YUV)
+ *		int rows					plane height
+ *		int cols					plane width (pixels)
+ *		int type					OpenCV type of the plane's pixels (e.g. CV_8UC1)
+ *
+ * Outputs:
+ *		cv::Mat& frameCV			Mat viewing the plane
+ *		bool (return type)			false if the frame could not be referenced (frameCV is left alone)
+ */
+bool avFrameToMat(const AVFrame* frameAV, int plane, int rows, int cols, int type, cv::Mat& frameCV)
+{
+    // Never freed: Mats it hands out may be released at any time, including during static destruction
+    static const AVFrameAllocator* allocator = new AVFrameAllocator;
+
+    // Only reference counted frames can be held on to (av_frame_clone() would copy anything else)
+    if (!frameAV->buf[0])
+        return false;
+
+    AVFrame* ref = av_frame_clone(frameAV);
+    if (!ref)
+        return false;
+
+    // A Mat over the plane's memory, then hand it a buffer descriptor that owns the reference. Copies of the Mat
+    // share the descriptor, the last one to go calls AVFrameAllocator::deallocate().
+    cv::Mat view(rows, cols, type, ref->data[plane], ref->linesize[plane]);
+    cv::UMatData* u = new cv::UMatData(allocator);
+    u->data = u->origdata = ref->data[plane];
+    u->size = (size_t)ref->linesize[plane] * rows;
+    u->userdata = ref;
+    u->refcount = 1;
+    view.u = u;
+
+    frameCV = view;
+    return true;
+}
@@ -9,14 +9,33 @@
  * is an expectation that the client send a "camera configuration packet" that allows this server application
  * to set up the camera height/width/fps and optionally a codec for compression of frames.
  * 
- * This program sits in an infinite loop waiting for clients to connect, configure, and stream. If a client 
- * disconnects this program waits for the next client and will reconfingure the camera every time. Each time a 
- * client disconnects this program cleans up, meaning that sometimes clients can use decide to use the CODEC 
- * and sometimes not. 
+ * This program sits in an infinite loop waiting for clients to connect, configure, and stream. The first client
+ * to connect configures the camera (and codec), and the stream runs until the last client disconnects. The session
+ * (camera settings, encoder and encoder thread) is then kept warm for SESSION_KEEPWARM_S seconds: a client that
+ * reconnects with the same settings (e.g. after a network blip) gets a forced keyframe straight away instead of
+ * waiting for the camera and encoder to be set up again. A client with different settings, or no client at all
+ * for that long, closes the session and the camera is reconfigured for the next one. This means that sometimes
+ * clients can use decide to use the CODEC and sometimes not.
  *
- * This program can be multi-threaded. The optional encoder is contained in its own thread. If no encoder is used 
- * this program is single threaded. All frames are transferred between thread using a circular queue protected 
- * by mutex.
+ * Several clients (e.g. a recorder, a tracker and a live viewer) can subscribe to the same stream at once, as long
+ * as they ask for the same camera settings. Each frame is captured and encoded once, then fanned out to every
+ * subscriber. Each subscriber has its own send queue and sender thread, so a slow client only loses its own frames:
+ * raw streams drop the oldest queued frames, encoded streams skip ahead to the next keyframe (so the client's
+ * decoder never sees a packet whose reference frames were dropped). Encoded clients never wait out the GOP for that
+ * keyframe: the encoder is asked for one whenever a client joins, catches up after falling behind, or reports a
+ * decode error (CONTROL_KEYFRAME_REQUEST, see StreamProtocol.h).
+ *
+ * When the network can't keep up (e.g. the Wi-Fi link degrades) the stream degrades instead of building up latency.
+ * Rate control watches each client's send queue depth, how long each send blocks and how full the socket send
+ * buffer is. While any client is falling behind, it cuts the encoder's bit rate. Once the bit rate is at its floor
+ * (or for raw streams) it halves the frame rate. Encoders other than libx264 can only change their bit rate at a
+ * keyframe, so for those the frame rate goes first. Both come back up step by step once every client keeps up again.
+ * The resolution is left alone, the clients' decoders and trackers are set up for the size they asked for.
+ *
+ * The optional encoder is contained in its own thread. All frames are transferred between threads using a
+ * lock-free single-producer/single-consumer circular queue (RingBuffer). The capture never waits on the encoder: if
+ * the encoder falls behind, its oldest queued frame is dropped. Threads sleep in the queue's blocking pop when
+ * there is nothing to do rather than spinning, which leaves the Pi's cores to the camera and the encoder.
  *
  */
  
@@ -24,17 +43,56 @@
 #include <opencv2/opencv.hpp>
 #include <unistd.h>
 #include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
+#include <poll.h>
 #include <thread>
-#include <mutex>
+#include <atomic>
 #include <chrono>
 #include <string>
+#include <algorithm>
+#include <time.h>
+#include <errno.h>
 #include "VideoCodec.h"
 #include "CircularFrameBuf.h"
+#include "FramePool.h"
+#include "StreamProtocol.h"
 
 // Hardcoded. This app launches automatically on Raspberry Pi startup
 // so we don't buy anything by making the port a runtime param
 #define PORT 20006
 
+// How long a thread sleeps on an empty/full queue before re-checking whether the client is still connected
+#define QUEUE_TIMEOUT std::chrono::milliseconds(100)
+
+// Number of preallocated frame buffers. Frames in flight = queued + the one being captured + the one being encoded,
+// and the encoder normally keeps up, so this only needs to cover short bursts. Running out falls back to the heap.
+#define FRAME_POOL_SIZE 16
+
+// Most clients streaming at once, and how many frames each may have waiting to be sent (power of 2). A client
+// further behind than that loses frames, only its own.
+#define MAX_SUBSCRIBERS 8
+#define SUBSCRIBER_QUEUE_SIZE 8
+
+// Connections still sending their camera settings, and how long one gets to send them before it is dropped
+#define MAX_PENDING_CLIENTS 4
+#define CLIENT_SETTINGS_TIMEOUT_MS 2000
+
+// A client that cannot take a frame for this long is considered gone (it would otherwise hold a sender thread forever)
+#define SUBSCRIBER_SEND_TIMEOUT_S 5
+
+// How long the camera and encoder are kept ready after the last client leaves, for a quick reconnect
+#define SESSION_KEEPWARM_S 60
+
+// Rate control (see updateRateControl()): how often the clients are checked, how many calm checks in a row it takes
+// to step back up, and how far the bit rate (fraction of the starting rate) and frame rate (1 in N frames) may be cut
+#define RATE_CONTROL_INTERVAL_MS 500
+#define RATE_CONTROL_RECOVER_CHECKS 4
+#define RATE_CONTROL_MIN_BITRATE_DIV 8
+#define RATE_CONTROL_MAX_FRAME_STEP 4
+
 
 // Some useful defines to enable debugging/development
 //#define USEVIDEO
@@ -47,24 +105,220 @@ struct cameraSettings {
 	unsigned int width;
 	unsigned int fps;
 	char codec[20];
+	char profile[12];	// encoder profile name (see EncoderProfile in VideoCodec.h), "" = balanced
+	char threads[12];	// encoder threading policy (see CodecThreading in VideoCodec.h), "" = auto
 };
 
 
 
 
 /********************** Multi-threading Global Params**********************/
-int clientStatus = 1;
+// True while at least one client is subscribed to the stream
+std::atomic<bool> streamActive(false);
 
-// Global encoder and packet so that the main loop can initialize and the encoder thread can utilize
+// Global encoder so that the main loop can initialize and the encoder thread can utilize
 Encoder* vidEncoder;
-AVPacket* avPkt;
-packet encodePkt, sendPkt;
 
-// Circular buffers / mutexes for video frames going to encoder thread, and encoded packets come from the encoder thread
-std::mutex qFrame_mutex;
-QueueMat qFrame(64);
-std::mutex qPkt_mutex;
-QueuePkt qPkt(64);
+// Encoder thread CPU usage for the current client (read by the main loop after the thread is joined)
+unsigned long long encodeFrameCount = 0;
+unsigned long long encodeCpuNs = 0;
+
+// Pool of frame buffers the camera captures in to. Frames move through qFrame by handle and the buffer returns
+// to the pool when the encoder is done with it. Declared before the queues so it outlives any frame they hold.
+FramePool framePool;
+
+// Circular buffers for video frames going to encoder thread, and encoded packets come from the encoder thread.
+// Main loop is the only producer of qFrame / consumer of qPkt, encoder thread is the other end of both.
+// Each frame/packet carries its capture time so it can be stamped in the frame header on the wire.
+struct capturedFrame
+{
+	cv::Mat image;
+	int64_t captureUs;
+};
+
+struct encodedPacket
+{
+	PacketRef pkt;
+	int64_t captureUs;
+};
+
+// A packet dropped by a queue lets go of its data in place, the slot keeps its AVPacket (see RingBuffer.h)
+template <>
+struct RingBufferTraits<encodedPacket>
+{
+	static void enQueue(encodedPacket& item, encodedPacket& slot) { slot = std::move(item); }
+	static void deQueue(encodedPacket& slot, encodedPacket& item) { item = std::move(slot); }
+	static void release(encodedPacket& item) { item.pkt.unref(); }
+};
+
+// qFrame drops its oldest frame when the encoder falls that far behind (set up in main()), so the capture never
+// waits on the encoder. The rate control sees those drops.
+RingBuffer<capturedFrame, 64> qFrame;
+// qPkt holds references to the encoder's own packet buffers, the encoded bytes are never copied.
+RingBuffer<encodedPacket, 64> qPkt;
+
+// How much encoded video waits in qPkt between the encoder and the fan-out, reported with the session stats.
+// The encoder thread adds what it queues and keeps the peaks, the main loop subtracts what it takes out.
+struct packetQueueStats
+{
+	std::atomic<long long> bytesQueued;							// encoded bytes in qPkt now
+	std::atomic<long long> peakBytes;							// (encoder thread) most bytes in qPkt at once
+	std::atomic<size_t> peakPackets;							// (encoder thread) most packets in qPkt at once
+	std::atomic<int> largestPacket;								// (encoder thread) bytes
+};
+packetQueueStats pktStats;
+
+
+// One frame on its way to one subscriber. Raw frames share the captured image, encoded frames share the encoder's
+// packet (each subscriber gets its own reference, see PacketRef::ref()), so fanning out copies no frame data.
+struct streamItem
+{
+	frameHeader hdr;
+	PacketRef pkt;
+	cv::Mat image;
+};
+
+template <>
+struct RingBufferTraits<streamItem>
+{
+	static void enQueue(streamItem& item, streamItem& slot) { slot = std::move(item); }
+	static void deQueue(streamItem& slot, streamItem& item) { item = std::move(slot); }
+	static void release(streamItem& item) { item.pkt.unref(); item.image.release(); }
+};
+
+// A connected client. The main loop queues frames for it, its sender thread sends them.
+struct subscriber
+{
+	bool connected;												// slot in use
+	int sockFd;
+	std::string name;											// "ip:port", for logging
+	RingBuffer<streamItem, SUBSCRIBER_QUEUE_SIZE> queue;		// frames waiting to be sent
+	std::thread sender;
+	std::atomic<bool> alive;									// cleared by the sender thread when a send fails
+	bool waitKeyframe;											// (main loop) encoded stream: skip packets until the next keyframe
+	bool keyframeAsked;											// (main loop) the encoder was asked for that keyframe
+	controlMessage rxMsg;										// (main loop) control message being received
+	unsigned int rxMsgBytes;
+	unsigned long long keyframeRequests;						// (main loop) decode errors the client reported
+	unsigned long long skipped;									// (main loop) frames not queued because the client was behind
+	unsigned long long overflows;								// (main loop) times the queue was full (encoded streams)
+	std::atomic<unsigned long long> sent;						// (sender thread) frames sent
+	std::atomic<unsigned long long> sendUs;						// (sender thread) time spent blocked in sendFrame()
+	unsigned long long rcSent, rcSendUs, rcOverflows;			// (main loop) counters at the last rate control check
+	std::chrono::steady_clock::time_point joined;				// when the client connected
+	double firstFrameMs;										// (sender thread) connect -> first frame sent
+};
+
+// Fixed set of client slots, reused from client to client (so are their queues). Only the main loop adds/removes
+// subscribers and queues frames, so the slots themselves need no locking.
+subscriber subscribers[MAX_SUBSCRIBERS];
+int numSubscribers = 0;
+
+// A connection whose camera settings have not all arrived yet (main loop only). The main loop reads whatever has
+// arrived between frames (see acceptClient()), so a slow or silent client never stalls the capture.
+struct pendingClient
+{
+	bool connected;												// slot in use
+	int sockFd;
+	std::string name;											// "ip:port", for logging
+	cameraSettings settings;									// settings being received
+	unsigned int settingsBytes;
+	std::chrono::steady_clock::time_point joined;				// when the client connected
+};
+
+pendingClient pendingClients[MAX_PENDING_CLIENTS];
+
+// Rate control state (main loop only). The encoder's bit rate and the frame rate (only every frameStep'th frame
+// captured is sent) are cut, see updateRateControl() for which goes first.
+struct rateControlState
+{
+	int64_t nominalBitRate;										// bit rate the session started with, the ceiling (0 for raw)
+	int64_t minBitRate;											// floor
+	unsigned int frameStep;										// send 1 in frameStep captured frames
+	unsigned int calmChecks;									// checks in a row that found every client keeping up
+	unsigned long long encoderDrops;							// frames qFrame had dropped at the last check
+	std::chrono::steady_clock::time_point nextCheck;
+	unsigned long long cuts;									// times the rate was cut/raised this session
+	unsigned long long raises;
+};
+rateControlState rateControl;
+
+
+/*
+ * threadCpuNs(void) :
+ *
+ * Description:
+ * CPU time consumed by the calling thread so far.
+ *
+ * Inputs:
+ *		N/A
+ *
+ * Outputs:
+ *		unsigned long long (return val)   thread CPU time in nanoseconds
+ */
+unsigned long long threadCpuNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+/*
+ * sendFrame(int sockFd, const frameHeader& hdr, const void* payload) :
+ *
+ * Description:
+ * Send one frame (header + payload, see StreamProtocol.h) to the client with a single gathering send, so the
+ * header does not go out in a tiny packet of its own.
+ *
+ * Inputs:
+ *		int sockFd					client socket
+ *		const frameHeader& hdr		frame header (hdr.length is the payload size)
+ *		const void* payload			frame payload
+ *
+ * Outputs:
+ *		int (return val)			bytes sent, <= 0 if the send failed (same as send())
+ */
+int sendFrame(int sockFd, const frameHeader& hdr, const void* payload)
+{
+	struct iovec iov[2];
+	iov[0].iov_base = (void*)&hdr;
+	iov[0].iov_len = sizeof(hdr);
+	iov[1].iov_base = (void*)payload;
+	iov[1].iov_len = hdr.length;
+
+	struct msghdr msg = {};
+	msg.msg_iov = iov;
+	msg.msg_iovlen = 2;
+
+	// A blocking socket only returns early if interrupted (part sent, or EINTR before anything went out), pick up
+	// where it left off
+	size_t remaining = sizeof(hdr) + hdr.length;
+	while (remaining > 0)
+	{
+		// MSG_NOSIGNAL: a client that went away must not take the whole server down with SIGPIPE
+		ssize_t sent = sendmsg(sockFd, &msg, MSG_NOSIGNAL);
+		if (sent < 0 && errno == EINTR)
+			continue;
+		if (sent <= 0)
+			return (int)sent;
+
+		remaining -= sent;
+		while (msg.msg_iovlen > 0 && (size_t)sent >= msg.msg_iov[0].iov_len)
+		{
+			sent -= msg.msg_iov[0].iov_len;
+			msg.msg_iov++;
+			msg.msg_iovlen--;
+		}
+		if (msg.msg_iovlen > 0)
+		{
+			msg.msg_iov[0].iov_base = (char*)msg.msg_iov[0].iov_base + sent;
+			msg.msg_iov[0].iov_len -= sent;
+		}
+	}
+
+	return (int)(sizeof(hdr) + hdr.length);
+}
 
 
 /*
@@ -72,61 +326,693 @@ QueuePkt qPkt(64);
  *
  * Description:
  * This function grabs a frame from a circular frame queue, encodes it, then puts the encoded 
- * packet in a circular packet queue. 
+ * packet in the packet queue. 
  * 
  * This function was created with the intention of putting it in a separate thread, but should work
  * in a single threaded context as well.
  *
  * Inputs:
- *		cv::Mat frame			Mat frame for handling the frames. It is not known until run time the size of the frame - so arg is an uninit cv::Mat
+ *		N/A
  *
  * Outputs:
  *		N/A
  */
-void encodeFrames(cv::Mat frame)
+void encodeFrames(void)
 {
-	bool success = false;
+	capturedFrame frame;
+	encodedPacket encoded;
+
+	// The encoder numbers frames 0, 1, 2... as pts and may output packets out of order (B-frames), so remember
+	// each frame's capture time by pts until its packet comes out
+	int64_t captureUs[64];
+	int64_t framesSubmitted = 0;
 
 	// Loop while we still have a client connected
-	while (clientStatus > 0)
+	while (streamActive && !qFrame.isShutdown())
 	{
-		// Loop until a frame is available from the input queue
-		do
+		// Sleep until a frame is available from the input queue. On timeout (or when the main loop
+		// shuts the queue down because the client left) go back around and re-check the client.
+		if (!qFrame.pop(frame, QUEUE_TIMEOUT))
+			continue;
+
+
+		// We got a frame, so encode it, then deposit the encoded packets in the output packet queue. Usually there
+		// is at most one, but a bit rate change flushes the encoder's old context (see Encoder::setBitRate()).
+		// The encoder fills encodePkt with a reference to its own buffer, push() just hands that reference over.
+		// Thread CPU time does not advance while push() sleeps, so the measurement is only the work we do.
+		unsigned long long cpuStart = threadCpuNs();
+		captureUs[framesSubmitted++ % 64] = frame.captureUs;
+		bool gotPacket = vidEncoder->encode(frame.image, encoded.pkt.get());
+		while (gotPacket)
 		{
-			qFrame_mutex.lock();
-			success = qFrame.deQueue(frame);
-			qFrame_mutex.unlock();
-			
-			if (clientStatus < 0 ) return;
-		} while (!success);
+			encoded.captureUs = (encoded.pkt->pts == AV_NOPTS_VALUE) ? frame.captureUs : captureUs[encoded.pkt->pts % 64];
+
+			// Sleep until we can deposit the encoded packet in the output queue
+			const int pktBytes = encoded.pkt->size;
+			while (!qPkt.push(encoded, QUEUE_TIMEOUT))
+			{
+				if (!streamActive || qPkt.isShutdown()) return;
+			}
+
+			long long queuedBytes = pktStats.bytesQueued.fetch_add(pktBytes) + pktBytes;
+			pktStats.peakBytes = std::max(pktStats.peakBytes.load(), queuedBytes);
+			pktStats.peakPackets = std::max(pktStats.peakPackets.load(), qPkt.size());
+			pktStats.largestPacket = std::max(pktStats.largestPacket.load(), pktBytes);
+
+			gotPacket = vidEncoder->receivePacket(encoded.pkt.get());
+		}
+		encodeCpuNs += threadCpuNs() - cpuStart;
+		encodeFrameCount++;
+	}
+}
+
+
+/*
+ * sendFrames(subscriber* sub) :
+ *
+ * Description:
+ * Sender thread for one subscriber. Takes frames from the subscriber's queue and sends them until a send fails
+ * (client gone or stalled for SUBSCRIBER_SEND_TIMEOUT_S) or the queue is shut down.
+ *
+ * Inputs:
+ *		subscriber* sub				the client to send to
+ *
+ * Outputs:
+ *		N/A
+ */
+void sendFrames(subscriber* sub)
+{
+	streamItem item;
+
+	while (sub->alive && !sub->queue.isShutdown())
+	{
+		if (!sub->queue.pop(item, QUEUE_TIMEOUT))
+			continue;
+
+		const void* payload = item.image.empty() ? (const void*)item.pkt->data : (const void*)item.image.data;
+
+		// A send only blocks once the socket buffer is full, so the time spent here is how far the link is behind
+		std::chrono::steady_clock::time_point sendStart = std::chrono::steady_clock::now();
+		int ret = sendFrame(sub->sockFd, item.hdr, payload);
+		sub->sendUs += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - sendStart).count();
+
+		if (ret > 0)
+		{
+			if (sub->sent++ == 0)
+				sub->firstFrameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sub->joined).count();
+		}
+		else
+		{
+			sub->alive = false;
+		}
+
+		// Let go of the buffer now rather than when the next frame arrives
+		item.pkt.unref();
+		item.image.release();
+	}
+}
+
+
+/*
+ * acceptPending(int serverSockFd) :
+ *
+ * Description:
+ * Accept every connection waiting on the listening socket into a free pending slot, without blocking.
+ *
+ * Inputs:
+ *		int serverSockFd			listening socket
+ *
+ * Outputs:
+ *		N/A
+ */
+void acceptPending(int serverSockFd)
+{
+	struct pollfd serverPoll = { serverSockFd, POLLIN, 0 };
+	while (poll(&serverPoll, 1, 0) > 0)
+	{
+		struct sockaddr_in clientAddr;
+		socklen_t clientLen = sizeof(clientAddr);
+
+		// Accept() will write the connecting client's address info 
+		// into the the address structure and the size of that structure is clilen.
+		// Accept() returns a new socket file descriptor for the accepted connection.
+		int clientSockFd = accept(serverSockFd, (struct sockaddr*)&clientAddr, &clientLen);
+		if (clientSockFd < 0)
+		{
+			std::cerr << "ERROR on accept" << std::endl;
+			return;
+		}
+		std::string name = std::string(inet_ntoa(clientAddr.sin_addr)) + ":" + std::to_string(ntohs(clientAddr.sin_port));
+		std::cout << "Server: Got connection from " << name << std::endl;
+
+		pendingClient* pending = nullptr;
+		for (int i = 0; i < MAX_PENDING_CLIENTS && !pending; i++)
+		{
+			if (!pendingClients[i].connected)
+				pending = &pendingClients[i];
+		}
+		if (!pending)
+		{
+			std::cerr << "Rejecting " << name << ": too many connections waiting" << std::endl;
+			close(clientSockFd);
+			continue;
+		}
+
+		// A client that never reads must not hold a sender thread forever
+		struct timeval sndTimeout = { SUBSCRIBER_SEND_TIMEOUT_S, 0 };
+		setsockopt(clientSockFd, SOL_SOCKET, SO_SNDTIMEO, &sndTimeout, sizeof(sndTimeout));
+
+		pending->connected = true;
+		pending->sockFd = clientSockFd;
+		pending->name = name;
+		pending->settingsBytes = 0;
+		pending->joined = std::chrono::steady_clock::now();
+	}
+}
+
+
+/*
+ * acceptClient(int serverSockFd, cameraSettings& settings, std::string& name, std::chrono::steady_clock::time_point& joined) :
+ *
+ * Description:
+ * Accept any new connections, then read whatever part of its camera configuration packet each pending
+ * connection has sent so far, without blocking. A connection that closes, or doesn't send its settings within
+ * CLIENT_SETTINGS_TIMEOUT_MS, is dropped. Returns the first client whose settings are complete; call it
+ * again for the next one.
+ *
+ * Inputs:
+ *		int serverSockFd			listening socket
+ *
+ * Outputs:
+ *		cameraSettings& settings	camera settings the client asked for
+ *		std::string& name			client "ip:port", for logging
+ *		steady_clock::time_point& joined   when the client connected
+ *		int (return val)			client socket, < 0 if no client is ready yet
+ */
+int acceptClient(int serverSockFd, cameraSettings& settings, std::string& name, std::chrono::steady_clock::time_point& joined)
+{
+	acceptPending(serverSockFd);
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	for (int i = 0; i < MAX_PENDING_CLIENTS; i++)
+	{
+		pendingClient* pending = &pendingClients[i];
+		if (!pending->connected)
+			continue;
+
+		// Read camera setup struct that the client sends immediately after connecting, as much as is there
+		ssize_t n = recv(pending->sockFd, (char*)&pending->settings + pending->settingsBytes,
+			sizeof(pending->settings) - pending->settingsBytes, MSG_DONTWAIT);
+		if (n > 0)
+			pending->settingsBytes += n;
+
+		if (pending->settingsBytes == sizeof(pending->settings))
+		{
+			pending->connected = false;
+			settings = pending->settings;
+			settings.codec[sizeof(settings.codec) - 1] = '\0';
+			settings.profile[sizeof(settings.profile) - 1] = '\0';
+			settings.threads[sizeof(settings.threads) - 1] = '\0';
+			name = pending->name;
+			joined = pending->joined;
+			return pending->sockFd;
+		}
+
+		// Closed, failed, or too slow. (n < 0 with EAGAIN just means nothing has arrived yet.)
+		if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) ||
+			now - pending->joined > std::chrono::milliseconds(CLIENT_SETTINGS_TIMEOUT_MS))
+		{
+			std::cerr << "ERROR reading camera settings from " << pending->name << std::endl;
+			close(pending->sockFd);
+			pending->connected = false;
+		}
+	}
+
+	return -1;
+}
+
+
+/*
+ * waitForClients(int serverSockFd) :
+ *
+ * Description:
+ * Sleep until there is a new connection or a pending one has sent more of its settings (or for at most
+ * QUEUE_TIMEOUT, so pending connections still time out). For when nothing is streaming.
+ *
+ * Inputs:
+ *		int serverSockFd			listening socket
+ *
+ * Outputs:
+ *		N/A
+ */
+void waitForClients(int serverSockFd)
+{
+	struct pollfd fds[MAX_PENDING_CLIENTS + 1];
+	int numFds = 0;
+
+	fds[numFds++] = { serverSockFd, POLLIN, 0 };
+	for (int i = 0; i < MAX_PENDING_CLIENTS; i++)
+	{
+		if (pendingClients[i].connected)
+			fds[numFds++] = { pendingClients[i].sockFd, POLLIN, 0 };
+	}
+
+	poll(fds, numFds, (int)std::chrono::duration_cast<std::chrono::milliseconds>(QUEUE_TIMEOUT).count());
+}
+
+
+/*
+ * addSubscriber(int sockFd, const std::string& name, bool encoded, std::chrono::steady_clock::time_point joined) :
+ *
+ * Description:
+ * Add a client to the stream and start its sender thread.
+ *
+ * Inputs:
+ *		int sockFd					client socket
+ *		const std::string& name		client "ip:port", for logging
+ *		bool encoded				stream is encoded (only keyframes are safe to start on / resume from)
+ *		steady_clock::time_point joined   when the client connected (for the time to first frame)
+ *
+ * Outputs:
+ *		bool (return val)			false if all the client slots are taken
+ */
+bool addSubscriber(int sockFd, const std::string& name, bool encoded, std::chrono::steady_clock::time_point joined)
+{
+	subscriber* sub = nullptr;
+	for (int i = 0; i < MAX_SUBSCRIBERS && !sub; i++)
+	{
+		if (!subscribers[i].connected)
+			sub = &subscribers[i];
+	}
+	if (!sub)
+		return false;
+
+	sub->connected = true;
+	sub->sockFd = sockFd;
+	sub->name = name;
+	sub->alive = true;
+	sub->waitKeyframe = encoded;
+	sub->keyframeAsked = false;
+	sub->rxMsgBytes = 0;
+	sub->keyframeRequests = 0;
+	sub->skipped = 0;
+	sub->overflows = 0;
+	sub->sent = 0;
+	sub->sendUs = 0;
+	sub->rcSent = 0;
+	sub->rcSendUs = 0;
+	sub->rcOverflows = 0;
+	sub->joined = joined;
+	sub->firstFrameMs = 0.0;
 
+	// Raw frames stand alone, so a client that falls behind just gets the newest ones. Encoded packets depend on
+	// the ones before them, so the queue refuses when full and publishFrame() skips to the next keyframe instead.
+	sub->queue.setOverflowPolicy(encoded ? OVERFLOW_BLOCK : OVERFLOW_DROP_OLDEST);
 
-		// We got a frame, so encode it, then deposit the encoded packet in the output packet queue
-		if (vidEncoder->encode(frame, avPkt))
+	// Don't make the new client wait for the next keyframe in the GOP
+	if (encoded)
+	{
+		vidEncoder->requestKeyframe();
+		sub->keyframeAsked = true;
+	}
+
+	sub->sender = std::thread(sendFrames, sub);
+	numSubscribers++;
+	std::cout << "Streaming Video to " << name << " (" << numSubscribers << " client(s))" << std::endl;
+
+	return true;
+}
+
+
+/*
+ * removeSubscriber(subscriber* sub) :
+ *
+ * Description:
+ * Stop a client's sender thread, close its socket and free its slot.
+ *
+ * Inputs:
+ *		subscriber* sub				the client to remove
+ *
+ * Outputs:
+ *		N/A
+ */
+void removeSubscriber(subscriber* sub)
+{
+	// Wake the sender thread whether it is asleep on the queue or stuck in send()
+	sub->alive = false;
+	sub->queue.shutdown();
+	shutdown(sub->sockFd, SHUT_RDWR);
+	sub->sender.join();
+	close(sub->sockFd);
+
+	RingBufferStats queueStats = sub->queue.getStats();
+	std::cout << "Connection from " << sub->name << " has been CLOSED: " << sub->sent << " frames sent (first after "
+		<< sub->firstFrameMs << " ms), " << sub->skipped + queueStats.droppedOldest << " skipped (client behind, or waiting for a keyframe), "
+		<< sub->keyframeRequests << " keyframe requests" << std::endl;
+
+	// Release whatever was still queued for it and make the slot usable for the next client
+	sub->queue.reset();
+	sub->connected = false;
+	numSubscribers--;
+}
+
+
+/*
+ * publishFrame(const frameHeader& hdr, const PacketRef* pkt, const cv::Mat& image) :
+ *
+ * Description:
+ * Queue one frame for every subscriber. Nothing is copied: each queue gets a new reference to the same
+ * packet/image. A subscriber whose queue is full misses the frame, the others are not affected.
+ *
+ * Inputs:
+ *		const frameHeader& hdr		frame header (the same for every subscriber)
+ *		const PacketRef* pkt		encoded packet, or nullptr for a raw frame
+ *		const cv::Mat& image		raw frame (ignored for encoded frames)
+ *
+ * Outputs:
+ *		N/A
+ */
+void publishFrame(const frameHeader& hdr, const PacketRef* pkt, const cv::Mat& image)
+{
+	bool keyFrame = (hdr.flags & STREAM_FLAG_KEY) != 0;
+	streamItem item;
+
+	for (int i = 0; i < MAX_SUBSCRIBERS; i++)
+	{
+		subscriber* sub = &subscribers[i];
+		if (!sub->connected || !sub->alive)
+			continue;
+
+		// An encoded client that missed a packet (or just joined) can only pick the stream up at a keyframe.
+		// Ask for one as soon as there is room for it in the client's queue.
+		if (sub->waitKeyframe && !keyFrame)
 		{
-			// Output packet queue uses the "struct packet" data type. It is a extremely simplified verison of an AVPacket
-			encodePkt.size = avPkt->size;
-			memcpy(encodePkt.buffer, avPkt->data, avPkt->size);
+			if (!sub->keyframeAsked && sub->queue.size() <= SUBSCRIBER_QUEUE_SIZE / 2)
+			{
+				vidEncoder->requestKeyframe();
+				sub->keyframeAsked = true;
+			}
+			sub->skipped++;
+			continue;
+		}
 
-			// Loop until we can deposit the encoded packet in the output queue
-			do
+		item.hdr = hdr;
+		if (pkt)
+		{
+			if (!item.pkt.ref(*pkt))
 			{
-				qPkt_mutex.lock();
-				success = qPkt.enQueue(encodePkt);
-				qPkt_mutex.unlock();
-				
-				if (clientStatus < 0 ) return;
-			} while (!success);
+				sub->skipped++;
+				sub->waitKeyframe = true;
+				continue;
+			}
+		}
+		else
+		{
+			item.image = image;
+		}
+
+		// enQueue() leaves item empty when it takes it, otherwise the references are simply dropped next time round
+		if (sub->queue.enQueue(item))
+		{
+			sub->waitKeyframe = false;
+		}
+		else
+		{
+			sub->skipped++;
+			sub->overflows++;
+			sub->waitKeyframe = true;
+			sub->keyframeAsked = false;
 		}
 	}
 }
 
 
+/*
+ * readControlMessages(subscriber* sub, bool encoded) :
+ *
+ * Description:
+ * Handle whatever control messages (see StreamProtocol.h) the client has sent, without blocking. Also notices a
+ * client that closed its end, before a send to it fails.
+ *
+ * Inputs:
+ *		subscriber* sub				the client to read from
+ *		bool encoded				stream is encoded (keyframe requests go to the encoder)
+ *
+ * Outputs:
+ *		N/A
+ */
+void readControlMessages(subscriber* sub, bool encoded)
+{
+	for (;;)
+	{
+		ssize_t n = recv(sub->sockFd, (char*)&sub->rxMsg + sub->rxMsgBytes, sizeof(sub->rxMsg) - sub->rxMsgBytes, MSG_DONTWAIT);
+		if (n == 0)
+		{
+			sub->alive = false; // client closed the connection
+			return;
+		}
+		if (n < 0)
+			return; // nothing more to read (a real error shows up on the next send)
+
+		sub->rxMsgBytes += n;
+		if (sub->rxMsgBytes < sizeof(sub->rxMsg))
+			continue;
+		sub->rxMsgBytes = 0;
+
+		if (!checkControlMessage(sub->rxMsg))
+		{
+			std::cerr << "Bad control message from " << sub->name << ", dropping client" << std::endl;
+			sub->alive = false;
+			return;
+		}
+
+		if (sub->rxMsg.type == CONTROL_KEYFRAME_REQUEST && encoded)
+		{
+			vidEncoder->requestKeyframe();
+			sub->keyframeRequests++;
+		}
+	}
+}
+
+
+/*
+ * sameSettings(const cameraSettings& a, const cameraSettings& b) :
+ *
+ * Description:
+ * Check if two clients asked for the same stream (so they can share it).
+ *
+ * Inputs:
+ *		const cameraSettings& a		settings of one client
+ *		const cameraSettings& b		settings of the other client
+ *
+ * Outputs:
+ *		bool (return val)			true if the settings match
+ */
+bool sameSettings(const cameraSettings& a, const cameraSettings& b)
+{
+	return a.height == b.height && a.width == b.width && a.fps == b.fps &&
+		strncmp(a.codec, b.codec, sizeof(a.codec)) == 0 && strncmp(a.profile, b.profile, sizeof(a.profile)) == 0 &&
+		strncmp(a.threads, b.threads, sizeof(a.threads)) == 0;
+}
+
+
+/*
+ * resetRateControl(bool encoded) :
+ *
+ * Description:
+ * Put the stream back to the full bit rate and frame rate, for a new client on a new or warm session.
+ *
+ * Inputs:
+ *		bool encoded				the session has an encoder
+ *
+ * Outputs:
+ *		N/A
+ */
+void resetRateControl(bool encoded)
+{
+	if (encoded && vidEncoder->getBitRate() != rateControl.nominalBitRate)
+		vidEncoder->setBitRate(rateControl.nominalBitRate);
+
+	rateControl.frameStep = 1;
+	rateControl.calmChecks = 0;
+	rateControl.encoderDrops = qFrame.getStats().droppedOldest;
+	rateControl.nextCheck = std::chrono::steady_clock::now() + std::chrono::milliseconds(RATE_CONTROL_INTERVAL_MS);
+	rateControl.cuts = 0;
+	rateControl.raises = 0;
+}
+
+
+/*
+ * updateRateControl(bool encoded, unsigned int fps) :
+ *
+ * Description:
+ * Called from the main loop every frame, acts every RATE_CONTROL_INTERVAL_MS. Looks at every client's send side
+ * since the last check:
+ *	- queue depth, and whether the queue overflowed (the sender thread can't keep up with the camera)
+ *	- average time a send blocked, compared with the time between frames (the link can't keep up)
+ *	- how much of the socket send buffer is unsent/unacknowledged (the link is about to stop keeping up)
+ * The encoder's queue (qFrame) is judged the same way: frames piling up or being dropped there mean the encoder
+ * can't keep up with the camera.
+ * If anything is falling behind, the bit rate is cut by 30% (down to the floor), then the frame rate is halved.
+ * Only libx264 takes a new bit rate on the next frame, the other encoders wait for their next keyframe (see
+ * Encoder::setBitRate(), at most a second with the latency profile, up to 5 s with the others), so for those the
+ * frame rate is halved first and the bit rate cut after that. After a cut
+ * the next check is skipped, so the queues get a chance to drain before it is judged again. Once every client has
+ * kept up for RATE_CONTROL_RECOVER_CHECKS checks in a row, the frame rate comes back first, then the bit rate in
+ * 15% steps. One encoder serves every client, so the slowest client sets the rate for all of them.
+ *
+ * Inputs:
+ *		bool encoded				the session has an encoder
+ *		unsigned int fps			camera frame rate
+ *
+ * Outputs:
+ *		N/A
+ */
+void updateRateControl(bool encoded, unsigned int fps)
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (now < rateControl.nextCheck)
+		return;
+	rateControl.nextCheck = now + std::chrono::milliseconds(RATE_CONTROL_INTERVAL_MS);
+
+	double frameIntervalUs = 1e6 * rateControl.frameStep / fps;
+	bool congested = false;
+	bool calm = true;
+	for (int i = 0; i < MAX_SUBSCRIBERS; i++)
+	{
+		subscriber* sub = &subscribers[i];
+		if (!sub->connected || !sub->alive)
+			continue;
+
+		unsigned long long sent = sub->sent;
+		unsigned long long sendUs = sub->sendUs;
+		unsigned long long overflows = sub->overflows + sub->queue.getStats().droppedOldest;
+		double avgSendUs = (sent > sub->rcSent) ? double(sendUs - sub->rcSendUs) / (sent - sub->rcSent) : 0.0;
+		size_t depth = sub->queue.size();
+
+		// The send buffer grows with the connection (autotuning), so its size is read every time
+		int unsent = 0, sndBuf = 0;
+		socklen_t optLen = sizeof(sndBuf);
+		double sndBufFill = 0.0;
+		if (ioctl(sub->sockFd, SIOCOUTQ, &unsent) == 0 &&
+			getsockopt(sub->sockFd, SOL_SOCKET, SO_SNDBUF, &sndBuf, &optLen) == 0 && sndBuf > 0)
+			sndBufFill = double(unsent) / sndBuf;
+
+		if (overflows > sub->rcOverflows || depth >= SUBSCRIBER_QUEUE_SIZE / 2 || avgSendUs > 0.5 * frameIntervalUs ||
+			sndBufFill > 0.4)
+			congested = true;
+		if (depth > 1 || avgSendUs > 0.25 * frameIntervalUs || sndBufFill > 0.1)
+			calm = false;
+
+		sub->rcSent = sent;
+		sub->rcSendUs = sendUs;
+		sub->rcOverflows = overflows;
+	}
+
+	// The encoder is a client of the capture too
+	unsigned long long encoderDrops = qFrame.getStats().droppedOldest;
+	size_t encoderDepth = qFrame.size();
+	if (encoderDrops > rateControl.encoderDrops || encoderDepth >= SUBSCRIBER_QUEUE_SIZE / 2)
+		congested = true;
+	if (encoderDepth > 1)
+		calm = false;
+	rateControl.encoderDrops = encoderDrops;
+
+	int64_t bitRate = encoded ? vidEncoder->getBitRate() : 0;
+	if (congested)
+	{
+		bool cutBitRate = encoded && bitRate > rateControl.minBitRate;
+		bool cutFrameRate = rateControl.frameStep < RATE_CONTROL_MAX_FRAME_STEP;
+		rateControl.calmChecks = 0;
+		if (cutBitRate && (vidEncoder->bitRateIsLive() || !cutFrameRate))
+			vidEncoder->setBitRate(std::max(rateControl.minBitRate, bitRate * 7 / 10));
+		else if (cutFrameRate)
+			rateControl.frameStep *= 2;
+		else
+			return; // nothing left to cut
+
+		rateControl.cuts++;
+		rateControl.nextCheck += std::chrono::milliseconds(RATE_CONTROL_INTERVAL_MS);
+	}
+	else if (calm && (rateControl.frameStep > 1 || bitRate < rateControl.nominalBitRate))
+	{
+		if (++rateControl.calmChecks < RATE_CONTROL_RECOVER_CHECKS)
+			return;
+		rateControl.calmChecks = 0;
+
+		if (rateControl.frameStep > 1)
+			rateControl.frameStep /= 2;
+		else
+			vidEncoder->setBitRate(std::min(rateControl.nominalBitRate, bitRate * 115 / 100));
+
+		rateControl.raises++;
+	}
+	else
+	{
+		rateControl.calmChecks = 0;
+		return;
+	}
+
+	std::cout << "Rate control: " << (congested ? "clients falling behind" : "clients keeping up") << ", now ";
+	if (encoded)
+		std::cout << vidEncoder->getBitRate() / 1000 << " kbit/s at ";
+	std::cout << double(fps) / rateControl.frameStep << " fps" << std::endl;
+}
+
+
+/*
+ * stopSession(std::thread& encoderThread, bool encoded) :
+ *
+ * Description:
+ * Close the current camera session: stop the encoder thread, free the encoder and empty the queues. The camera is
+ * left open, the next session reconfigures it.
+ *
+ * Inputs:
+ *		std::thread& encoderThread	the session's encoder thread
+ *		bool encoded				the session has an encoder
+ *
+ * Outputs:
+ *		N/A
+ */
+void stopSession(std::thread& encoderThread, bool encoded)
+{
+	streamActive = false;
+	if (encoded)
+	{
+		// Wake the encoder thread if it is asleep on either queue so it sees the session is over
+		qFrame.shutdown();
+		qPkt.shutdown();
+		encoderThread.join();
+		CodecThreadStats threadStats = vidEncoder->getThreadStats();
+		delete vidEncoder;
+		std::cout << "Encoder closed" << std::endl;
+
+		if (encodeFrameCount)
+			std::cout << "Encoder thread: " << encodeFrameCount << " frames, " << (encodeCpuNs / encodeFrameCount) / 1000.0
+				<< " us CPU/frame (convert + encode + packet hand-off)" << std::endl;
+		printThreadStats("Encoder", threadStats);
+	}
+
+	// Throw away anything left over (frames go back to the pool, packets back to FFMPEG)
+	// and make the queues usable for the next session.
+	qFrame.reset();
+	qPkt.reset();
+	pktStats.bytesQueued = 0;
+}
+
+
 int main(int argc, char* argv[])
 {
-	cv::Mat frame;
-	int imgSize;
-	cameraSettings camSettings;
+	capturedFrame frame;
+	encodedPacket sendPkt;
+	frameHeader sendHdr;
+	uint32_t sendSequence;
+	cameraSettings camSettings, clientSettings;
+	std::string clientName, codec;
+	std::chrono::steady_clock::time_point clientJoined;
+
+	// A session (configured camera + encoder + encoder thread) outlives its clients by SESSION_KEEPWARM_S
+	bool sessionWarm = false;
 
 	// Camera / video 
 #ifdef USEVIDEO
@@ -148,12 +1034,13 @@ int main(int argc, char* argv[])
 	memset(camSettings.codec, 0, sizeof(camSettings.codec));
 	memcpy(camSettings.codec, "none", 10);
 #endif 
+	memset(camSettings.profile, 0, sizeof(camSettings.profile));
+	memset(camSettings.threads, 0, sizeof(camSettings.threads));
 
 
 	// TCP Socket
 	int serverSockFd, clientSockFd;
-	struct sockaddr_in serverAddr, clientAddr;
-	socklen_t clientLen = sizeof(clientAddr);
+	struct sockaddr_in serverAddr;
 
 
 	// Thread for encoder
@@ -185,8 +1072,10 @@ int main(int argc, char* argv[])
 	}
 
 	// Listen for incoming connections from clients.
-	// Note: setting backlog queue to 5, though we only ever expect 1 client
-	listen(serverSockFd, 5);
+	listen(serverSockFd, MAX_SUBSCRIBERS);
+
+	// A frame the encoder hasn't got to yet is worth less than the one just captured (see qFrame)
+	qFrame.setOverflowPolicy(OVERFLOW_DROP_OLDEST);
 
 
 
@@ -195,115 +1084,197 @@ int main(int argc, char* argv[])
 	// Whenver a client connects start streaming video (raw data, not encoded)
 	for (;;)
 	{
-		std::cout << "Listening for connections.." << std::endl;
+		// While a session is warm keep the camera streaming (grab() only, nothing is converted or encoded) so a
+		// reconnect starts on a fresh frame rather than whatever sat in the driver's buffers.
+		if (sessionWarm)
+		{
+			std::cout << "Session warm, listening for connections.." << std::endl;
+			std::chrono::steady_clock::time_point idleStart = std::chrono::steady_clock::now();
+			while ((clientSockFd = acceptClient(serverSockFd, clientSettings, clientName, clientJoined)) < 0 &&
+				std::chrono::steady_clock::now() - idleStart < std::chrono::seconds(SESSION_KEEPWARM_S))
+			{
+				vidCam.grab();
+			}
 
-		// Accept() will write the connecting client's address info 
-		// into the the address structure and the size of that structure is clilen.
-		// Accept() returns a new socket file descriptor for the accepted connection.
-		clientSockFd = accept(serverSockFd, (struct sockaddr*)&clientAddr, &clientLen);
-		if (clientSockFd < 0)
+			if (clientSockFd < 0)
+			{
+				std::cout << "No client for " << SESSION_KEEPWARM_S << " s, closing session" << std::endl;
+				stopSession(m_encoderThread, codec != "none");
+				sessionWarm = false;
+				continue;
+			}
+		}
+		else
 		{
-			std::cerr << "ERROR on accept" << std::endl;
-			return 1;
+			std::cout << "Listening for connections.." << std::endl;
+			while ((clientSockFd = acceptClient(serverSockFd, clientSettings, clientName, clientJoined)) < 0)
+				waitForClients(serverSockFd);
 		}
-		std::cout << "Server: Got connection from " << inet_ntoa(clientAddr.sin_addr)
-			<< " on port " << ntohs(clientAddr.sin_port) << std::endl;
-
-
 
-		/********************** Setup Camera **********************/
-		// Read camera setup struct that we know is being sent immediately
-		// after connecting.
-		clientStatus = read(clientSockFd, &camSettings, sizeof(camSettings));
-		if (clientStatus < 0)
+		// The first client configures the camera for everyone that joins after it
+		// A reconnect with the same settings picks the warm session up again, anything else needs a new one
+		if (sessionWarm && !sameSettings(clientSettings, camSettings))
 		{
-			std::cerr << "ERROR reading camera settings" << std::endl;
-			return 1;
+			std::cout << "New camera settings, closing warm session" << std::endl;
+			stopSession(m_encoderThread, codec != "none");
+			sessionWarm = false;
 		}
-		std::string codec(camSettings.codec);
 
-
-		// Check if camera is open and operating before trying to setup
-		if (!vidCam.isOpened())
+		if (sessionWarm)
 		{
-			std::cerr << "Cannot access Raspberry Pi Cam" << std::endl;
-			return 1;
+			// Anything the encoder finished after the last client left is stale. (addSubscriber() asks for the
+			// keyframe the new client starts on.)
+			while (qPkt.deQueue(sendPkt))
+			{
+				pktStats.bytesQueued -= sendPkt.pkt->size;
+				sendPkt.pkt.unref();
+			}
+			std::cout << "Reusing warm session" << std::endl;
 		}
-#ifndef USEVIDEO
-		// Setup basic cam settings	    
-		if (!vidCam.set(cv::CAP_PROP_FPS, camSettings.fps) ||
-			!vidCam.set(cv::CAP_PROP_FRAME_WIDTH, camSettings.width) ||
-			!vidCam.set(cv::CAP_PROP_FRAME_HEIGHT, camSettings.height))
+		else
 		{
-			std::cerr << "Cannot Set FPS" << std::endl;
-			return 1;
-		}
+			camSettings = clientSettings;
+			codec = camSettings.codec;
+
+
+			// Check if camera is open and operating before trying to setup
+			if (!vidCam.isOpened())
+			{
+				std::cerr << "Cannot access Raspberry Pi Cam" << std::endl;
+				return 1;
+			}
+#ifndef USEVIDEO
+			// Setup basic cam settings	    
+			if (!vidCam.set(cv::CAP_PROP_FPS, camSettings.fps) ||
+				!vidCam.set(cv::CAP_PROP_FRAME_WIDTH, camSettings.width) ||
+				!vidCam.set(cv::CAP_PROP_FRAME_HEIGHT, camSettings.height))
+			{
+				std::cerr << "Cannot Set FPS" << std::endl;
+				return 1;
+			}
 #endif 
 
+			// Preallocate frame buffers for the requested resolution
+			framePool.configure(camSettings.height, camSettings.width, CV_8UC3, FRAME_POOL_SIZE);
 
 
-		/********************** Setup Codec **********************/
-		// If using compression initalize the codec and a packet that will
-		// hold the encoded frame. Launch thread to do encoding
-		if (codec != "none")
-		{
-			vidEncoder = new Encoder(codec.c_str(), AV_PIX_FMT_BGR24, AV_PIX_FMT_YUV420P, camSettings.width, camSettings.height, camSettings.fps);
-			//vidEncoder = new Encoder("h264_omx", AV_PIX_FMT_BGR24, AV_PIX_FMT_YUV420P, camSettings.width, camSettings.height, camSettings.fps);
-			avPkt = av_packet_alloc();
-			if (!avPkt)
-				exit(1);
-
-			cv::Mat frameEncode(camSettings.height, camSettings.width, CV_8UC3);
-			m_encoderThread = std::thread(encodeFrames, frameEncode);
+
+			/********************** Setup Codec **********************/
+			// If using compression initalize the codec and a packet that will
+			// hold the encoded frame. Launch thread to do encoding
+			streamActive = true;
+			if (codec != "none")
+			{
+				EncoderProfile profile = ENCODER_PROFILE_BALANCED;
+				if (!encoderProfileFromName(camSettings.profile, profile))
+					std::cerr << "Unknown encoder profile \"" << camSettings.profile << "\", using balanced" << std::endl;
+				CodecThreading threading;
+				if (!codecThreadingFromName(camSettings.threads, threading))
+					std::cerr << "Unknown encoder threading \"" << camSettings.threads << "\", using auto" << std::endl;
+				std::cout << "Encoding " << codec << " with the " << (profile == ENCODER_PROFILE_LATENCY ? "latency" :
+					profile == ENCODER_PROFILE_ARCHIVE ? "archive" : "balanced") << " profile, "
+					<< codecThreadingName(threading) << " threading" << std::endl;
+
+				vidEncoder = new Encoder(codec.c_str(), AV_PIX_FMT_BGR24, AV_PIX_FMT_YUV420P, camSettings.width, camSettings.height, camSettings.fps,
+					profile, threading);
+				//vidEncoder = new Encoder("h264_omx", AV_PIX_FMT_BGR24, AV_PIX_FMT_YUV420P, camSettings.width, camSettings.height, camSettings.fps);
+				encodeFrameCount = 0;
+				encodeCpuNs = 0;
+				pktStats.peakBytes = 0;
+				pktStats.peakPackets = 0;
+				pktStats.largestPacket = 0;
+
+				// The rate control works down from (and back up to) the encoder's starting bit rate
+				rateControl.nominalBitRate = vidEncoder->getBitRate();
+				rateControl.minBitRate = rateControl.nominalBitRate / RATE_CONTROL_MIN_BITRATE_DIV;
+
+				m_encoderThread = std::thread(encodeFrames);
+			}
+
+			sessionWarm = true;
+			std::cout << "Session set up in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - clientJoined).count()
+				<< " ms" << std::endl;
 		}
 
 
 
 		/********* Stream Video over TCP Socket ********/
-		std::cout << "Streaming Video!" << std::endl;
-		// Client has accepted, camera is setup ,stream until client disconnects.
-		bool qSuccess;
+		addSubscriber(clientSockFd, clientName, codec != "none", clientJoined);
+		sendSequence = 0;
+		resetRateControl(codec != "none");
+		// Camera is setup, stream until the last client disconnects.
 		int cnt = 0;
+		unsigned long long captureCount = 0;
 		do
 		{
-			// Get Frame
-			vidCam.read(frame);
-			if (frame.empty())
+			// Get Frame. Capture straight into a free pool buffer, the previous one now belongs to the queue.
+			framePool.acquire(frame.image);
+			vidCam.read(frame.image);
+			frame.captureUs = streamTimestampUs();
+			if (frame.image.empty())
 			{
 				std::cerr << "ERROR! blank frame grabbed" << std::endl;
 				return 1;
 			}
 
-			// Drop frame into circular queue
-			do
-			{
-				qFrame_mutex.lock();
-				qSuccess = qFrame.enQueue(frame);
-				qFrame_mutex.unlock();
-			} while (!qSuccess);
+			// Drop frame into circular queue (by handle, no copy). If the encoder is that far behind the oldest frame
+			// makes room, so this never waits. Rate control may have cut the frame rate, the frames in between are
+			// never encoded or sent.
+			if (captureCount++ % rateControl.frameStep == 0)
+				qFrame.enQueue(frame);
 
 			// If using compression, then encode frame to packet before sending
 			if (codec != "none")
 			{				
 				// There may not always be a packet to send since the encoder is in another thread, so check
-				// to see if a valid packet is available, send if it is
-				qPkt_mutex.lock();
-				if (qPkt.deQueue(sendPkt))
-					clientStatus = send(clientSockFd, sendPkt.buffer, sendPkt.size, 0);
-				qPkt_mutex.unlock();
+				// to see if valid packets are available, and hand each one to every client's sender
+				while (qPkt.deQueue(sendPkt))
+				{
+					pktStats.bytesQueued -= sendPkt.pkt->size;
+					initFrameHeader(sendHdr, sendPkt.pkt->size, sendSequence++, sendPkt.captureUs, vidEncoder->getCodecId(),
+						(sendPkt.pkt->flags & AV_PKT_FLAG_KEY) ? STREAM_FLAG_KEY : 0);
+					publishFrame(sendHdr, &sendPkt.pkt, frame.image);
+					sendPkt.pkt.unref();
+				}
+			}
+			// If not using compression then, get frame out of circuar queue and send raw data
+			else if (qFrame.deQueue(frame))
+			{
+				// Pool buffers are continuous, so the frame is already one [B G R B G R ...] block
+				initFrameHeader(sendHdr, (uint32_t)(frame.image.total() * frame.image.elemSize()), sendSequence++, frame.captureUs,
+					AV_CODEC_ID_RAWVIDEO, STREAM_FLAG_KEY);
+				publishFrame(sendHdr, nullptr, frame.image);
+			}
+
+			// Let in any clients whose settings arrived since the last frame. They must want the same stream.
+			while ((clientSockFd = acceptClient(serverSockFd, clientSettings, clientName, clientJoined)) >= 0)
+			{
+				if (!sameSettings(clientSettings, camSettings))
+				{
+					std::cerr << "Rejecting " << clientName << ": camera already streaming with different settings" << std::endl;
+					close(clientSockFd);
+				}
+				else if (!addSubscriber(clientSockFd, clientName, codec != "none", clientJoined))
+				{
+					std::cerr << "Rejecting " << clientName << ": too many clients" << std::endl;
+					close(clientSockFd);
+				}
 			}
-			// If not using compression then, get frame out of circuar queue and resize to send raw data
-			else
+
+			// Pick up keyframe requests, and clean up after any clients that went away (client socket was
+			// closed, or a send failed)
+			for (int i = 0; i < MAX_SUBSCRIBERS; i++)
 			{
-				qFrame_mutex.lock();
-				qFrame.deQueue(frame);
-				qFrame_mutex.unlock();
-
-				// Resize to send
-				frame = (frame.reshape(0, 1));
-				imgSize = frame.total() * frame.elemSize(); // get numBytes
-				clientStatus = send(clientSockFd, frame.data, imgSize, 0);
+				if (!subscribers[i].connected)
+					continue;
+				readControlMessages(&subscribers[i], codec != "none");
+				if (!subscribers[i].alive)
+					removeSubscriber(&subscribers[i]);
 			}
+
+			// Trade bit rate / frame rate for latency if the clients are falling behind
+			if (numSubscribers > 0)
+				updateRateControl(codec != "none", camSettings.fps);
 			
 #ifdef USEVIDEO
 		cnt++;
@@ -314,22 +1285,23 @@ int main(int argc, char* argv[])
 		}
 #endif
 
-		} while (clientStatus > 0);
+		} while (numSubscribers > 0);
 
-		// The only exit from the video streaming loop is if the send
-		// fails to the client (i.e. the client socket was closed) so clean up
-		// the socket and go back to waiting for a new connection
-		std::cout << "Connection from " << inet_ntoa(clientAddr.sin_addr)
-			<< " on port " << ntohs(clientAddr.sin_port)
-			<< " has been CLOSED (send fail)." << std::endl;
-		close(clientSockFd);
+		// The only exit from the video streaming loop is when the last client has gone. The session stays
+		// warm (see the top of the loop) in case it comes straight back.
+		std::cout << "Last client gone" << std::endl;
+		std::cout << "Rate control: " << rateControl.cuts << " cuts, " << rateControl.raises << " raises, ended at ";
 		if (codec != "none")
-		{
-			m_encoderThread.join();
-			delete vidEncoder;
-			av_packet_free(&avPkt);
-			std::cout << "Connection cleanly closed!" << std::endl;
-		}
+			std::cout << vidEncoder->getBitRate() / 1000 << "/" << rateControl.nominalBitRate / 1000 << " kbit/s and ";
+		std::cout << double(camSettings.fps) / rateControl.frameStep << " fps" << std::endl;
+
+		FramePoolStats poolStats = framePool.getStats();
+		std::cout << "Frame pool: " << poolStats.acquired << " frames, peak " << poolStats.peakInUse << "/" << poolStats.numBuffers
+			<< " buffers in use, " << poolStats.exhausted << " exhausted, " << poolStats.oversize << " oversize" << std::endl;
+		if (codec != "none")
+			std::cout << "Packet queue: peak " << pktStats.peakPackets << "/" << qPkt.capacity() << " packets, " << pktStats.peakBytes
+				<< " bytes in flight, largest packet " << pktStats.largestPacket << " bytes, " << qFrame.getStats().droppedOldest
+				<< " frames dropped before the encoder" << std::endl;
 	}
 
 